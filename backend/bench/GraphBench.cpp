@@ -0,0 +1,261 @@
+// End-to-end benchmark of the Graph API on a generated dataset.
+//
+//   graph_bench.exe --dir DIR [--queries N] [--runs R] [--seed S] [--label L]
+//   graph_bench.exe --compare BASE.jsonl NEW.jsonl
+//
+// DIR must contain dataset/users.csv (see GraphGen.cpp) and is used as
+// scratch: the snapshot and write-ahead log next to it are replaced. Load,
+// checkpoint, CSV save and PageRank are timed R times; each query type N times over
+// random users. Results go to stdout as one JSON object per line, e.g.
+//   {"bench":"recommend","samples":2000,"ops_per_sec":...,"p50_us":...,
+//    "p99_us":...,"max_us":...,"peak_rss_kb":...}
+// Phases that write a file (save_csv) also report "mb_per_sec".
+// so two runs can be diffed, or compared with --compare. peak_rss_kb is the
+// process high-water mark at the end of that phase (0 where unsupported).
+// A readable table goes to stderr.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "graph/Graph.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+static long peakRssKb() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;   // KiB on Linux
+#endif
+}
+
+struct Result {
+    string name;
+    vector<double> micros;   // one entry per operation
+    double bytes = 0;        // written per operation, for phases that save a file
+
+    double percentile(double q) const {
+        vector<double> sorted = micros;
+        sort(sorted.begin(), sorted.end());
+        size_t rank = (size_t)ceil(q * sorted.size());
+        return sorted[rank ? rank - 1 : 0];
+    }
+};
+
+static void report(const Result& r) {
+    double total = 0;
+    for (double us : r.micros) total += us;
+    double opsPerSec = total > 0 ? r.micros.size() / (total / 1e6) : 0;
+    double p50 = r.percentile(0.50), p99 = r.percentile(0.99), worst = r.percentile(1.0);
+    long rss = peakRssKb();
+    double mbPerSec = r.bytes * opsPerSec / 1e6;
+    printf("{\"bench\":\"%s\",\"samples\":%zu,\"ops_per_sec\":%.2f,\"p50_us\":%.2f,\"p99_us\":%.2f,"
+           "\"max_us\":%.2f,\"peak_rss_kb\":%ld",
+           r.name.c_str(), r.micros.size(), opsPerSec, p50, p99, worst, rss);
+    if (r.bytes > 0) printf(",\"mb_per_sec\":%.2f", mbPerSec);
+    printf("}\n");
+    fflush(stdout);
+    fprintf(stderr, "%-16s %8zu %14.1f %12.1f %12.1f %12.1f %10ld", r.name.c_str(), r.micros.size(),
+            opsPerSec, p50, p99, worst, rss / 1024);
+    if (r.bytes > 0) fprintf(stderr, "   %.1f MB/s", mbPerSec);
+    fprintf(stderr, "\n");
+}
+
+template <typename Fn>
+static Result timeEach(const string& name, size_t n, Fn fn) {
+    Result r{name, {}};
+    r.micros.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto start = chrono::steady_clock::now();
+        fn(i);
+        r.micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+    }
+    return r;
+}
+
+// Recommendations print to cout; drop that output while timing.
+struct MuteCout {
+    ofstream sink;
+    streambuf* old;
+    MuteCout() : old(cout.rdbuf(sink.rdbuf())) {}
+    ~MuteCout() { cout.rdbuf(old); }
+};
+
+static void removeDerivedFiles() {
+    error_code ec;
+    filesystem::remove("dataset/users.snap", ec);
+    filesystem::remove("dataset/users.wal", ec);
+}
+
+// Times Graph construction (startup) only; the previous instance is torn
+// down outside the clock. `fromCsv` removes the snapshot before each run.
+static Result timeLoads(const string& name, size_t runs, bool fromCsv, unique_ptr<Graph>& graph) {
+    Result r{name, {}};
+    for (size_t i = 0; i < runs; ++i) {
+        graph.reset();
+        if (fromCsv) removeDerivedFiles();
+        auto start = chrono::steady_clock::now();
+        graph = make_unique<Graph>(true);
+        r.micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+    }
+    return r;
+}
+
+// =================== COMPARE ===================
+
+static map<string, map<string, double>> readResults(const string& path) {
+    map<string, map<string, double>> results;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        auto name = line.find("\"bench\":\"");
+        if (name == string::npos) continue;
+        name += 9;
+        string bench = line.substr(name, line.find('"', name) - name);
+        for (const char* key : {"ops_per_sec", "p50_us", "p99_us", "peak_rss_kb", "mb_per_sec"}) {
+            auto pos = line.find("\"" + string(key) + "\":");
+            if (pos != string::npos) results[bench][key] = atof(line.c_str() + pos + strlen(key) + 3);
+        }
+    }
+    return results;
+}
+
+static int compare(const string& basePath, const string& newPath) {
+    auto base = readResults(basePath), next = readResults(newPath);
+    if (base.empty() || next.empty()) {
+        cerr << "Nothing to compare in " << (base.empty() ? basePath : newPath) << "\n";
+        return 1;
+    }
+    printf("%-16s %-12s %14s %14s %9s\n", "bench", "metric", "base", "new", "change");
+    for (auto& [bench, metrics] : next) {
+        if (!base.count(bench)) continue;
+        for (auto& [key, value] : metrics) {
+            double old = base[bench][key];
+            double change = old != 0 ? 100.0 * (value - old) / old : 0;
+            printf("%-16s %-12s %14.2f %14.2f %+8.1f%%\n", bench.c_str(), key.c_str(), old, value, change);
+        }
+    }
+    return 0;
+}
+
+// =================== MAIN ===================
+
+int main(int argc, char** argv) {
+    string dir = ".", label;
+    size_t queries = 2000, runs = 3;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--compare" && i + 2 < argc) return compare(argv[i + 1], argv[i + 2]);
+        if (arg == "--dir" && hasValue) dir = argv[++i];
+        else if (arg == "--queries" && hasValue) queries = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--runs" && hasValue) runs = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--label" && hasValue) label = argv[++i];
+        else {
+            cerr << "usage: graph_bench.exe --dir DIR [--queries N] [--runs R] [--seed S] [--label L]\n"
+                    "       graph_bench.exe --compare BASE.jsonl NEW.jsonl\n";
+            return 1;
+        }
+    }
+
+    error_code ec;
+    filesystem::current_path(dir, ec);
+    if (ec || !filesystem::exists("dataset/users.csv")) {
+        cerr << "No dataset/users.csv under " << dir << "\n";
+        return 1;
+    }
+
+    fprintf(stderr, "%-16s %8s %14s %12s %12s %12s %10s\n", "bench", "samples", "ops/s", "p50 us",
+            "p99 us", "max us", "rss MB");
+
+    // Cold loads from CSV, then checkpoints (CSV + snapshot), then loads from
+    // the snapshot they leave behind.
+    unique_ptr<Graph> loaded;
+    report(timeLoads("load_csv", runs, true, loaded));
+    report(timeEach("checkpoint", runs, [&](size_t) { loaded->checkpoint(); }));
+    report(timeLoads("load_snapshot", runs, false, loaded));
+    Graph& g = *loaded;
+
+    // users.csv on its own, written beside the original from the same graph.
+    {
+        CsrGraph csv;
+        ThreadPool pool;
+        FileManager("dataset/users.csv", true).loadWithHashes(csv, pool);
+        FileManager scratch("dataset/bench_save.csv", true);
+        Result save = timeEach("save_csv", runs, [&](size_t) { scratch.saveWithHashes(csv); });
+        save.bytes = (double)filesystem::file_size("dataset/bench_save.csv", ec);
+        filesystem::remove("dataset/bench_save.csv", ec);
+        report(save);
+    }
+
+    vector<string> users = g.getUsers();
+    if (users.empty()) {
+        cerr << "Dataset is empty\n";
+        return 1;
+    }
+    printf("{\"bench\":\"graph\",\"label\":\"%s\",\"users\":%zu,\"queries\":%zu,\"runs\":%zu,\"seed\":%llu}\n",
+           label.c_str(), users.size(), queries, runs, (unsigned long long)seed);
+
+    report(timeEach("pagerank", runs, [&](size_t) { g.computePageRank(); }));
+
+    // Distinct users so the recommendation cache never answers.
+    mt19937_64 rng(seed);
+    vector<string> sample = users;
+    shuffle(sample.begin(), sample.end(), rng);
+    sample.resize(min(queries, sample.size()));
+    {
+        MuteCout mute;
+        report(timeEach("recommend", sample.size(), [&](size_t i) { g.recommendFriends(sample[i], 10); }));
+        auto ppr = [&](size_t i) { g.recommendFriends(sample[i], 10, ScoreFunction::PersonalizedPageRank); };
+        report(timeEach("recommend_ppr", sample.size(), ppr));
+        g.enableWalkSegments(4);
+        report(timeEach("ppr_segments", sample.size(), ppr));
+        g.enableWalkSegments(0);
+        g.similarUsers(sample[0], 10);   // builds the MinHash index
+        report(timeEach("similar", sample.size(), [&](size_t i) { g.similarUsers(sample[i], 10); }));
+    }
+
+    // Mutual friends of users two hops apart, as a recommendation would ask.
+    auto pickUser = [&] { return users[uniform_int_distribution<size_t>(0, users.size() - 1)(rng)]; };
+    auto pickFriend = [&](const string& u) {
+        auto friends = g.getFriends(u);
+        return friends.empty() ? pickUser() : friends[uniform_int_distribution<size_t>(0, friends.size() - 1)(rng)];
+    };
+    vector<pair<string, string>> twoHop, randomPairs;
+    for (size_t i = 0; i < queries; ++i) {
+        string u = pickUser();
+        twoHop.push_back({u, pickFriend(pickFriend(u))});
+        randomPairs.push_back({pickUser(), pickUser()});
+    }
+    report(timeEach("mutual", queries, [&](size_t i) { g.getMutualFriends(twoHop[i].first, twoHop[i].second); }));
+
+    g.areConnected(users[0], users[0]);   // builds the component index
+    report(timeEach("connected", queries, [&](size_t i) { g.areConnected(randomPairs[i].first, randomPairs[i].second); }));
+    report(timeEach("shortest_path", queries, [&](size_t i) { g.shortestPath(randomPairs[i].first, randomPairs[i].second); }));
+
+    vector<string> prefixes;
+    for (size_t i = 0; i < queries; ++i) {
+        string u = pickUser();
+        prefixes.push_back(u.substr(0, min(u.size(), 1 + i % 6)));
+    }
+    report(timeEach("search", queries, [&](size_t i) { g.searchPrefix(prefixes[i]); }));
+    return 0;
+}
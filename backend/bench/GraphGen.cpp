@@ -0,0 +1,150 @@
+// Synthetic social graphs in the app's dataset format.
+//
+//   graph_gen.exe --model er|ba|rmat --users N [--degree D] [--seed S]
+//                 [--out dataset/users.csv] [--snapshot]
+//
+// --degree is the target average friend count. Models:
+//   er    Erdos-Renyi G(n, m): m = N*D/2 uniformly random friendships
+//   ba    Barabasi-Albert preferential attachment: each new user befriends
+//         D/2 existing users chosen in proportion to their degree
+//   rmat  R-MAT (a, b, c, d = 0.57, 0.19, 0.19, 0.05) over the next power of
+//         two, then randomly relabelled so hubs aren't all low IDs
+// Users are named user0..user<N-1> with sequential hex IDs. --snapshot also
+// writes the binary snapshot next to the CSV, which the app then loads first.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "io/FileManager.hpp"
+
+using namespace std;
+
+using Edges = vector<pair<VertexId, VertexId>>;
+
+static Edges erdosRenyi(size_t n, size_t edges, mt19937_64& rng) {
+    Edges out;
+    out.reserve(edges);
+    uniform_int_distribution<VertexId> pick(0, n - 1);
+    while (out.size() < edges) {
+        VertexId a = pick(rng), b = pick(rng);
+        if (a != b) out.push_back({a, b});
+    }
+    return out;
+}
+
+static Edges barabasiAlbert(size_t n, size_t perVertex, mt19937_64& rng) {
+    Edges out;
+    vector<VertexId> ends;   // every edge endpoint once: sampling it is sampling by degree
+    size_t seed = min(n, perVertex + 1);
+    for (VertexId a = 0; a < seed; ++a)
+        for (VertexId b = a + 1; b < seed; ++b) {
+            out.push_back({a, b});
+            ends.push_back(a);
+            ends.push_back(b);
+        }
+
+    vector<VertexId> targets;
+    for (VertexId v = seed; v < n; ++v) {
+        targets.clear();
+        while (targets.size() < perVertex) {
+            VertexId t = ends[uniform_int_distribution<size_t>(0, ends.size() - 1)(rng)];
+            if (find(targets.begin(), targets.end(), t) == targets.end()) targets.push_back(t);
+        }
+        for (VertexId t : targets) {
+            out.push_back({v, t});
+            ends.push_back(v);
+            ends.push_back(t);
+        }
+    }
+    return out;
+}
+
+static Edges rmat(size_t n, size_t edges, mt19937_64& rng) {
+    const double a = 0.57, b = 0.19, c = 0.19;
+    int scale = 0;
+    while ((size_t(1) << scale) < n) ++scale;
+
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    Edges out;
+    out.reserve(edges);
+    while (out.size() < edges) {
+        uint64_t u = 0, v = 0;
+        for (int bit = 0; bit < scale; ++bit) {
+            double r = unit(rng);
+            if (r < a) {}
+            else if (r < a + b) v |= uint64_t(1) << bit;
+            else if (r < a + b + c) u |= uint64_t(1) << bit;
+            else { u |= uint64_t(1) << bit; v |= uint64_t(1) << bit; }
+        }
+        if (u < n && v < n && u != v) out.push_back({(VertexId)u, (VertexId)v});
+    }
+
+    vector<VertexId> label(n);
+    for (size_t i = 0; i < n; ++i) label[i] = i;
+    shuffle(label.begin(), label.end(), rng);
+    for (auto& [u, v] : out) { u = label[u]; v = label[v]; }
+    return out;
+}
+
+static string hexId(size_t i) {
+    char buf[24];
+    snprintf(buf, sizeof buf, "%06zx", i);
+    return buf;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: graph_gen.exe --model er|ba|rmat --users N [--degree D] [--seed S] "
+                    "[--out dataset/users.csv] [--snapshot]\n");
+}
+
+int main(int argc, char** argv) {
+    string model = "ba", out = "dataset/users.csv";
+    size_t users = 10000, degree = 10;
+    uint64_t seed = 1;
+    bool snapshot = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--model" && hasValue) model = argv[++i];
+        else if (arg == "--users" && hasValue) users = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--degree" && hasValue) degree = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--out" && hasValue) out = argv[++i];
+        else if (arg == "--snapshot") snapshot = true;
+        else { usage(); return 1; }
+    }
+    if (users < 2 || degree < 1) { usage(); return 1; }
+
+    auto start = chrono::steady_clock::now();
+    mt19937_64 rng(seed);
+    size_t edgeTarget = users * degree / 2;
+    Edges edges;
+    if (model == "er") edges = erdosRenyi(users, edgeTarget, rng);
+    else if (model == "ba") edges = barabasiAlbert(users, max<size_t>(1, degree / 2), rng);
+    else if (model == "rmat") edges = rmat(users, edgeTarget, rng);
+    else { usage(); return 1; }
+
+    StringArena names, ids;
+    for (size_t i = 0; i < users; ++i) {
+        names.add("user" + to_string(i));
+        ids.add(hexId(i));
+    }
+    CsrGraph graph;
+    graph.build(std::move(names), std::move(ids), edges);   // drops duplicate friendships
+
+    FileManager files(out, true);
+    if (!files.saveWithHashes(graph)) return 1;
+    if (snapshot && !files.saveSnapshot(graph, {})) return 1;
+
+    size_t maxDegree = 0;
+    for (VertexId v = 0; v < graph.vertexSlots(); ++v) maxDegree = max(maxDegree, graph.degree(v));
+    printf("%s: %zu users, %zu friendships (avg degree %.1f, max %zu), seed %llu -> %s%s in %.0f ms\n",
+           model.c_str(), graph.vertexCount(), graph.edgeCount(), 2.0 * graph.edgeCount() / users,
+           maxDegree, (unsigned long long)seed, out.c_str(), snapshot ? " (+ snapshot)" : "",
+           chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Sorted-set intersection benchmark: every kernel in graph/Intersect against
+// the original unordered_set<string> probe, over several degree
+// distributions.
+//
+//   make bench-intersect
+//   ./build/intersect_bench.exe [seconds-per-case]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "graph/Intersect.hpp"
+
+using namespace std;
+
+using List = vector<VertexId>;
+
+struct Case {
+    string name;
+    vector<List> lists;
+    vector<pair<size_t, size_t>> pairs;   // indexes into lists
+};
+
+static List randomSubset(mt19937_64& rng, size_t size, size_t universe) {
+    unordered_set<VertexId> picked;
+    uniform_int_distribution<VertexId> pick(0, universe - 1);
+    while (picked.size() < size) picked.insert(pick(rng));
+    List list(picked.begin(), picked.end());
+    sort(list.begin(), list.end());
+    return list;
+}
+
+// `count` pairs of lists of the given sizes drawn from [0, universe).
+static Case fixedSizes(const string& name, size_t na, size_t nb, size_t universe, size_t count,
+                       mt19937_64& rng) {
+    Case c{name, {}, {}};
+    for (size_t i = 0; i < count; ++i) {
+        c.lists.push_back(randomSubset(rng, na, universe));
+        c.lists.push_back(randomSubset(rng, nb, universe));
+        c.pairs.push_back({2 * i, 2 * i + 1});
+    }
+    return c;
+}
+
+// Neighbor lists with power-law degrees (exponent ~2.1, as in social
+// graphs). Pairs are drawn proportional to degree on both sides, which is
+// what friends-of-friends walks end up intersecting.
+static Case powerLaw(size_t vertices, size_t count, mt19937_64& rng) {
+    Case c{"power-law", {}, {}};
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    vector<double> weights;
+    for (size_t v = 0; v < vertices; ++v) {
+        double degree = floor(2.0 * pow(1.0 - unit(rng), -1.0 / 1.1));
+        degree = min(degree, (double)vertices / 10);
+        c.lists.push_back(randomSubset(rng, (size_t)degree, vertices));
+        weights.push_back(degree);
+    }
+    discrete_distribution<size_t> byDegree(weights.begin(), weights.end());
+    for (size_t i = 0; i < count; ++i) c.pairs.push_back({byDegree(rng), byDegree(rng)});
+    return c;
+}
+
+struct Timing {
+    double nsPerPair;
+    double melemsPerSec;
+    size_t matches;
+};
+
+// Runs fn over all pairs until `budget` seconds have passed.
+template <typename Fn>
+static Timing measure(const Case& c, double budget, Fn fn) {
+    size_t elems = 0;
+    for (auto [a, b] : c.pairs) elems += c.lists[a].size() + c.lists[b].size();
+
+    size_t rounds = 0, matches = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        matches = 0;
+        for (auto [a, b] : c.pairs) matches += fn(a, b);
+        rounds++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < budget);
+    double pairs = (double)rounds * c.pairs.size();
+    return {seconds * 1e9 / pairs, (double)rounds * elems / seconds / 1e6, matches};
+}
+
+int main(int argc, char** argv) {
+    double budget = argc > 1 ? atof(argv[1]) : 0.3;
+    mt19937_64 rng(42);
+
+    vector<Case> cases;
+    cases.push_back(fixedSizes("balanced 16/16", 16, 16, 64, 4096, rng));
+    cases.push_back(fixedSizes("balanced 256/256", 256, 256, 1024, 512, rng));
+    cases.push_back(fixedSizes("balanced 4k/4k", 4096, 4096, 16384, 32, rng));
+    cases.push_back(fixedSizes("sparse 4k/4k", 4096, 4096, 1 << 20, 32, rng));
+    cases.push_back(fixedSizes("skewed 1:16", 256, 4096, 16384, 64, rng));
+    cases.push_back(fixedSizes("skewed 1:64", 64, 4096, 16384, 128, rng));
+    cases.push_back(fixedSizes("skewed 1:256", 32, 8192, 32768, 128, rng));
+    cases.push_back(fixedSizes("skewed 1:1024", 16, 16384, 65536, 128, rng));
+    cases.push_back(powerLaw(50000, 20000, rng));
+
+    printf("best kernel: %s, gallop ratio: %zu\n\n", intersectKernelName(bestIntersectKernel()),
+           intersectGallopRatio());
+    printf("%-18s %-22s %12s %12s %10s\n", "case", "method", "ns/pair", "Melem/s", "matches");
+
+    for (const Case& c : cases) {
+        // The implementation this replaced: probe one string set per element
+        // of the other.
+        vector<unordered_set<string>> named(c.lists.size());
+        for (size_t i = 0; i < c.lists.size(); ++i)
+            for (VertexId v : c.lists[i]) named[i].insert("user" + to_string(v));
+
+        auto report = [&](const char* method, const Timing& t, size_t expected) {
+            printf("%-18s %-22s %12.1f %12.1f %10zu%s\n", c.name.c_str(), method, t.nsPerPair,
+                   t.melemsPerSec, t.matches, t.matches == expected ? "" : "  MISMATCH");
+        };
+
+        vector<string> names;
+        auto base = measure(c, budget, [&](size_t a, size_t b) {
+            names.clear();
+            for (const string& s : named[a])
+                if (named[b].count(s)) names.push_back(s);
+            return names.size();
+        });
+        report("unordered_set<string>", base, base.matches);
+
+        List out;
+        for (auto kernel : {IntersectKernel::Scalar, IntersectKernel::Galloping, IntersectKernel::Sse42,
+                            IntersectKernel::Avx2}) {
+            if (!intersectKernelSupported(kernel)) continue;
+            auto t = measure(c, budget, [&](size_t a, size_t b) {
+                return intersectSortedWith(kernel, c.lists[a], c.lists[b], out);
+            });
+            report(intersectKernelName(kernel), t, base.matches);
+        }
+        report("auto", measure(c, budget, [&](size_t a, size_t b) {
+                   return intersectSorted(c.lists[a], c.lists[b], out);
+               }), base.matches);
+        report("auto (count only)", measure(c, budget, [&](size_t a, size_t b) {
+                   return intersectCount(c.lists[a], c.lists[b]);
+               }), base.matches);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,237 @@
+// Sharded serving (--cluster) with one shard against N shards.
+//
+//   shard_bench.exe --dir DIR [--shards N] [--scheme hash|lp] [--queries Q]
+//                   [--clients C] [--seed S] [--app PATH]
+//
+// DIR must contain dataset/users.csv (see GraphGen.cpp). The graph is loaded
+// once and partitioned into DIR/shards-1 and DIR/shards-N; each partition is
+// then served by its own shard processes (PATH, by default the app built
+// next to this binary) and queried by C client threads, each with its own
+// ClusterSession, Q times per query type over the same random users.
+// Results go to stdout as one JSON object per line, e.g.
+//   {"bench":"cluster_recommend","shards":4,"clients":4,"samples":2000,
+//    "ops_per_sec":...,"p50_us":...,"p99_us":...,"max_us":...}
+// ops_per_sec is queries over wall time with all clients running. Each
+// partition also gets a "cluster_partition" line (cut friendships, ghosts,
+// the largest shard's peak RSS) and "cluster_pagerank"/"cluster_components"
+// lines for the distributed passes. A 1-vs-N table goes to stderr.
+//
+// Every process shares the machine's cores: on a box with fewer cores than
+// shards + clients, N shards mostly measure the extra round trips.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "graph/Graph.hpp"
+#include "cluster/Coordinator.hpp"
+
+using namespace std;
+
+// VmHWM of another process, in KiB (0 where unsupported).
+static long peakRssKb(long pid) {
+    ifstream status("/proc/" + to_string(pid) + "/status");
+    string line;
+    while (getline(status, line))
+        if (line.rfind("VmHWM:", 0) == 0) return strtol(line.c_str() + 6, nullptr, 10);
+    return 0;
+}
+
+struct Result {
+    string name;
+    vector<double> micros;   // one entry per query
+    double wallMicros = 0;
+
+    double percentile(double q) const {
+        vector<double> sorted = micros;
+        sort(sorted.begin(), sorted.end());
+        size_t rank = (size_t)ceil(q * sorted.size());
+        return sorted.empty() ? 0 : sorted[rank ? rank - 1 : 0];
+    }
+    double opsPerSec() const { return wallMicros > 0 ? micros.size() / (wallMicros / 1e6) : 0; }
+};
+
+static void report(const Result& r, size_t shards, size_t clients) {
+    printf("{\"bench\":\"%s\",\"shards\":%zu,\"clients\":%zu,\"samples\":%zu,\"ops_per_sec\":%.2f,"
+           "\"p50_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}\n",
+           r.name.c_str(), shards, clients, r.micros.size(), r.opsPerSec(), r.percentile(0.5),
+           r.percentile(0.99), r.percentile(1.0));
+    fflush(stdout);
+}
+
+// Runs n queries split over the clients' sessions, timing each one.
+template <typename Fn>
+static Result timeClients(const string& name, size_t n, vector<unique_ptr<ClusterSession>>& sessions, Fn fn) {
+    Result r{name, vector<double>(n)};
+    size_t clients = sessions.size();
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (size_t c = 0; c < clients; ++c)
+        threads.emplace_back([&, c] {
+            for (size_t i = c; i < n; i += clients) {
+                auto t = chrono::steady_clock::now();
+                fn(*sessions[c], i);
+                r.micros[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - t).count();
+            }
+        });
+    for (auto& t : threads) t.join();
+    r.wallMicros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+struct Workload {
+    vector<string> users;
+    vector<pair<string, string>> twoHop, randomPairs;
+};
+
+// One partition, served and measured; returns the query results by name.
+static map<string, Result> runPartition(Graph& g, const Workload& w, uint32_t shards, PartitionScheme scheme,
+                                        size_t clients, const string& app) {
+    map<string, Result> results;
+    string dir = "shards-" + to_string(shards);
+    PartitionStats st;
+    if (!g.partition(shards, scheme, dir, st)) return results;
+
+    ShardCluster cluster;
+    if (!cluster.start(dir, app, false)) return results;
+    vector<unique_ptr<ClusterSession>> sessions;
+    for (size_t c = 0; c < clients; ++c) {
+        sessions.push_back(make_unique<ClusterSession>(cluster));
+        if (!sessions.back()->connect()) {
+            cerr << "Cannot connect to the shards of " << dir << "\n";
+            return results;
+        }
+    }
+
+    ClusterSession& control = *sessions[0];
+    auto result = control.computePageRank();
+    printf("{\"bench\":\"cluster_pagerank\",\"shards\":%u,\"ms\":%.2f,\"iterations\":%d}\n", shards,
+           result.millis, result.iterations);
+    auto start = chrono::steady_clock::now();
+    size_t rounds = control.computeComponents();
+    printf("{\"bench\":\"cluster_components\",\"shards\":%u,\"ms\":%.2f,\"rounds\":%zu}\n", shards,
+           chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(), rounds);
+
+    size_t n = w.users.size();
+    auto add = [&](Result r) {
+        report(r, shards, clients);
+        results[r.name] = std::move(r);
+    };
+    add(timeClients("cluster_friends", n, sessions, [&](ClusterSession& s, size_t i) { s.friends(w.users[i]); }));
+    add(timeClients("cluster_mutual", n, sessions, [&](ClusterSession& s, size_t i) {
+        s.mutualFriends(w.twoHop[i].first, w.twoHop[i].second);
+    }));
+    add(timeClients("cluster_connected", n, sessions, [&](ClusterSession& s, size_t i) {
+        s.areConnected(w.randomPairs[i].first, w.randomPairs[i].second);
+    }));
+    bool found;
+    add(timeClients("cluster_recommend", n, sessions, [&](ClusterSession& s, size_t i) {
+        s.recommend(w.users[i], 10, ScoreFunction::PageRankMutual, found);
+    }));
+    add(timeClients("cluster_recommend_aa", n, sessions, [&](ClusterSession& s, size_t i) {
+        s.recommend(w.users[i], 10, ScoreFunction::AdamicAdar, found);
+    }));
+
+    long largestRss = 0;
+    size_t ghosts = 0;
+    for (uint32_t i = 0; i < shards; ++i) {
+        largestRss = max(largestRss, peakRssKb(cluster.shard(i).pid));
+        ghosts += st.ghosts[i];
+    }
+    printf("{\"bench\":\"cluster_partition\",\"shards\":%u,\"scheme\":\"%s\",\"users\":%zu,\"cut_edges\":%zu,"
+           "\"edges\":%zu,\"ghosts\":%zu,\"shard_peak_rss_kb\":%ld,\"partition_ms\":%.2f,\"pagerank_ms\":%.2f}\n",
+           shards, partitionSchemeName(scheme), st.users, st.cutEdges, st.edges, ghosts, largestRss, st.millis,
+           result.millis);
+    fflush(stdout);
+    // One run, so its "ops/s" in the table is runs per second.
+    results["cluster_pagerank"] = Result{"cluster_pagerank", {result.millis * 1000}, result.millis * 1000};
+    return results;
+}
+
+// =================== MAIN ===================
+
+int main(int argc, char** argv) {
+    string dir = ".", app;
+    size_t queries = 2000, clients = 4;
+    uint32_t shards = 4;
+    uint64_t seed = 1;
+    PartitionScheme scheme = PartitionScheme::Hash;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--dir" && hasValue) dir = argv[++i];
+        else if (arg == "--shards" && hasValue) shards = max<uint32_t>(1, strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--scheme" && hasValue && parsePartitionScheme(argv[i + 1], scheme)) ++i;
+        else if (arg == "--queries" && hasValue) queries = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--clients" && hasValue) clients = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--app" && hasValue) app = argv[++i];
+        else {
+            cerr << "usage: shard_bench.exe --dir DIR [--shards N] [--scheme hash|lp] [--queries Q]\n"
+                    "                       [--clients C] [--seed S] [--app PATH]\n";
+            return 1;
+        }
+    }
+    // Resolved before moving into DIR.
+    app = filesystem::absolute(app.empty() ? filesystem::path(argv[0]).parent_path() / "social_graph_app.exe"
+                                           : filesystem::path(app)).string();
+
+    error_code ec;
+    filesystem::current_path(dir, ec);
+    if (ec || !filesystem::exists("dataset/users.csv")) {
+        cerr << "No dataset/users.csv under " << dir << "\n";
+        return 1;
+    }
+    if (!filesystem::exists(app)) {
+        cerr << "No app binary at " << app << " (see --app)\n";
+        return 1;
+    }
+
+    Graph g(true);
+    vector<string> all = g.getUsers();
+    if (all.empty()) {
+        cerr << "Dataset is empty\n";
+        return 1;
+    }
+    printf("{\"bench\":\"cluster\",\"users\":%zu,\"shards\":%u,\"scheme\":\"%s\",\"queries\":%zu,"
+           "\"clients\":%zu,\"seed\":%llu}\n",
+           all.size(), shards, partitionSchemeName(scheme), queries, clients, (unsigned long long)seed);
+
+    // The same users and pairs for both runs, picked as in GraphBench.
+    mt19937_64 rng(seed);
+    auto pickUser = [&] { return all[uniform_int_distribution<size_t>(0, all.size() - 1)(rng)]; };
+    auto pickFriend = [&](const string& u) {
+        auto friends = g.getFriends(u);
+        return friends.empty() ? pickUser() : friends[uniform_int_distribution<size_t>(0, friends.size() - 1)(rng)];
+    };
+    Workload w;
+    for (size_t i = 0; i < queries; ++i) {
+        string u = pickUser();
+        w.users.push_back(u);
+        w.twoHop.push_back({u, pickFriend(pickFriend(u))});
+        w.randomPairs.push_back({pickUser(), pickUser()});
+    }
+
+    auto one = runPartition(g, w, 1, scheme, clients, app);
+    auto many = runPartition(g, w, shards, scheme, clients, app);
+    if (one.empty() || many.empty()) return 1;
+
+    fprintf(stderr, "%-22s %14s %14s %9s %12s %12s\n", "bench", "1 shard ops/s",
+            (to_string(shards) + " shards ops/s").c_str(), "speedup", "p99 us (1)", ("p99 us (" + to_string(shards) + ")").c_str());
+    for (auto& [name, r1] : one) {
+        const Result& rn = many[name];
+        double a = r1.opsPerSec(), b = rn.opsPerSec();
+        fprintf(stderr, "%-22s %14.1f %14.1f %8.2fx %12.1f %12.1f\n", name.c_str(), a, b, a > 0 ? b / a : 0,
+                r1.percentile(0.99), rn.percentile(0.99));
+    }
+    return 0;
+}
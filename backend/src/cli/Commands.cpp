@@ -0,0 +1,575 @@
+#include "Commands.hpp"
+#include "Server.hpp"
+#include "../cluster/ShardServer.hpp"
+#include "../utils/Metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+// Splits "--key value" options that follow the command from its positional
+// arguments, e.g. {"--recommend", "gor", "--k", "5"} -> {"--recommend", "gor"}
+// plus {k: 5}.
+static vector<string> splitOptions(const vector<string>& args, unordered_map<string, string>& opts) {
+    vector<string> positional;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i > 0 && args[i].rfind("--", 0) == 0 && i + 1 < args.size()) {
+            opts[args[i].substr(2)] = args[i + 1];
+            ++i;
+        } else {
+            positional.push_back(args[i]);
+        }
+    }
+    return positional;
+}
+
+static double doubleOption(const unordered_map<string, string>& opts, const string& key, double fallback) {
+    auto it = opts.find(key);
+    if (it == opts.end()) return fallback;
+    try { return stod(it->second); } catch (...) { return fallback; }
+}
+
+static int intOption(const unordered_map<string, string>& opts, const string& key, int fallback) {
+    auto it = opts.find(key);
+    if (it == opts.end()) return fallback;
+    try { return stoi(it->second); } catch (...) { return fallback; }
+}
+
+// --walks N and --restart P for personalized PageRank.
+static WalkOptions walkOptions(const unordered_map<string, string>& opts) {
+    WalkOptions walk;
+    walk.walks = max(intOption(opts, "walks", (int)walk.walks), 0);
+    walk.restart = doubleOption(opts, "restart", walk.restart);
+    return walk;
+}
+
+// =================== BATCH INPUT ===================
+
+// One mutation per line, in the CLI's own words with the leading "--"
+// optional: add U, remove U, addFriend A B, removeFriend A B, clear. Blank
+// lines and lines starting with '#' are skipped.
+static vector<Mutation> readMutations(istream& in, size_t& malformed) {
+    vector<Mutation> ops;
+    string line, word, a, b, rest;
+    while (getline(in, line)) {
+        istringstream ss(line);
+        if (!(ss >> word) || word[0] == '#') continue;
+        if (word.rfind("--", 0) == 0) word.erase(0, 2);
+        a.clear();
+        b.clear();
+        ss >> a >> b;
+        bool extra = bool(ss >> rest);
+        if (word == "add" && !a.empty() && b.empty() && !extra) ops.push_back({WalOp::AddUser, a, ""});
+        else if (word == "remove" && !a.empty() && b.empty() && !extra) ops.push_back({WalOp::RemoveUser, a, ""});
+        else if (word == "addFriend" && !b.empty() && !extra) ops.push_back({WalOp::AddFriendship, a, b});
+        else if (word == "removeFriend" && !b.empty() && !extra) ops.push_back({WalOp::RemoveFriendship, a, b});
+        else if (word == "clear" && a.empty()) ops.push_back({WalOp::Clear, "", ""});
+        else malformed++;
+    }
+    return ops;
+}
+
+// =================== OUTPUT ===================
+
+static void printFriends(ostream& out, const string& uname, const vector<string>& friends) {
+    if (friends.empty()) out << "No friends or user not found.\n";
+    else {
+        out << "Friends of " << uname << ": ";
+        for (auto &f : friends) out << f << " ";
+        out << endl;
+    }
+}
+
+static void printMutual(ostream& out, const string& u1, const string& u2, const vector<string>& mutual) {
+    if (mutual.empty()) out << "No mutual friends.\n";
+    else {
+        out << "Mutual friends of " << u1 << " & " << u2 << ": ";
+        for (auto &f : mutual) out << f << " ";
+        out << endl;
+    }
+}
+
+static void printPath(ostream& out, const vector<string>& chain, int maxDepth) {
+    if (chain.empty()) {
+        if (maxDepth >= 0) out << "No path within " << maxDepth << " hops" << endl;
+        else out << "No path found" << endl;
+        return;
+    }
+    out << "Path (" << chain.size() - 1 << " hops): ";
+    for (size_t i = 0; i < chain.size(); ++i)
+        out << (i ? " -> " : "") << chain[i];
+    out << endl;
+}
+
+// =================== SNAPSHOT QUERIES ===================
+
+bool parseRecommendQuery(const vector<string>& rawArgs, string& user, size_t& topK, ScoreFunction& fn) {
+    unordered_map<string, string> opts;
+    vector<string> args = splitOptions(rawArgs, opts);
+    if (args.size() != 2 || args[0] != "--recommend") return false;
+    fn = ScoreFunction::PageRankMutual;
+    if (opts.count("score") && !parseScoreFunction(opts["score"], fn)) return false;
+    user = args[1];
+    topK = max(intOption(opts, "k", 3), 0);
+    return true;
+}
+
+bool isSnapshotQuery(const vector<string>& rawArgs) {
+    if (rawArgs.empty()) return false;
+    const string& cmd = rawArgs[0];
+    if (cmd != "--friends" && cmd != "--mutual" && cmd != "--path" && cmd != "--recommend") return false;
+    unordered_map<string, string> opts;
+    vector<string> args = splitOptions(rawArgs, opts);
+    if (cmd == "--friends") return args.size() == 2;
+    if (cmd == "--mutual" || cmd == "--path") return args.size() == 3;
+    string user;
+    size_t topK;
+    ScoreFunction fn;
+    // The MinHash index is kept by the writer, not snapshotted.
+    return parseRecommendQuery(rawArgs, user, topK, fn) && fn != ScoreFunction::SimilarCircles;
+}
+
+void runQuery(GraphReader& reader, const GraphSnapshot& snap, const vector<string>& rawArgs,
+              ostream& out, vector<Recommendation>* recs) {
+    unordered_map<string, string> opts;
+    vector<string> args = splitOptions(rawArgs, opts);
+    const string& cmd = args[0];
+
+    if (cmd == "--friends") printFriends(out, args[1], friendNames(snap.graph, args[1]));
+    else if (cmd == "--mutual") printMutual(out, args[1], args[2], mutualFriendNames(snap.graph, args[1], args[2]));
+    else if (cmd == "--path") {
+        int maxDepth = intOption(opts, "max-depth", -1);
+        printPath(out, reader.shortestPath(snap, args[1], args[2], maxDepth), maxDepth);
+    } else if (cmd == "--recommend") {
+        string user;
+        size_t topK;
+        ScoreFunction fn;
+        parseRecommendQuery(rawArgs, user, topK, fn);
+        vector<Recommendation> list;
+        bool found = reader.recommend(snap, user, topK, fn, list, walkOptions(opts));
+        vector<pair<string, double>> named;
+        for (auto& r : list) named.emplace_back(snap.graph.name(r.vertex), r.score);
+        printRecommendations(out, user, found, named);
+        if (recs) *recs = std::move(list);
+    }
+}
+
+// =================== COMMANDS ===================
+
+bool runCommand(Graph& g, const vector<string>& rawArgs) {
+    if (rawArgs.empty()) return false;
+    unordered_map<string, string> opts;
+    vector<string> args = splitOptions(rawArgs, opts);
+    const string& cmd = args[0];
+    size_t argc = args.size();
+
+    if (cmd == "--search" && argc >= 2) {
+        auto results = g.searchPrefix(args[1]);
+        for (size_t i = 0; i < results.size(); ++i) {
+            cout << results[i];
+            if (i + 1 < results.size()) cout << ",";
+        }
+        cout << endl;
+        return true;
+    }
+
+    if (cmd == "--add" && argc == 2) {
+        const string& user = args[1];
+        if (user.size() > MAX_USERNAME_BYTES) cout << "Username too long." << endl;
+        else cout << (g.addUser(user) ? "Added user: " + user
+                                      : "User already exists.") << endl;
+        return true;
+    }
+
+    if (cmd == "--remove" && argc == 2) {
+        const string& user = args[1];
+        cout << (g.removeUser(user) ? "Removed user: " + user
+                                    : "User not found.") << endl;
+        return true;
+    }
+
+    if (cmd == "--remove" && argc > 2) {
+        vector<string> users(args.begin() + 1, args.end());
+        size_t removed = g.removeUsers(users);
+        cout << "Removed " << removed << " of " << users.size() << " users." << endl;
+        return true;
+    }
+
+    if (cmd == "--addFriend" && argc == 3) {
+        const string &u1 = args[1], &u2 = args[2];
+        cout << (g.addFriendship(u1, u2)
+                 ? "Friendship added between " + u1 + " and " + u2
+                 : "Error adding friendship.") << endl;
+        return true;
+    }
+
+    if (cmd == "--removeFriend" && argc == 3) {
+        const string &u1 = args[1], &u2 = args[2];
+        cout << (g.removeFriendship(u1, u2)
+                 ? "Friendship removed between " + u1 + " and " + u2
+                 : "Error removing friendship.") << endl;
+        return true;
+    }
+
+    if (cmd == "--users" && argc == 1) {
+        auto users = g.getUsers();
+        for (size_t i = 0; i < users.size(); ++i) {
+            cout << users[i];
+            if (i + 1 < users.size()) cout << ",";
+        }
+        cout << endl;
+        return true;
+    }
+
+    if (cmd == "--friends" && argc == 2) {
+        printFriends(cout, args[1], g.getFriends(args[1]));
+        return true;
+    }
+
+    if (cmd == "--mutual" && argc == 3) {
+        printMutual(cout, args[1], args[2], g.getMutualFriends(args[1], args[2]));
+        return true;
+    }
+
+    if (cmd == "--connection" && argc == 3) {
+        cout << (g.areConnected(args[1], args[2])
+                 ? "Connected: Yes"
+                 : "Connected: No") << endl;
+        return true;
+    }
+
+    if (cmd == "--path" && argc == 3) {
+        int maxDepth = intOption(opts, "max-depth", -1);
+        printPath(cout, g.shortestPath(args[1], args[2], maxDepth), maxDepth);
+        return true;
+    }
+
+    if (cmd == "--components" && argc == 1) {
+        auto st = g.componentStats();
+        size_t users = g.userCount();
+        cout << "Components: " << st.components << "\n";
+        cout << "Largest: " << st.largest << " users";
+        if (users) cout << " (" << fixed << setprecision(1) << 100.0 * st.largest / users << "%)";
+        cout << "\nIsolated users: " << st.isolated << "\n";
+        cout << "Top sizes:";
+        for (size_t size : st.topSizes) cout << " " << size;
+        cout << endl;
+        return true;
+    }
+
+    if (cmd == "--pagerank") {
+        PageRankOptions prOpts;
+        prOpts.tolerance = doubleOption(opts, "tol", prOpts.tolerance);
+        prOpts.maxIterations = intOption(opts, "max-iter", prOpts.maxIterations);
+        prOpts.threads = intOption(opts, "threads", 0);
+        g.computePageRank(prOpts);
+        g.displayPageRank();
+        return true;
+    }
+
+    if (cmd == "--recommend" && argc == 2) {
+        ScoreFunction fn = ScoreFunction::PageRankMutual;
+        if (opts.count("score") && !parseScoreFunction(opts["score"], fn)) {
+            cout << "Unknown score function: " << opts["score"] << "\n";
+            return false;
+        }
+        g.recommendFriends(args[1], intOption(opts, "k", 3), fn, walkOptions(opts));
+        return true;
+    }
+
+    if (cmd == "--similar" && argc == 2) {
+        g.similarUsers(args[1], intOption(opts, "k", 5));
+        return true;
+    }
+
+    if (cmd == "--recommend-all" && argc == 1) {
+        ScoreFunction fn = ScoreFunction::PageRankMutual;
+        if (opts.count("score") && !parseScoreFunction(opts["score"], fn)) {
+            cout << "Unknown score function: " << opts["score"] << "\n";
+            return false;
+        }
+        ofstream file;
+        if (opts.count("out")) {
+            file.open(opts["out"], ios::binary | ios::trunc);
+            if (!file.is_open()) {
+                cerr << "Error opening " << opts["out"] << " for writing.\n";
+                return false;
+            }
+        }
+        auto result = g.recommendAll(max(intOption(opts, "k", 3), 0), fn, intOption(opts, "threads", 0),
+                                     file.is_open() ? (ostream&)file : cout, walkOptions(opts));
+        cout << "Recommended for " << result.users << " users (" << result.recommendations
+             << " suggestions) in " << fixed << setprecision(1) << result.millis << " ms: "
+             << setprecision(0) << result.usersPerSec() << " users/s on " << result.threads << " threads";
+        if (file.is_open()) cout << " -> " << opts["out"];
+        cout << endl;
+        return true;
+    }
+
+    if (cmd == "--walk-segments" && argc == 2) {
+        int perVertex = 0;
+        try { perVertex = stoi(args[1]); } catch (...) { perVertex = -1; }
+        if (perVertex < 0) {
+            cout << "Usage: --walk-segments <per-user count>\n";
+            return false;
+        }
+        g.enableWalkSegments(perVertex);
+        return true;
+    }
+
+    if (cmd == "--cache-stats" && argc == 1) {
+        auto st = g.recommendationCacheStats();
+        size_t lookups = st.hits + st.misses;
+        cout << "Recommendation cache: " << st.entries << "/" << st.capacity << " entries\n";
+        cout << "Hits: " << st.hits << ", misses: " << st.misses;
+        if (lookups) cout << " (hit rate " << fixed << setprecision(1) << 100.0 * st.hits / lookups << "%)";
+        cout << "\nEvictions: " << st.evictions << ", invalidations: " << st.invalidations << endl;
+        return true;
+    }
+
+    if (cmd == "--stats" && argc == 1) {
+        writeMetrics(cout);
+        return true;
+    }
+
+    if (cmd == "--export-snapshot" && argc <= 2) {
+        auto start = chrono::steady_clock::now();
+        string path = argc == 2 ? args[1] : "";
+        if (!g.exportSnapshot(path)) return false;
+        cout << "Snapshot written in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms\n";
+        return true;
+    }
+
+    if (cmd == "--partition" && argc == 2) {
+        int shards = 0;
+        try { shards = stoi(args[1]); } catch (...) { shards = 0; }
+        PartitionScheme scheme = PartitionScheme::Hash;
+        if (shards < 1 || (opts.count("scheme") && !parsePartitionScheme(opts["scheme"], scheme))) {
+            cout << "Usage: --partition <shards> [--scheme hash|lp] [--out DIR]\n";
+            return false;
+        }
+        string dir = opts.count("out") ? opts["out"] : g.defaultPartitionDir();
+        PartitionStats st;
+        if (!g.partition(shards, scheme, dir, st)) return false;
+        cout << "Partitioned " << st.users << " users into " << shards << " shards ("
+             << partitionSchemeName(scheme) << ") in " << fixed << setprecision(1) << st.millis
+             << " ms -> " << dir << "\n";
+        cout << "Cut friendships: " << st.cutEdges << " of " << st.edges;
+        if (st.edges) cout << " (" << 100.0 * st.cutEdges / st.edges << "%)";
+        cout << "\n";
+        for (int i = 0; i < shards; ++i)
+            cout << "Shard " << i << ": " << st.owned[i] << " users, " << st.ghosts[i] << " ghosts\n";
+        cout << defaultfloat;
+        return true;
+    }
+
+    if (cmd == "--checkpoint" && argc == 1) {
+        auto start = chrono::steady_clock::now();
+        if (!g.checkpoint()) {
+            cout << "Checkpoint failed.\n";
+            return false;
+        }
+        cout << "Checkpoint written in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms\n";
+        return true;
+    }
+
+    if (cmd == "--migrate-ids" && argc == 1) {
+        size_t migrated;
+        if (!g.migrateIds(migrated)) {
+            cout << "Could not write the checkpoint; user IDs left unchanged.\n";
+            return false;
+        }
+        if (migrated) cout << "Gave " << migrated << " users 64-bit IDs; checkpoint written\n";
+        else cout << "All user IDs are already 64-bit.\n";
+        return true;
+    }
+
+    if (cmd == "--batch" && argc == 2) {
+        size_t malformed = 0;
+        vector<Mutation> ops;
+        if (args[1] == "-") {
+            ops = readMutations(cin, malformed);
+        } else {
+            ifstream in(args[1]);
+            if (!in.is_open()) {
+                cerr << "Cannot open " << args[1] << "\n";
+                return false;
+            }
+            ops = readMutations(in, malformed);
+        }
+        MutationBatchStats st = g.applyBatch(ops);
+        cout << "Applied " << st.applied << " of " << st.submitted << " operations ("
+             << st.submitted - st.planned << " duplicate or superseded, " << malformed
+             << " malformed lines) in " << fixed << setprecision(1) << st.millis << " ms: "
+             << setprecision(0) << st.opsPerSec() << " ops/s\n" << defaultfloat;
+        return true;
+    }
+
+    if (cmd == "--import-csv" && (argc == 2 || argc == 3)) {
+        auto start = chrono::steady_clock::now();
+        g.waitForCheckpoint();  // the default target is the live users.snap
+        FileManager source(args[1], true);
+        CsrGraph imported;
+        ThreadPool pool(intOption(opts, "threads", 0));
+        CsvLoadStats stats;
+        if (!source.loadWithHashes(imported, pool, &stats)) return false;
+
+        string target = argc == 3 ? args[2] : source.getSnapshotPath();
+        if (!source.saveSnapshot(imported, {}, target)) return false;
+        cout << "Imported " << imported.vertexCount() << " users, " << imported.edgeCount()
+             << " friendships into " << target << "\n";
+        cout << "Parsed " << stats.rows << " rows (" << stats.malformed << " malformed, "
+             << stats.unresolved << " unresolved friend IDs) in " << fixed << setprecision(1)
+             << stats.millis << " ms: " << setprecision(0) << stats.rowsPerSec() << " rows/s, "
+             << setprecision(1) << stats.megabytesPerSec() << " MB/s using " << pool.size()
+             << " threads (total "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms)\n";
+        return true;
+    }
+
+    if (cmd == "--clear") {
+        g.clear();
+        cout << "Graph cleared.\n";
+        return true;
+    }
+
+    if (cmd == "--exit") {
+        cout << "Exiting...\n";
+        return true;
+    }
+
+    cout << "Unknown command.\n";
+    return false;
+}
+
+// =================== CLUSTER ===================
+
+int runClusterMode(const string& program, const vector<string>& rawArgs) {
+    unordered_map<string, string> opts;
+    vector<string> args = splitOptions(rawArgs, opts);
+    size_t argc = args.size();
+
+    if (args[0] == "--shard" && argc == 3) {
+        int shard = -1;
+        try { shard = stoi(args[2]); } catch (...) { shard = -1; }
+        if (shard >= 0) return runShard(args[1], shard, shardSocketPath(args[1], shard));
+    }
+
+    if (args[0] == "--cluster" && (argc == 2 || (argc == 3 && args[2] == "--attach"))) {
+        ShardCluster cluster;
+        if (!cluster.start(args[1], program, argc == 3)) return 1;
+        ClusterSession session(cluster);
+        string error;
+        if (!session.connect(&error)) {
+            cerr << error << "\n";
+            return 1;
+        }
+        serveCluster(cluster, session);
+        return 0;
+    }
+
+    cout << "Usage: --shard <partition dir> <shard> | --cluster <partition dir> [--attach]\n";
+    return 1;
+}
+
+// A request the cluster could not answer (see ClusterSession::good()).
+static bool clusterError(const ClusterSession& session, ostream& out) {
+    out << "Cluster error: " << session.error() << "\n";
+    return false;
+}
+
+bool runClusterCommand(ShardCluster& cluster, ClusterSession& session, const vector<string>& rawArgs,
+                       ostream& out) {
+    unordered_map<string, string> opts;
+    vector<string> args = splitOptions(rawArgs, opts);
+    const string& cmd = args[0];
+    size_t argc = args.size();
+
+    if (cmd == "--friends" && argc == 2) {
+        auto friends = session.friends(args[1]);
+        if (!session.good()) return clusterError(session, out);
+        printFriends(out, args[1], friends);
+        return true;
+    }
+
+    if (cmd == "--mutual" && argc == 3) {
+        auto mutual = session.mutualFriends(args[1], args[2]);
+        if (!session.good()) return clusterError(session, out);
+        printMutual(out, args[1], args[2], mutual);
+        return true;
+    }
+
+    if (cmd == "--connection" && argc == 3) {
+        bool connected = session.areConnected(args[1], args[2]);
+        if (!session.good()) return clusterError(session, out);
+        out << (connected ? "Connected: Yes" : "Connected: No") << endl;
+        return true;
+    }
+
+    if (cmd == "--recommend" && argc == 2) {
+        ScoreFunction fn = ScoreFunction::PageRankMutual;
+        if (opts.count("score") && !parseScoreFunction(opts["score"], fn)) {
+            out << "Unknown score function: " << opts["score"] << "\n";
+            return false;
+        }
+        // Walks and the MinHash index would need the whole graph in one place.
+        if (fn == ScoreFunction::PersonalizedPageRank || fn == ScoreFunction::SimilarCircles) {
+            out << "Not available in cluster mode.\n";
+            return false;
+        }
+        bool found = false;
+        auto recs = session.recommend(args[1], max(intOption(opts, "k", 3), 0), fn, found);
+        if (!session.good()) return clusterError(session, out);
+        printRecommendations(out, args[1], found, recs);
+        return true;
+    }
+
+    if (cmd == "--pagerank") {
+        if (cluster.userCount() == 0) {
+            out << "Graph is empty.\n";
+            return true;
+        }
+        PageRankOptions prOpts;
+        prOpts.tolerance = doubleOption(opts, "tol", prOpts.tolerance);
+        prOpts.maxIterations = intOption(opts, "max-iter", prOpts.maxIterations);
+        auto result = session.computePageRank(prOpts);
+        if (!session.good()) return clusterError(session, out);
+        out << "\nPageRank computed successfully!\n";
+        out << (result.converged ? "Converged" : "Stopped") << " after " << result.iterations
+            << " iterations (residual " << scientific << setprecision(2) << result.residual
+            << ", " << fixed << setprecision(2) << result.millis << " ms)\n";
+        out << "\n--- PageRank Scores ---\n";
+        if (auto rank = cluster.pageRank())
+            for (uint32_t g = 0; g < rank->size(); ++g)
+                out << cluster.name(g) << ": " << fixed << setprecision(4) << (*rank)[g] << "\n";
+        out << defaultfloat;
+        return true;
+    }
+
+    if (cmd == "--cluster-stats" && argc == 1) {
+        const ShardMeta& meta = cluster.meta();
+        out << "Shards: " << cluster.shardCount() << " (" << partitionSchemeName(meta.scheme) << "), "
+            << meta.globalVertices << " users, " << meta.globalEdges << " friendships\n";
+        for (uint32_t i = 0; i < cluster.shardCount(); ++i) {
+            const ShardInfo& shard = cluster.shard(i);
+            out << "Shard " << i << ": " << shard.owned << " users, " << shard.ghosts.size()
+                << " ghosts, " << shard.boundary.size() << " boundary users\n";
+        }
+        return true;
+    }
+
+    if (cmd == "--exit") {
+        out << "Exiting...\n";
+        return true;
+    }
+
+    out << "Not available in cluster mode.\n";
+    return false;
+}
@@ -0,0 +1,38 @@
+#ifndef COMMANDS_HPP
+#define COMMANDS_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../graph/Graph.hpp"
+#include "../cluster/Coordinator.hpp"
+
+using namespace std;
+
+// Runs one argument-mode command (e.g. {"--friends", "gor"}) against the graph,
+// writing its output to cout. Returns false for unknown/malformed commands.
+// Mutations are only logged; the caller makes them durable with g.save().
+bool runCommand(Graph& g, const vector<string>& args);
+
+// Read-only commands that can also run against a published snapshot on
+// another thread: --friends, --mutual, --path and --recommend.
+bool isSnapshotQuery(const vector<string>& args);
+// Parses a well-formed --recommend request.
+bool parseRecommendQuery(const vector<string>& args, string& user, size_t& topK, ScoreFunction& fn);
+// Runs a snapshot query, writing the same output runCommand would. For
+// --recommend, `recs` (if given) receives the computed list.
+void runQuery(GraphReader& reader, const GraphSnapshot& snap, const vector<string>& args,
+              ostream& out, vector<Recommendation>* recs = nullptr);
+
+// --shard DIR I and --cluster DIR [--attach], which run without loading the
+// graph (see cluster/). `program` is how this executable was invoked, for
+// starting shard processes. Returns the process exit code.
+int runClusterMode(const string& program, const vector<string>& args);
+// One request against a running cluster: --friends, --mutual, --connection,
+// --recommend (pagerank, aa, jaccard and ra scores), --pagerank,
+// --cluster-stats and --exit, with the same output as runCommand. A request
+// the shards could not answer gets "Cluster error: ..." instead.
+bool runClusterCommand(ShardCluster& cluster, ClusterSession& session, const vector<string>& args,
+                       ostream& out);
+
+#endif
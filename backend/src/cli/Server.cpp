@@ -0,0 +1,259 @@
+#include "Server.hpp"
+#include "Commands.hpp"
+#include "../utils/Metrics.hpp"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Upper bound on requests folded into one group commit, so a continuous
+// stream still gets periodic durability and bounded response buffering.
+constexpr size_t MAX_COMMIT_GROUP = 1024;
+
+static vector<string> tokenize(const string& line) {
+    vector<string> tokens;
+    stringstream ss(line);
+    string tok;
+    while (ss >> tok) tokens.push_back(tok);
+    return tokens;
+}
+
+namespace {
+
+// Writes responses in request order as they complete, from any thread.
+class ResponseSequencer {
+private:
+    ostream out;                 // bound to the real output, not to cout
+    mutex m;
+    map<uint64_t, string> done;
+    uint64_t next = 0;
+
+public:
+    explicit ResponseSequencer(streambuf* sink) : out(sink) {}
+
+    void complete(uint64_t seq, string payload) {
+        lock_guard<mutex> lock(m);
+        done.emplace(seq, std::move(payload));
+        bool wrote = false;
+        for (auto it = done.begin(); it != done.end() && it->first == next; it = done.erase(it)) {
+            out << it->second.size() << "\n" << it->second;
+            next++;
+            wrote = true;
+        }
+        if (wrote) out.flush();
+    }
+};
+
+struct QueryTask {
+    uint64_t seq;
+    vector<string> args;
+    shared_ptr<const GraphSnapshot> snap;
+};
+
+// A recommendation computed by a reader, handed back so the writer thread
+// (the only one allowed to touch the cache) can keep it.
+struct FinishedRecommendation {
+    shared_ptr<const GraphSnapshot> snap;
+    string user;
+    size_t topK;
+    ScoreFunction fn;
+    vector<Recommendation> recs;
+};
+
+// Reader threads answering snapshot queries. Each has its own GraphReader
+// scratch; the snapshots themselves are immutable, so there is no lock
+// anywhere on the query path (the queue lock only hands tasks over).
+class QueryWorkers {
+private:
+    ResponseSequencer& responses;
+    vector<thread> threads;
+    mutex m;
+    condition_variable wake, idle;
+    deque<QueryTask> queue;
+    size_t busy = 0;
+    bool stopping = false;
+
+    mutex finishedMutex;
+    vector<FinishedRecommendation> finished;
+
+    void run() {
+        GraphReader reader;
+        ostringstream buffer;
+        for (;;) {
+            QueryTask task;
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                task = std::move(queue.front());
+                queue.pop_front();
+                busy++;
+            }
+
+            buffer.str("");
+            buffer.clear();
+            vector<Recommendation> recs;
+            bool recommend = task.args[0] == "--recommend";
+            {
+                METRIC_TIMER(ServeReadSeconds);
+                runQuery(reader, *task.snap, task.args, buffer, recommend ? &recs : nullptr);
+            }
+
+            // Hand the list back before replying, so a client that waits for
+            // each response finds it cached on its next request.
+            if (recommend) {
+                FinishedRecommendation f{task.snap, "", 0, ScoreFunction::PageRankMutual, std::move(recs)};
+                if (parseRecommendQuery(task.args, f.user, f.topK, f.fn)) {
+                    lock_guard<mutex> lock(finishedMutex);
+                    finished.push_back(std::move(f));
+                }
+            }
+            responses.complete(task.seq, buffer.str());
+
+            lock_guard<mutex> lock(m);
+            if (--busy == 0 && queue.empty()) idle.notify_all();
+        }
+    }
+
+public:
+    QueryWorkers(ResponseSequencer& sequencer, size_t count) : responses(sequencer) {
+        for (size_t i = 0; i < count; ++i) threads.emplace_back([this] { run(); });
+    }
+
+    ~QueryWorkers() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void submit(QueryTask task) {
+        {
+            lock_guard<mutex> lock(m);
+            queue.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    void waitIdle() {
+        unique_lock<mutex> lock(m);
+        idle.wait(lock, [&] { return queue.empty() && busy == 0; });
+    }
+
+    vector<FinishedRecommendation> takeFinished() {
+        lock_guard<mutex> lock(finishedMutex);
+        return std::move(finished);
+    }
+};
+
+} // namespace
+
+bool serve(Graph& g, istream& in, ostream& out) {
+    // Unsynced streams buffer stdin, which lets in_avail() see pipelined requests.
+    ios::sync_with_stdio(false);
+    // cin is tied to cout, so every read would flush stdout from this thread
+    // while a reader thread may be writing a response through the same
+    // buffer (which could then go out twice); only the sequencer flushes it.
+    in.tie(nullptr);
+    g.enableBackgroundCheckpoints();
+
+    ResponseSequencer responses(out.rdbuf());
+    QueryWorkers readers(responses, max(1u, thread::hardware_concurrency()));
+
+    string line;
+    ostringstream buffer;
+    vector<pair<uint64_t, string>> held;   // responses waiting for their mutations to be durable
+    uint64_t seq = 0;
+
+    // A failed commit leaves the graph ahead of the log; fail the group and
+    // stop rather than acknowledge anything that would be lost on restart.
+    bool durable = true;
+    auto commitGroup = [&] {
+        durable = g.save();
+        for (auto& [s, payload] : held)
+            responses.complete(s, durable ? std::move(payload)
+                                          : string("Error: changes could not be saved; shutting down.\n"));
+        held.clear();
+    };
+
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        auto args = tokenize(line);
+        if (args.empty()) continue;
+
+        for (auto& f : readers.takeFinished())
+            g.storeRecommendations(*f.snap, f.user, f.topK, f.fn, f.recs);
+
+        // Reads go to the reader threads against the current version. They
+        // still leave in request order, so a read that follows a write is
+        // only released once that write's group is durable.
+        if (isSnapshotQuery(args)) {
+            string user;
+            size_t topK = 0;
+            ScoreFunction fn = ScoreFunction::PageRankMutual;
+            bool recommend = parseRecommendQuery(args, user, topK, fn);
+            vector<pair<string, double>> cached;
+            if (recommend && g.cachedRecommendations(user, topK, fn, cached)) {
+                buffer.str("");
+                buffer.clear();
+                printRecommendations(buffer, user, true, cached);
+                responses.complete(seq, buffer.str());
+            } else {
+                readers.submit({seq, args, g.publish(recommend && fn == ScoreFunction::PageRankMutual,
+                                                     recommend && fn == ScoreFunction::PersonalizedPageRank)});
+            }
+        } else {
+            // Commands (and Graph itself) print to cout; capture it per request
+            // so the response can be length-prefixed.
+            METRIC_TIMER(ServeWriteSeconds);
+            buffer.str("");
+            buffer.clear();
+            streambuf* old = cout.rdbuf(buffer.rdbuf());
+            if (args[0] == "--serve") cout << "Already serving.\n";
+            // stdin is this request stream: reading a batch from it would
+            // swallow every request after this one.
+            else if (args[0] == "--batch" && args.size() == 2 && args[1] == "-")
+                cout << "--batch - is not available in serve mode; pass a file path.\n";
+            else runCommand(g, args);
+            cout.rdbuf(old);
+            held.push_back({seq, buffer.str()});
+        }
+        seq++;
+
+        // Group commit: while more requests are already waiting, keep going;
+        // once the input drains, one fsync covers the whole batch and the
+        // held responses are released.
+        bool exiting = args[0] == "--exit";
+        if (exiting || held.size() >= MAX_COMMIT_GROUP || in.rdbuf()->in_avail() <= 0)
+            commitGroup();
+        if (exiting || !durable) break;
+    }
+
+    if (durable) commitGroup();
+    readers.waitIdle();
+    return durable;
+}
+
+void serveCluster(ShardCluster& cluster, ClusterSession& session, istream& in, ostream& out) {
+    string line;
+    ostringstream buffer;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        auto args = tokenize(line);
+        if (args.empty()) continue;
+        buffer.str("");
+        buffer.clear();
+        runClusterCommand(cluster, session, args, buffer);
+        out << buffer.str().size() << "\n" << buffer.str();
+        out.flush();
+        if (args[0] == "--exit") break;
+    }
+}
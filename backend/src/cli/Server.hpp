@@ -0,0 +1,31 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <iostream>
+#include "../graph/Graph.hpp"
+#include "../cluster/Coordinator.hpp"
+
+using namespace std;
+
+// Long-lived daemon mode (--serve). The graph is loaded once and requests are
+// answered until EOF or "--exit".
+//
+// Protocol (line-delimited requests, length-prefixed responses):
+//   request : one line of whitespace-separated tokens, same as the CLI args
+//             e.g. "--recommend gor"
+//   response: "<N>\n" followed by exactly N bytes of command output
+//
+// Requests may be pipelined; responses are written in request order.
+// Read-only queries are answered by reader threads from published snapshots
+// while the calling thread applies writes; a response is only released once
+// every mutation before it has been made durable. If that fails, the held
+// responses report the error and serve() returns false without reading on.
+bool serve(Graph& g, istream& in = cin, ostream& out = cout);
+
+// The same protocol in front of a sharded cluster (--cluster): requests
+// are answered one at a time through `session`, see runClusterCommand().
+// The graph is read-only in this mode; mutations go through a single-process
+// instance and a fresh --partition.
+void serveCluster(ShardCluster& cluster, ClusterSession& session, istream& in = cin, ostream& out = cout);
+
+#endif
@@ -0,0 +1,568 @@
+#include "Coordinator.hpp"
+#include "ShardServer.hpp"
+#include "../graph/Intersect.hpp"
+#include "../io/Snapshot.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+using namespace std;
+
+// =================== PROCESSES ===================
+
+bool ShardCluster::start(const string& partitionDir, const string& program, bool attach) {
+    dir = partitionDir;
+    string error;
+    vector<double> unused;
+    if (!readSnapshot(directorySnapshotPath(dir), directory, unused, nullptr, &error) ||
+        !readShardMeta(directoryMetaPath(dir), routing, &error)) {
+        cerr << "Cannot load the partition in " << dir << ": " << error << "\n";
+        return false;
+    }
+    if (routing.shard != SHARD_DIRECTORY || routing.global.size() != directory.vertexSlots()) {
+        cerr << directoryMetaPath(dir) << " does not match " << directorySnapshotPath(dir) << "\n";
+        return false;
+    }
+
+    uint32_t count = routing.shardCount;
+    shards.assign(count, {});
+    ownedBy.assign(count, {});
+    for (uint32_t g = 0; g < routing.owner.size(); ++g) ownedBy[routing.owner[g]].push_back(g);
+
+    if (!attach)
+        for (uint32_t i = 0; i < count; ++i) {
+            remove(shardSocketPath(dir, i).c_str());   // never attach to a leftover shard by mistake
+            if (!spawn(program, i)) {
+                stop();
+                return false;
+            }
+        }
+
+    // Introductions: learn each shard's ghosts, then tell every shard which
+    // of its users the others hold as ghosts.
+    vector<UnixSocket> links(count);
+    WireWriter request;
+    string reply;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!waitForShard(i, links[i])) {
+            stop();
+            return false;
+        }
+        request.clear();
+        request.put<uint8_t>((uint8_t)ShardOp::Hello);
+        if (!links[i].send(request.data()) || !links[i].receive(reply)) {
+            cerr << "Shard " << i << " did not answer\n";
+            stop();
+            return false;
+        }
+        WireReader in(reply);
+        uint32_t index = in.get<uint32_t>(), total = in.get<uint32_t>();
+        uint64_t users = in.get<uint64_t>();
+        shards[i].owned = in.get<uint64_t>();
+        shards[i].ghosts = in.getArray<uint32_t>();
+        if (!in.good() || index != i || total != count || users != routing.globalVertices ||
+            shards[i].owned != ownedBy[i].size()) {
+            cerr << "Shard " << i << " is serving a different partition than " << dir << "\n";
+            stop();
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < count; ++i)
+        for (uint32_t g : shards[i].ghosts) shards[routing.owner[g]].boundary.push_back(g);
+    for (uint32_t i = 0; i < count; ++i) {
+        auto& b = shards[i].boundary;
+        sort(b.begin(), b.end());
+        b.erase(unique(b.begin(), b.end()), b.end());
+        request.clear();
+        request.put<uint8_t>((uint8_t)ShardOp::SetBoundary);
+        request.putArray(b);
+        if (!links[i].send(request.data()) || !links[i].receive(reply)) {
+            cerr << "Shard " << i << " did not answer\n";
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef _WIN32
+
+bool ShardCluster::spawn(const string&, uint32_t) {
+    cerr << "Shard processes are not supported on this platform\n";
+    return false;
+}
+
+void ShardCluster::stop() {}
+
+#else
+
+bool ShardCluster::spawn(const string& program, uint32_t shard) {
+    string index = to_string(shard);
+    pid_t pid = fork();
+    if (pid < 0) {
+        cerr << "Cannot start shard " << shard << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    if (pid == 0) {
+#ifdef __linux__
+        prctl(PR_SET_PDEATHSIG, SIGTERM);   // don't outlive the coordinator
+#endif
+        dup2(STDERR_FILENO, STDOUT_FILENO);  // stdout may be the coordinator's protocol stream
+        const char* argv[] = {program.c_str(), "--shard", dir.c_str(), index.c_str(), nullptr};
+        execvp(program.c_str(), (char* const*)argv);
+        fprintf(stderr, "Cannot run %s: %s\n", program.c_str(), strerror(errno));
+        _exit(127);
+    }
+    shards[shard].pid = pid;
+    return true;
+}
+
+void ShardCluster::stop() {
+    WireWriter request;
+    request.put<uint8_t>((uint8_t)ShardOp::Shutdown);
+    string reply;
+    for (auto& shard : shards) {
+        if (!shard.pid) continue;
+        uint32_t i = &shard - shards.data();
+        UnixSocket link = UnixSocket::connect(shardSocketPath(dir, i));
+        if (!link.isOpen() || !link.send(request.data()) || !link.receive(reply)) kill(shard.pid, SIGTERM);
+        waitpid(shard.pid, nullptr, 0);
+        shard.pid = 0;
+    }
+}
+
+#endif
+
+// A started shard is polled until it listens (loading a large shard takes a
+// moment); an attached one must already be there.
+bool ShardCluster::waitForShard(uint32_t shard, UnixSocket& link) {
+    string path = shardSocketPath(dir, shard), error;
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(SHARD_START_SECONDS);
+    while (true) {
+        link = UnixSocket::connect(path, &error);
+        if (link.isOpen()) return true;
+        if (!shards[shard].pid || chrono::steady_clock::now() > deadline) break;
+#ifndef _WIN32
+        if (waitpid(shards[shard].pid, nullptr, WNOHANG) == shards[shard].pid) {
+            shards[shard].pid = 0;
+            cerr << "Shard " << shard << " exited during startup\n";
+            return false;
+        }
+#endif
+        this_thread::sleep_for(chrono::milliseconds(20));
+    }
+    cerr << "Shard " << shard << " is not serving: " << error << "\n";
+    return false;
+}
+
+shared_ptr<const vector<double>> ShardCluster::pageRank() {
+    lock_guard lock(computeLock);
+    return ranks;
+}
+
+// =================== SESSION ===================
+
+bool ClusterSession::connect(string* error) {
+    links.clear();
+    for (uint32_t i = 0; i < cluster.shardCount(); ++i) {
+        UnixSocket link = UnixSocket::connect(shardSocketPath(cluster.dir, i), error);
+        if (!link.isOpen()) {
+            links.clear();
+            return false;
+        }
+        links.push_back(std::move(link));
+    }
+    replies.resize(links.size());
+    failure.clear();
+    return true;
+}
+
+// Every public request starts here: clears the last failure and, after one,
+// reconnects.
+bool ClusterSession::ready() {
+    failure.clear();
+    if (!links.empty()) return true;
+    string error;
+    if (connect(&error)) return true;
+    return fail("Cannot reach the shards: " + error);
+}
+
+// Closing every link drops the replies still on their way, so the next
+// request starts in step with all shards. Keeps the first reason.
+bool ClusterSession::fail(const string& why) {
+    if (failure.empty()) {
+        failure = why;
+        cerr << why << "\n";
+    }
+    links.clear();
+    return false;
+}
+
+bool ClusterSession::send(uint32_t shard) {
+    if (!good()) return false;
+    if (links[shard].send(request.data())) return true;
+    return fail("Lost connection to shard " + to_string(shard));
+}
+
+bool ClusterSession::receive(uint32_t shard) {
+    if (!good()) return false;
+    if (links[shard].receive(replies[shard])) return true;
+    return fail("Lost connection to shard " + to_string(shard));
+}
+
+bool ClusterSession::malformed(uint32_t shard) {
+    return fail("Malformed reply from shard " + to_string(shard));
+}
+
+uint32_t ClusterSession::find(const string& user) const {
+    return cluster.directory.find(user);
+}
+
+vector<uint32_t> ClusterSession::friendIds(uint32_t user) {
+    uint32_t owner = cluster.routing.owner[user];
+    request.clear();
+    request.put<uint8_t>((uint8_t)ShardOp::Friends);
+    request.put<uint32_t>(user);
+    if (!call(owner)) return {};
+    WireReader in(replies[owner]);
+    vector<uint32_t> ids = in.getArray<uint32_t>();
+    if (!in.good()) {
+        malformed(owner);
+        return {};
+    }
+    return ids;
+}
+
+vector<string> ClusterSession::names(const vector<uint32_t>& users) const {
+    vector<string> out;
+    out.reserve(users.size());
+    for (uint32_t g : users) out.emplace_back(cluster.name(g));
+    return out;
+}
+
+// =================== QUERIES ===================
+
+vector<string> ClusterSession::friends(const string& user) {
+    if (!ready()) return {};
+    uint32_t g = find(user);
+    return g == INVALID_VERTEX ? vector<string>{} : names(friendIds(g));
+}
+
+// Both users on one shard: one round trip. Otherwise both friend lists come
+// back (in parallel) and are intersected here.
+vector<string> ClusterSession::mutualFriends(const string& u1, const string& u2) {
+    if (!ready()) return {};
+    uint32_t a = find(u1), b = find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX) return {};
+    uint32_t oa = cluster.routing.owner[a], ob = cluster.routing.owner[b];
+    if (oa == ob) {
+        request.clear();
+        request.put<uint8_t>((uint8_t)ShardOp::Mutual);
+        request.put<uint32_t>(a);
+        request.put<uint32_t>(b);
+        if (!call(oa)) return {};
+        WireReader in(replies[oa]);
+        vector<uint32_t> common = in.getArray<uint32_t>();
+        if (!in.good()) {
+            malformed(oa);
+            return {};
+        }
+        return names(common);
+    }
+
+    for (auto [user, owner] : {pair{a, oa}, pair{b, ob}}) {
+        request.clear();
+        request.put<uint8_t>((uint8_t)ShardOp::Friends);
+        request.put<uint32_t>(user);
+        if (!send(owner)) return {};
+    }
+    if (!receive(oa) || !receive(ob)) return {};
+    WireReader inA(replies[oa]), inB(replies[ob]);
+    vector<uint32_t> fa = inA.getArray<uint32_t>(), fb = inB.getArray<uint32_t>(), common;
+    if (!inA.good() || !inB.good()) {
+        malformed(inA.good() ? ob : oa);
+        return {};
+    }
+    intersectSorted(fa, fb, common);
+    return names(common);
+}
+
+bool ClusterSession::areConnected(const string& u1, const string& u2) {
+    if (!ready()) return false;
+    uint32_t a = find(u1), b = find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX) return false;
+    auto labels = currentLabels();
+    return labels && (*labels)[a] == (*labels)[b];
+}
+
+// Recommender::recommend() with the friends-of-friends walk split by the
+// owner of each friend: every shard counts (and weighs) the candidates
+// reachable through the friends it owns, and the partial sums are added
+// here. Scores and ties then come out as in one process.
+vector<pair<string, double>> ClusterSession::recommend(const string& user, size_t topK, ScoreFunction fn,
+                                                       bool& found) {
+    vector<pair<string, double>> result;
+    found = false;
+    if (!ready()) return result;
+    uint32_t u = find(user);
+    found = u != INVALID_VERTEX;
+    if (!found) return result;
+    shared_ptr<const vector<double>> rank;
+    if (fn == ScoreFunction::PageRankMutual && !(rank = currentRanks())) {
+        fail("PageRank is not available");
+        return result;
+    }
+
+    size_t n = cluster.userCount();
+    if (mutual.size() < n) {
+        mutual.resize(n, 0);
+        weight.resize(n, 0);
+        excluded.resize(n, 0);
+    }
+    vector<uint32_t> friends = friendIds(u);
+    if (!good()) return result;
+    vector<vector<uint32_t>> via(links.size());
+    for (uint32_t f : friends) via[cluster.routing.owner[f]].push_back(f);
+
+    for (uint32_t s = 0; s < via.size(); ++s) {
+        if (via[s].empty()) continue;
+        request.clear();
+        request.put<uint8_t>((uint8_t)ShardOp::TwoHop);
+        request.put<uint8_t>((uint8_t)fn);
+        request.putArray(via[s]);
+        if (!send(s)) return result;
+    }
+    excluded[u] = 1;
+    for (uint32_t f : friends) excluded[f] = 1;
+    for (uint32_t s = 0; s < via.size(); ++s) {
+        if (via[s].empty()) continue;
+        if (!receive(s)) break;
+        WireReader in(replies[s]);
+        auto candidates = in.getArray<uint32_t>();
+        auto counts = in.getArray<uint32_t>();
+        auto weights = in.getArray<uint64_t>();
+        if (!in.good() || counts.size() != candidates.size() || weights.size() != candidates.size()) {
+            malformed(s);
+            break;
+        }
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            uint32_t c = candidates[i];
+            if (excluded[c]) continue;
+            if (mutual[c] == 0) touched.push_back(c);
+            mutual[c] += counts[i];
+            weight[c] += weights[i];
+        }
+    }
+
+    // Scratch is reset even after a failure; only then is the result dropped.
+    vector<Recommendation> out;
+    out.reserve(touched.size());
+    for (uint32_t c : touched) {
+        double score = 0.0;
+        switch (fn) {
+            case ScoreFunction::PageRankMutual:
+                score = mutual[c] * (*rank)[c];
+                break;
+            case ScoreFunction::Jaccard:
+                score = (double)mutual[c] / (friends.size() + cluster.routing.degree[c] - mutual[c]);
+                break;
+            default:
+                score = weight[c] * WEIGHT_UNIT;
+        }
+        if (score > 0) out.push_back({c, score});
+        mutual[c] = 0;
+        weight[c] = 0;
+    }
+    touched.clear();
+    excluded[u] = 0;
+    for (uint32_t f : friends) excluded[f] = 0;
+    if (!good()) return result;
+
+    keepTopK(out, topK);
+    for (auto& r : out) result.emplace_back(cluster.name(r.vertex), r.score);
+    return result;
+}
+
+// =================== DISTRIBUTED PASSES ===================
+
+shared_ptr<const vector<double>> ClusterSession::currentRanks() {
+    lock_guard lock(cluster.computeLock);
+    if (!cluster.ranks) runPageRank({});
+    return cluster.ranks;
+}
+
+shared_ptr<const vector<uint32_t>> ClusterSession::currentLabels() {
+    lock_guard lock(cluster.computeLock);
+    if (!cluster.labels) runComponents();
+    return cluster.labels;
+}
+
+PageRankResult ClusterSession::computePageRank(const PageRankOptions& opts) {
+    if (!ready()) return {};
+    lock_guard lock(cluster.computeLock);
+    return runPageRank(opts);
+}
+
+size_t ClusterSession::computeComponents() {
+    if (!ready()) return 0;
+    lock_guard lock(cluster.computeLock);
+    return runComponents();
+}
+
+// computePageRank() with the vertex ranges split by shard. Between sweeps
+// only boundary values travel: `value` holds the latest rank/degree of
+// every boundary user, from which each shard's ghost values are gathered.
+PageRankResult ClusterSession::runPageRank(const PageRankOptions& opts) {
+    auto start = chrono::steady_clock::now();
+    PageRankResult result;
+    size_t N = cluster.userCount();
+    uint32_t S = links.size();
+    if (N == 0 || !good()) return result;
+
+    vector<double> value(N, 0.0);
+    double dangling = 0.0;
+    auto gather = [&](uint32_t s, WireReader& in) {
+        dangling += in.get<double>();
+        auto contrib = in.getArray<double>();
+        const auto& boundary = cluster.shards[s].boundary;
+        if (!in.good() || contrib.size() != boundary.size()) return malformed(s);
+        for (size_t i = 0; i < boundary.size(); ++i) value[boundary[i]] = contrib[i];
+        return true;
+    };
+
+    request.clear();
+    request.put<uint8_t>((uint8_t)ShardOp::RankStart);
+    request.put<double>(1.0 / N);
+    for (uint32_t s = 0; s < S; ++s)
+        if (!send(s)) return result;
+    for (uint32_t s = 0; s < S; ++s) {
+        if (!receive(s)) return result;
+        WireReader in(replies[s]);
+        if (!gather(s, in)) return result;
+    }
+
+    const double d = opts.damping;
+    for (int it = 0; it < opts.maxIterations; ++it) {
+        double base = (1.0 - d) / N + d * dangling / N;
+        for (uint32_t s = 0; s < S; ++s) {
+            request.clear();
+            request.put<uint8_t>((uint8_t)ShardOp::RankStep);
+            request.put<double>(base);
+            request.put<double>(d);
+            request.put<uint32_t>(cluster.shards[s].ghosts.size());
+            for (uint32_t g : cluster.shards[s].ghosts) request.put<double>(value[g]);
+            if (!send(s)) return result;
+        }
+        dangling = 0.0;
+        result.residual = 0.0;
+        for (uint32_t s = 0; s < S; ++s) {
+            if (!receive(s)) return result;
+            WireReader in(replies[s]);
+            result.residual += in.get<double>();
+            if (!gather(s, in)) return result;
+        }
+        result.iterations = it + 1;
+        if (result.residual < opts.tolerance) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    request.clear();
+    request.put<uint8_t>((uint8_t)ShardOp::Ranks);
+    for (uint32_t s = 0; s < S; ++s)
+        if (!send(s)) return result;
+    auto ranks = make_shared<vector<double>>(N, 0.0);
+    for (uint32_t s = 0; s < S; ++s) {
+        if (!receive(s)) return result;
+        WireReader in(replies[s]);
+        auto owned = in.getArray<double>();
+        const auto& ids = cluster.ownedBy[s];
+        if (!in.good() || owned.size() != ids.size()) {
+            malformed(s);
+            return result;
+        }
+        for (size_t i = 0; i < ids.size(); ++i) (*ranks)[ids[i]] = owned[i];
+    }
+    cluster.ranks = std::move(ranks);
+    result.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+size_t ClusterSession::runComponents() {
+    size_t N = cluster.userCount();
+    uint32_t S = links.size();
+    if (!good()) return 0;
+    vector<uint32_t> value(N);
+    bool changed = false;
+    auto gather = [&](uint32_t s, WireReader& in) {
+        auto labels = in.getArray<uint32_t>();
+        const auto& boundary = cluster.shards[s].boundary;
+        if (!in.good() || labels.size() != boundary.size()) return malformed(s);
+        for (size_t i = 0; i < boundary.size(); ++i) value[boundary[i]] = labels[i];
+        return true;
+    };
+
+    request.clear();
+    request.put<uint8_t>((uint8_t)ShardOp::LabelStart);
+    for (uint32_t s = 0; s < S; ++s)
+        if (!send(s)) return 0;
+    for (uint32_t s = 0; s < S; ++s) {
+        if (!receive(s)) return 0;
+        WireReader in(replies[s]);
+        if (!gather(s, in)) return 0;
+    }
+
+    // Labels only drop, so once a round changes nothing anywhere every
+    // component carries its smallest global ID.
+    size_t rounds = 0;
+    do {
+        rounds++;
+        for (uint32_t s = 0; s < S; ++s) {
+            request.clear();
+            request.put<uint8_t>((uint8_t)ShardOp::LabelStep);
+            request.put<uint32_t>(cluster.shards[s].ghosts.size());
+            for (uint32_t g : cluster.shards[s].ghosts) request.put<uint32_t>(value[g]);
+            if (!send(s)) return 0;
+        }
+        changed = false;
+        for (uint32_t s = 0; s < S; ++s) {
+            if (!receive(s)) return 0;
+            WireReader in(replies[s]);
+            changed |= in.get<uint8_t>() != 0;
+            if (!gather(s, in)) return 0;
+        }
+    } while (changed);
+
+    request.clear();
+    request.put<uint8_t>((uint8_t)ShardOp::Labels);
+    for (uint32_t s = 0; s < S; ++s)
+        if (!send(s)) return 0;
+    auto labels = make_shared<vector<uint32_t>>(N, 0);
+    for (uint32_t s = 0; s < S; ++s) {
+        if (!receive(s)) return 0;
+        WireReader in(replies[s]);
+        auto owned = in.getArray<uint32_t>();
+        const auto& ids = cluster.ownedBy[s];
+        if (!in.good() || owned.size() != ids.size()) {
+            malformed(s);
+            return 0;
+        }
+        for (size_t i = 0; i < ids.size(); ++i) (*labels)[ids[i]] = owned[i];
+    }
+    cluster.labels = std::move(labels);
+    return rounds;
+}
@@ -0,0 +1,138 @@
+#ifndef COORDINATOR_HPP
+#define COORDINATOR_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Partition.hpp"
+#include "Wire.hpp"
+#include "../graph/PageRank.hpp"
+#include "../graph/Recommender.hpp"
+
+using namespace std;
+
+// How long start() waits for a shard to accept connections.
+constexpr int SHARD_START_SECONDS = 60;
+
+struct ShardInfo {
+    size_t owned = 0;
+    vector<uint32_t> ghosts;       // global IDs, as the shard lists them
+    vector<uint32_t> boundary;     // owned users that are ghosts elsewhere
+    long pid = 0;                  // process started by us; 0 when attached
+};
+
+class ClusterSession;
+
+// The --cluster coordinator's view of a partition (see Partition.hpp): the
+// shard processes, plus the user directory used to route by name. Only
+// adjacency is sharded; the coordinator keeps O(users) per-user values (names,
+// owners, degrees, and PageRank and component labels once computed) so it
+// can route and merge without asking the shards.
+class ShardCluster {
+private:
+    string dir;
+    CsrGraph directory;            // every user, no edges; vertex ID = global ID
+    ShardMeta routing;             // owner and full degree per global ID
+    vector<ShardInfo> shards;
+    vector<vector<uint32_t>> ownedBy;   // per shard, ascending
+
+    // One distributed computation at a time; results are replaced whole, so
+    // a session keeps using the vector it picked up.
+    mutex computeLock;
+    shared_ptr<const vector<double>> ranks;
+    shared_ptr<const vector<uint32_t>> labels;
+
+    bool spawn(const string& program, uint32_t shard);
+    bool waitForShard(uint32_t shard, UnixSocket& link);
+
+    friend class ClusterSession;
+
+public:
+    ShardCluster() = default;
+    ~ShardCluster() { stop(); }
+    ShardCluster(const ShardCluster&) = delete;
+    ShardCluster& operator=(const ShardCluster&) = delete;
+
+    // Starts `program --shard DIR I` for every shard of the partition in
+    // `dir`, or with `attach` connects to shards already serving there.
+    bool start(const string& partitionDir, const string& program, bool attach);
+    // Asks the shards we started to exit and reaps them.
+    void stop();
+
+    size_t shardCount() const { return shards.size(); }
+    size_t userCount() const { return routing.globalVertices; }
+    const ShardInfo& shard(uint32_t i) const { return shards[i]; }
+    const ShardMeta& meta() const { return routing; }
+    string_view name(uint32_t global) const { return directory.name(global); }
+    // Last computed PageRank by global ID; null until a session computed one.
+    shared_ptr<const vector<double>> pageRank();
+};
+
+// One client of the cluster: a connection to every shard plus query
+// scratch. Sessions are independent, so each client thread opens its own;
+// a single session must not be shared between threads.
+//
+// Replies are matched to requests by order, so a request that loses a shard
+// (or gets a malformed reply) closes every link rather than leave replies
+// unread on the others. It then reports empty results with good() false,
+// and the next request reconnects first, failing the same way for as long
+// as a shard stays unreachable.
+class ClusterSession {
+private:
+    ShardCluster& cluster;
+    vector<UnixSocket> links;      // empty while disconnected
+    WireWriter request;
+    vector<string> replies;
+    string failure;                // why the last request failed
+
+    // recommend() scratch, indexed by global ID (see Recommender).
+    vector<uint32_t> mutual;
+    vector<uint64_t> weight;
+    vector<uint8_t> excluded;
+    vector<uint32_t> touched;
+
+    bool ready();
+    bool fail(const string& why);
+    bool send(uint32_t shard);
+    bool receive(uint32_t shard);
+    bool call(uint32_t shard) { return send(shard) && receive(shard); }
+    bool malformed(uint32_t shard);
+    uint32_t find(const string& user) const;
+    vector<uint32_t> friendIds(uint32_t user);
+    vector<string> names(const vector<uint32_t>& users) const;
+    shared_ptr<const vector<double>> currentRanks();
+    shared_ptr<const vector<uint32_t>> currentLabels();
+    // The exchanges themselves; the caller holds cluster.computeLock.
+    PageRankResult runPageRank(const PageRankOptions& opts);
+    size_t runComponents();
+
+public:
+    explicit ClusterSession(ShardCluster& c) : cluster(c) {}
+    bool connect(string* error = nullptr);
+
+    // False if the last request failed; its result is then empty.
+    bool good() const { return failure.empty(); }
+    const string& error() const { return failure; }
+
+    // Same answers as the Graph methods of the same names.
+    vector<string> friends(const string& user);
+    vector<string> mutualFriends(const string& u1, const string& u2);
+    bool areConnected(const string& u1, const string& u2);
+    // PageRankMutual, AdamicAdar, Jaccard and ResourceAllocation; `found` is
+    // false for an unknown user.
+    vector<pair<string, double>> recommend(const string& user, size_t topK, ScoreFunction fn, bool& found);
+
+    // Power iteration across the shards: each sweep sends every shard the
+    // rank/degree of its ghosts and gets back that of its boundary users.
+    // Replaces the ranks recommend() uses (a failed run leaves them as they
+    // were).
+    PageRankResult computePageRank(const PageRankOptions& opts = {});
+    // Component labels by min-label exchange: each shard merges its local
+    // union-find sets with the labels of its ghosts until a round changes
+    // nothing. Returns the number of rounds.
+    size_t computeComponents();
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "Partition.hpp"
+#include "../io/AtomicFile.hpp"
+#include "../io/MappedFile.hpp"
+#include "../io/Snapshot.hpp"
+#include "../utils/Utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+
+bool parsePartitionScheme(const string& name, PartitionScheme& out) {
+    if (name == "hash") out = PartitionScheme::Hash;
+    else if (name == "label-propagation" || name == "lp") out = PartitionScheme::LabelPropagation;
+    else return false;
+    return true;
+}
+
+const char* partitionSchemeName(PartitionScheme scheme) {
+    switch (scheme) {
+        case PartitionScheme::Hash: return "hash";
+        case PartitionScheme::LabelPropagation: return "label-propagation";
+    }
+    return "?";
+}
+
+string shardSnapshotPath(const string& dir, uint32_t shard) {
+    return (filesystem::path(dir) / ("shard-" + to_string(shard) + ".snap")).string();
+}
+string shardMetaPath(const string& dir, uint32_t shard) {
+    return (filesystem::path(dir) / ("shard-" + to_string(shard) + ".meta")).string();
+}
+string shardSocketPath(const string& dir, uint32_t shard) {
+    return (filesystem::path(dir) / ("shard-" + to_string(shard) + ".sock")).string();
+}
+string directorySnapshotPath(const string& dir) { return (filesystem::path(dir) / "directory.snap").string(); }
+string directoryMetaPath(const string& dir) { return (filesystem::path(dir) / "directory.meta").string(); }
+
+// =================== ASSIGNMENT ===================
+
+// Starts from the hash assignment and sweeps the users in order, moving each
+// to the shard most of its friends are on if that shard has room. A sweep
+// that moves almost nobody ends it early. Cheap and greedy: it finds the
+// communities a social graph has, not a minimum cut.
+static void propagateLabels(const CsrGraph& graph, uint32_t shards, vector<uint32_t>& owner) {
+    size_t users = graph.vertexCount();
+    size_t capacity = (size_t)ceil((double)users / shards * (1.0 + LP_SLACK));
+    vector<size_t> load(shards, 0);
+    for (uint32_t s : owner)
+        if (s != INVALID_VERTEX) load[s]++;
+
+    vector<uint32_t> count(shards, 0);
+    vector<uint32_t> seen;
+    for (int round = 0; round < LP_ROUNDS; ++round) {
+        size_t moved = 0;
+        for (VertexId v = 0; v < owner.size(); ++v) {
+            if (owner[v] == INVALID_VERTEX) continue;
+            for (VertexId f : graph.neighbors(v))
+                if (count[owner[f]]++ == 0) seen.push_back(owner[f]);
+
+            uint32_t from = owner[v], best = from;
+            // Only a strict majority over the current shard moves a user.
+            for (uint32_t s : seen) {
+                bool better = count[s] > count[best] || (count[s] == count[best] && best != from && s < best);
+                if (s != from && better && load[s] < capacity) best = s;
+            }
+            for (uint32_t s : seen) count[s] = 0;
+            seen.clear();
+            if (best == from) continue;
+            load[from]--;
+            load[best]++;
+            owner[v] = best;
+            moved++;
+        }
+        if (moved <= users / 1000) break;
+    }
+}
+
+vector<uint32_t> partitionVertices(const CsrGraph& graph, uint32_t shards, PartitionScheme scheme) {
+    vector<uint32_t> owner(graph.vertexSlots(), INVALID_VERTEX);
+    for (VertexId v = 0; v < owner.size(); ++v)
+        if (graph.isAlive(v)) owner[v] = userIdHash(graph.name(v)) % shards;
+    if (scheme == PartitionScheme::LabelPropagation && shards > 1) propagateLabels(graph, shards, owner);
+    return owner;
+}
+
+// =================== FILES ===================
+
+static bool writeMeta(const string& path, ShardHeader header, const vector<uint32_t>& global,
+                      const vector<uint32_t>& owner, const vector<uint32_t>& degree) {
+    AtomicFile file(path);
+    if (!file.isOpen()) {
+        cerr << "Cannot write " << path << "\n";
+        return false;
+    }
+    memcpy(header.magic, SHARD_MAGIC, sizeof(header.magic));
+    header.version = SHARD_VERSION;
+    header.localVertices = global.size();
+    file.write(&header, sizeof(header));
+    for (const auto* column : {&global, &owner, &degree})
+        file.write(column->data(), column->size() * sizeof(uint32_t));
+    if (!file.commit()) {
+        cerr << "Error writing " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool readShardMeta(const string& path, ShardMeta& meta, string* error) {
+    auto fail = [&](const string& msg) {
+        if (error) *error = msg;
+        return false;
+    };
+    auto file = MappedFile::open(path);
+    if (!file) return fail("cannot open " + path);
+    ShardHeader header;
+    if (file->size() < sizeof(header)) return fail(path + " is truncated");
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, SHARD_MAGIC, sizeof(header.magic)) != 0) return fail(path + " is not a shard file");
+    if (header.version != SHARD_VERSION) return fail(path + " has unsupported version " + to_string(header.version));
+    uint64_t L = header.localVertices;
+    if (file->size() != sizeof(header) + 3 * L * sizeof(uint32_t)) return fail(path + " is truncated");
+
+    const uint32_t* columns = (const uint32_t*)(file->data() + sizeof(header));
+    meta.shard = header.shard;
+    meta.shardCount = header.shardCount;
+    meta.scheme = (PartitionScheme)header.scheme;
+    meta.globalVertices = header.globalVertices;
+    meta.ownedVertices = header.ownedVertices;
+    meta.globalEdges = header.globalEdges;
+    meta.global.assign(columns, columns + L);
+    meta.owner.assign(columns + L, columns + 2 * L);
+    meta.degree.assign(columns + 2 * L, columns + 3 * L);
+    for (uint64_t l = 0; l < L; ++l)
+        if (meta.global[l] >= header.globalVertices || (l && meta.global[l] <= meta.global[l - 1]) ||
+            meta.owner[l] >= header.shardCount)
+            return fail(path + " is corrupt");
+    return true;
+}
+
+bool writePartition(const string& dir, const CsrGraph& graph, const vector<uint32_t>& owner,
+                    uint32_t shards, PartitionScheme scheme, PartitionStats& stats) {
+    auto start = chrono::steady_clock::now();
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    if (ec) {
+        cerr << "Cannot create " << dir << ": " << ec.message() << "\n";
+        return false;
+    }
+
+    size_t slots = graph.vertexSlots();
+    vector<uint32_t> global(slots, INVALID_VERTEX);
+    vector<VertexId> order;   // global -> vertex
+    order.reserve(graph.vertexCount());
+    for (VertexId v = 0; v < slots; ++v)
+        if (graph.isAlive(v)) { global[v] = order.size(); order.push_back(v); }
+
+    stats = {};
+    stats.users = order.size();
+    stats.edges = graph.edgeCount();
+    stats.owned.assign(shards, 0);
+    stats.ghosts.assign(shards, 0);
+    for (VertexId v : order) {
+        stats.owned[owner[v]]++;
+        for (VertexId f : graph.neighbors(v))
+            if (v < f && owner[v] != owner[f]) stats.cutEdges++;
+    }
+
+    ShardHeader header{};
+    header.shardCount = shards;
+    header.scheme = (uint32_t)scheme;
+    header.globalVertices = order.size();
+    header.globalEdges = graph.edgeCount();
+
+    // The directory: everyone, no edges.
+    {
+        StringArena names, ids;
+        vector<uint32_t> globals(order.size()), owners(order.size()), degrees(order.size());
+        for (uint32_t g = 0; g < order.size(); ++g) {
+            names.add(graph.name(order[g]));
+            ids.add(graph.id(order[g]));
+            globals[g] = g;
+            owners[g] = owner[order[g]];
+            degrees[g] = graph.degree(order[g]);
+        }
+        CsrGraph directory;
+        directory.build(std::move(names), std::move(ids), {});
+        header.shard = SHARD_DIRECTORY;
+        header.ownedVertices = order.size();
+        if (!writeSnapshot(directorySnapshotPath(dir), directory, {}) ||
+            !writeMeta(directoryMetaPath(dir), header, globals, owners, degrees))
+            return false;
+    }
+
+    vector<VertexId> local(slots, INVALID_VERTEX);
+    for (uint32_t s = 0; s < shards; ++s) {
+        // Owned users and their neighbors, in global order.
+        for (VertexId v : order)
+            if (owner[v] == s) {
+                local[v] = 0;
+                for (VertexId f : graph.neighbors(v)) local[f] = 0;
+            }
+        vector<VertexId> members;
+        for (VertexId v : order)
+            if (local[v] != INVALID_VERTEX) { local[v] = members.size(); members.push_back(v); }
+
+        StringArena names, ids;
+        vector<uint32_t> globals, owners, degrees;
+        vector<pair<VertexId, VertexId>> edges;
+        for (VertexId v : members) {
+            names.add(graph.name(v));
+            ids.add(graph.id(v));
+            globals.push_back(global[v]);
+            owners.push_back(owner[v]);
+            degrees.push_back(graph.degree(v));
+            if (owner[v] != s) {
+                stats.ghosts[s]++;
+                continue;
+            }
+            for (VertexId f : graph.neighbors(v))
+                if (owner[f] != s || v < f) edges.emplace_back(local[v], local[f]);
+        }
+        for (VertexId v : members) local[v] = INVALID_VERTEX;
+
+        CsrGraph shard;
+        shard.build(std::move(names), std::move(ids), edges);
+        header.shard = s;
+        header.ownedVertices = stats.owned[s];
+        if (!writeSnapshot(shardSnapshotPath(dir, s), shard, {}) ||
+            !writeMeta(shardMetaPath(dir, s), header, globals, owners, degrees))
+            return false;
+    }
+
+    stats.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef PARTITION_HPP
+#define PARTITION_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../graph/CsrGraph.hpp"
+
+using namespace std;
+
+enum class PartitionScheme : uint32_t {
+    Hash,               // owner = hash of the username, so any process can route without a table
+    LabelPropagation    // users drift to their friends' shard, within a size cap
+};
+
+// Accepts "hash" and "label-propagation"/"lp".
+bool parsePartitionScheme(const string& name, PartitionScheme& out);
+const char* partitionSchemeName(PartitionScheme scheme);
+
+// Label propagation sweeps at most this many times over the users, and lets
+// a shard grow to (1 + LP_SLACK) x its fair share.
+constexpr int LP_ROUNDS = 10;
+constexpr double LP_SLACK = 0.05;
+
+// Shard of every vertex slot (INVALID_VERTEX for removed ones).
+vector<uint32_t> partitionVertices(const CsrGraph& graph, uint32_t shards, PartitionScheme scheme);
+
+// Layout of a partition directory, as written by writePartition():
+//
+//   directory.snap + directory.meta   every user with no edges: names, IDs,
+//                                     owners and full degrees for routing
+//   shard-I.snap + shard-I.meta       shard I's owned users plus their
+//                                     "ghost" neighbors owned elsewhere
+//   shard-I.sock                      where shard I listens (see ShardServer.hpp)
+//
+// Users get global IDs 0..V-1 in vertex order (the order writeSnapshot()
+// renumbers them in, so ties break the same way as in one process). A shard
+// snapshot lists its users in global order; its rows hold the edges with an
+// owned endpoint, so an owned user's row is complete and a ghost's row only
+// points back into the shard.
+string shardSnapshotPath(const string& dir, uint32_t shard);
+string shardMetaPath(const string& dir, uint32_t shard);
+string shardSocketPath(const string& dir, uint32_t shard);
+string directorySnapshotPath(const string& dir);
+string directoryMetaPath(const string& dir);
+
+//   ShardHeader        64 bytes
+//   uint32 global[L]   ascending
+//   uint32 owner[L]
+//   uint32 degree[L]   in the whole graph
+constexpr char SHARD_MAGIC[8] = {'S', 'G', 'S', 'H', 'A', 'R', 'D', 0};
+constexpr uint32_t SHARD_VERSION = 1;
+constexpr uint32_t SHARD_DIRECTORY = UINT32_MAX;   // ShardHeader::shard of directory.meta
+
+struct ShardHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t shard;
+    uint32_t shardCount;
+    uint32_t scheme;
+    uint64_t globalVertices;
+    uint64_t localVertices;
+    uint64_t ownedVertices;
+    uint64_t globalEdges;
+    uint64_t reserved;
+};
+static_assert(sizeof(ShardHeader) == 64);
+
+struct ShardMeta {
+    uint32_t shard = 0;
+    uint32_t shardCount = 0;
+    PartitionScheme scheme = PartitionScheme::Hash;
+    uint64_t globalVertices = 0;
+    uint64_t ownedVertices = 0;
+    uint64_t globalEdges = 0;
+    vector<uint32_t> global, owner, degree;   // per local vertex
+};
+
+bool readShardMeta(const string& path, ShardMeta& meta, string* error = nullptr);
+
+struct PartitionStats {
+    size_t users = 0;
+    size_t edges = 0;
+    size_t cutEdges = 0;             // friendships between two shards
+    vector<size_t> owned, ghosts;    // per shard
+    double millis = 0.0;
+};
+
+// Writes the shard and directory files for `owner` (see partitionVertices())
+// into `dir`, each through AtomicFile.
+bool writePartition(const string& dir, const CsrGraph& graph, const vector<uint32_t>& owner,
+                    uint32_t shards, PartitionScheme scheme, PartitionStats& stats);
+
+#endif
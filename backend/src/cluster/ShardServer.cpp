@@ -0,0 +1,345 @@
+#include "ShardServer.hpp"
+#include "Partition.hpp"
+#include "Wire.hpp"
+#include "../graph/Intersect.hpp"
+#include "../graph/Recommender.hpp"
+#include "../io/Snapshot.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Per-connection scratch for TwoHop, like Recommender's.
+struct Scratch {
+    vector<uint32_t> mutual;
+    vector<uint64_t> weight;
+    vector<VertexId> touched;
+};
+
+class Shard {
+private:
+    uint32_t index = 0;
+    CsrGraph graph;              // local IDs, in global order
+    ShardMeta meta;
+    vector<VertexId> owned;      // local IDs
+    vector<VertexId> ghosts;     // local IDs of neighbors owned elsewhere
+    vector<VertexId> boundary;   // local IDs of owned users that are ghosts elsewhere
+
+    // Distributed PageRank and component labels; one computation at a time.
+    mutex computeLock;
+    vector<double> rank, contrib;
+    vector<uint32_t> label, component, smallest;
+
+    VertexId local(uint32_t global) const {
+        auto it = lower_bound(meta.global.begin(), meta.global.end(), global);
+        return it != meta.global.end() && *it == global ? VertexId(it - meta.global.begin()) : INVALID_VERTEX;
+    }
+    bool owns(VertexId l) const { return l != INVALID_VERTEX && meta.owner[l] == index; }
+    void putGlobals(WireWriter& out, span<const VertexId> locals) const;
+
+    double scatterRanks(WireWriter& out);
+    void linkComponents();
+    bool spreadLabels();
+    void putLabels(WireWriter& out, span<const VertexId> locals) const;
+
+public:
+    bool load(const string& dir, uint32_t shard, string& error);
+    // False for a malformed request.
+    bool handle(ShardOp op, WireReader& in, WireWriter& out, Scratch& scratch);
+};
+
+bool Shard::load(const string& dir, uint32_t shard, string& error) {
+    index = shard;
+    vector<double> unused;
+    if (!readSnapshot(shardSnapshotPath(dir, shard), graph, unused, nullptr, &error)) return false;
+    if (!readShardMeta(shardMetaPath(dir, shard), meta, &error)) return false;
+    if (meta.shard != shard || meta.global.size() != graph.vertexSlots()) {
+        error = shardMetaPath(dir, shard) + " does not match " + shardSnapshotPath(dir, shard);
+        return false;
+    }
+    for (VertexId l = 0; l < meta.global.size(); ++l)
+        (owns(l) ? owned : ghosts).push_back(l);
+    return true;
+}
+
+void Shard::putGlobals(WireWriter& out, span<const VertexId> locals) const {
+    out.put<uint32_t>(locals.size());
+    for (VertexId l : locals) out.put<uint32_t>(meta.global[l]);
+}
+
+// =================== PAGERANK ===================
+
+// Same sweep as computePageRank(), over the owned rows only: ghosts'
+// rank/degree arrives from their owners before each step.
+double Shard::scatterRanks(WireWriter& out) {
+    double dangling = 0.0;
+    for (VertexId l : owned) {
+        size_t deg = graph.degree(l);
+        contrib[l] = deg ? rank[l] / deg : 0.0;
+        if (!deg) dangling += rank[l];
+    }
+    out.put<double>(dangling);
+    out.put<uint32_t>(boundary.size());
+    for (VertexId l : boundary) out.put<double>(contrib[l]);
+    return dangling;
+}
+
+// =================== COMPONENTS ===================
+
+// Union-find over the shard's edges; every owned row is complete, so two
+// local users in different sets are only connected, if at all, through
+// another shard.
+void Shard::linkComponents() {
+    component.resize(meta.global.size());
+    iota(component.begin(), component.end(), 0);
+    auto root = [&](VertexId x) {
+        while (component[x] != x) x = component[x] = component[component[x]];
+        return x;
+    };
+    for (VertexId v : owned)
+        for (VertexId u : graph.neighbors(v)) {
+            VertexId a = root(v), b = root(u);
+            if (a != b) component[max(a, b)] = min(a, b);
+        }
+    for (VertexId l = 0; l < component.size(); ++l) component[l] = root(l);
+    label.assign(meta.global.begin(), meta.global.end());
+}
+
+// Every set takes the smallest label among its users; true if an owned
+// user's label dropped.
+bool Shard::spreadLabels() {
+    smallest.assign(component.size(), UINT32_MAX);
+    for (VertexId l = 0; l < component.size(); ++l)
+        smallest[component[l]] = min(smallest[component[l]], label[l]);
+    bool changed = false;
+    for (VertexId l = 0; l < component.size(); ++l) {
+        uint32_t m = smallest[component[l]];
+        if (m < label[l]) {
+            changed |= owns(l);
+            label[l] = m;
+        }
+    }
+    return changed;
+}
+
+void Shard::putLabels(WireWriter& out, span<const VertexId> locals) const {
+    out.put<uint32_t>(locals.size());
+    for (VertexId l : locals) out.put<uint32_t>(label[l]);
+}
+
+// =================== REQUESTS ===================
+
+bool Shard::handle(ShardOp op, WireReader& in, WireWriter& out, Scratch& scratch) {
+    switch (op) {
+        case ShardOp::Hello:
+            out.put<uint32_t>(index);
+            out.put<uint32_t>(meta.shardCount);
+            out.put<uint64_t>(meta.globalVertices);
+            out.put<uint64_t>(owned.size());
+            putGlobals(out, ghosts);
+            return true;
+
+        case ShardOp::Friends: {
+            VertexId l = local(in.get<uint32_t>());
+            putGlobals(out, owns(l) ? graph.neighbors(l) : span<const VertexId>{});
+            return true;
+        }
+
+        case ShardOp::Mutual: {
+            VertexId a = local(in.get<uint32_t>()), b = local(in.get<uint32_t>());
+            if (!owns(a) || !owns(b)) {
+                out.put<uint32_t>(0);
+                return true;
+            }
+            intersectSorted(graph.neighbors(a), graph.neighbors(b), scratch.touched);
+            putGlobals(out, scratch.touched);
+            scratch.touched.clear();
+            return true;
+        }
+
+        case ShardOp::TwoHop: {
+            auto fn = (ScoreFunction)in.get<uint8_t>();
+            auto via = in.getArray<uint32_t>();
+            if (scratch.mutual.size() < meta.global.size()) {
+                scratch.mutual.resize(meta.global.size(), 0);
+                scratch.weight.resize(meta.global.size(), 0);
+            }
+            bool weighted = fn == ScoreFunction::AdamicAdar || fn == ScoreFunction::ResourceAllocation;
+            for (uint32_t g : via) {
+                VertexId f = local(g);
+                if (!owns(f)) continue;
+                auto fof = graph.neighbors(f);
+                uint64_t w = weighted ? fixedWeight(fn, fof.size()) : 0;
+                for (VertexId c : fof) {
+                    if (scratch.mutual[c]++ == 0) scratch.touched.push_back(c);
+                    if (weighted) scratch.weight[c] += w;
+                }
+            }
+            sort(scratch.touched.begin(), scratch.touched.end());
+            putGlobals(out, scratch.touched);
+            out.put<uint32_t>(scratch.touched.size());
+            for (VertexId c : scratch.touched) out.put<uint32_t>(scratch.mutual[c]);
+            out.put<uint32_t>(scratch.touched.size());
+            for (VertexId c : scratch.touched) {
+                out.put<uint64_t>(scratch.weight[c]);
+                scratch.mutual[c] = 0;
+                scratch.weight[c] = 0;
+            }
+            scratch.touched.clear();
+            return true;
+        }
+
+        case ShardOp::SetBoundary: {
+            lock_guard lock(computeLock);
+            boundary.clear();
+            for (uint32_t g : in.getArray<uint32_t>()) {
+                VertexId l = local(g);
+                if (!owns(l)) return false;
+                boundary.push_back(l);
+            }
+            return true;
+        }
+
+        case ShardOp::RankStart: {
+            lock_guard lock(computeLock);
+            double initial = in.get<double>();
+            rank.assign(meta.global.size(), 0.0);
+            contrib.assign(meta.global.size(), 0.0);
+            for (VertexId l : owned) rank[l] = initial;
+            scatterRanks(out);
+            return true;
+        }
+
+        case ShardOp::RankStep: {
+            lock_guard lock(computeLock);
+            double base = in.get<double>(), d = in.get<double>();
+            auto incoming = in.getArray<double>();
+            if (incoming.size() != ghosts.size() || rank.empty()) return false;
+            for (size_t i = 0; i < ghosts.size(); ++i) contrib[ghosts[i]] = incoming[i];
+
+            // contrib holds last sweep's values, so ranks can be replaced in place.
+            double delta = 0.0;
+            for (VertexId v : owned) {
+                double acc = 0.0;
+                for (VertexId u : graph.neighbors(v)) acc += contrib[u];
+                double next = base + d * acc;
+                delta += fabs(next - rank[v]);
+                rank[v] = next;
+            }
+            out.put<double>(delta);
+            scatterRanks(out);
+            return true;
+        }
+
+        case ShardOp::Ranks: {
+            lock_guard lock(computeLock);
+            out.put<uint32_t>(owned.size());
+            for (VertexId l : owned) out.put<double>(rank.empty() ? 0.0 : rank[l]);
+            return true;
+        }
+
+        case ShardOp::LabelStart: {
+            lock_guard lock(computeLock);
+            linkComponents();
+            spreadLabels();
+            putLabels(out, boundary);
+            return true;
+        }
+
+        case ShardOp::LabelStep: {
+            lock_guard lock(computeLock);
+            auto incoming = in.getArray<uint32_t>();
+            if (incoming.size() != ghosts.size() || label.empty()) return false;
+            for (size_t i = 0; i < ghosts.size(); ++i) label[ghosts[i]] = incoming[i];
+            out.put<uint8_t>(spreadLabels());
+            putLabels(out, boundary);
+            return true;
+        }
+
+        case ShardOp::Labels: {
+            lock_guard lock(computeLock);
+            if (label.empty()) return false;
+            putLabels(out, owned);
+            return true;
+        }
+
+        case ShardOp::Shutdown:
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// =================== SERVER ===================
+
+int runShard(const string& dir, uint32_t shard, const string& socketPath) {
+    Shard state;
+    string error;
+    if (!state.load(dir, shard, error)) {
+        cerr << "Shard " << shard << ": " << error << "\n";
+        return 1;
+    }
+    UnixSocket listener = UnixSocket::listen(socketPath, &error);
+    if (!listener.isOpen()) {
+        cerr << "Shard " << shard << ": " << error << "\n";
+        return 1;
+    }
+
+    // Connections stay listed while their thread runs, so shutting down can
+    // wake them all and wait for them.
+    mutex connLock;
+    condition_variable allDone;
+    list<shared_ptr<UnixSocket>> live;
+    atomic<bool> stopping{false};
+
+    auto serveConnection = [&](shared_ptr<UnixSocket> conn, list<shared_ptr<UnixSocket>>::iterator pos) {
+        Scratch scratch;
+        WireWriter reply;
+        string request;
+        while (conn->receive(request)) {
+            WireReader in(request);
+            auto op = (ShardOp)in.get<uint8_t>();
+            reply.clear();
+            if (!state.handle(op, in, reply, scratch) || !in.good()) {
+                cerr << "Shard " << shard << ": malformed request (op " << (int)op << ")\n";
+                break;
+            }
+            if (!conn->send(reply.data())) break;
+            if (op == ShardOp::Shutdown) {
+                stopping = true;
+                listener.shutdown();
+                break;
+            }
+        }
+        lock_guard lock(connLock);
+        live.erase(pos);
+        allDone.notify_all();
+    };
+
+    while (true) {
+        auto conn = make_shared<UnixSocket>(listener.accept());
+        if (!conn->isOpen() || stopping) break;
+        lock_guard lock(connLock);
+        auto pos = live.insert(live.end(), conn);
+        thread(serveConnection, conn, pos).detach();
+    }
+
+    unique_lock lock(connLock);
+    for (auto& conn : live) conn->shutdown();
+    allDone.wait(lock, [&] { return live.empty(); });
+    listener.close();
+    remove(socketPath.c_str());
+    return stopping ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#ifndef SHARD_SERVER_HPP
+#define SHARD_SERVER_HPP
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Requests a shard answers (first byte of the payload), with their
+// arguments and replies. Users are named by global ID throughout; every
+// list of users is ascending.
+//
+//   Hello                         -> u32 shard, u32 shardCount, u64 globalVertices,
+//                                    u64 owned, u32[] ghosts
+//   Friends     u32 user          -> u32[] friends            (user owned here)
+//   Mutual      u32 a, u32 b      -> u32[] common friends     (both owned here)
+//   TwoHop      u8 fn, u32[] via  -> u32[] candidates, u32[] counts, u64[] weights
+//                                    (friends of the `via` users, owned here;
+//                                    weights are fn's AA/RA sums, see fixedWeight())
+//   SetBoundary u32[] users       -> (empty)  owned users that are ghosts elsewhere
+//   RankStart   f64 initial       -> f64 dangling, f64[] boundary contributions
+//   RankStep    f64 base, f64 damping, f64[] ghost contributions
+//                                 -> f64 delta, f64 dangling, f64[] boundary contributions
+//   Ranks                         -> f64[] ranks of the owned users
+//   LabelStart                    -> u32[] boundary labels
+//   LabelStep   u32[] ghost labels -> u8 changed, u32[] boundary labels
+//   Labels                        -> u32[] labels of the owned users
+//   Shutdown                      -> (empty), then the process exits
+//
+// The Rank and Label requests carry one distributed computation at a time
+// (see ClusterSession); the shard keeps its part of the vector between them.
+enum class ShardOp : uint8_t {
+    Hello, Friends, Mutual, TwoHop, SetBoundary,
+    RankStart, RankStep, Ranks, LabelStart, LabelStep, Labels,
+    Shutdown
+};
+
+// Loads shard `shard` of the partition in `dir` and serves it on
+// `socketPath`, one thread per connection, until a Shutdown request.
+// Returns the process exit code.
+int runShard(const string& dir, uint32_t shard, const string& socketPath);
+
+#endif
@@ -0,0 +1,137 @@
+#include "Wire.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+UnixSocket& UnixSocket::operator=(UnixSocket&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        other.fd = -1;
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+static UnixSocket unsupported(string* error) {
+    if (error) *error = "Unix sockets are not supported on this platform";
+    return UnixSocket();
+}
+
+UnixSocket UnixSocket::listen(const string&, string* error) { return unsupported(error); }
+UnixSocket UnixSocket::connect(const string&, string* error) { return unsupported(error); }
+UnixSocket UnixSocket::accept() const { return UnixSocket(); }
+void UnixSocket::close() { fd = -1; }
+void UnixSocket::shutdown() {}
+bool UnixSocket::send(const string&) { return false; }
+bool UnixSocket::receive(string&) { return false; }
+
+#else
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;   // a dead peer is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+static bool socketAddress(const string& path, sockaddr_un& addr, string* error) {
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        if (error) *error = "socket path too long: " + path;
+        return false;
+    }
+    path.copy(addr.sun_path, path.size());
+    return true;
+}
+
+UnixSocket UnixSocket::listen(const string& path, string* error) {
+    sockaddr_un addr;
+    if (!socketAddress(path, addr, error)) return UnixSocket();
+    UnixSocket sock(::socket(AF_UNIX, SOCK_STREAM, 0));
+    ::unlink(path.c_str());
+    if (!sock.isOpen() || ::bind(sock.fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(sock.fd, 64) != 0) {
+        if (error) *error = "cannot listen on " + path + ": " + strerror(errno);
+        return UnixSocket();
+    }
+    return sock;
+}
+
+UnixSocket UnixSocket::connect(const string& path, string* error) {
+    sockaddr_un addr;
+    if (!socketAddress(path, addr, error)) return UnixSocket();
+    UnixSocket sock(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!sock.isOpen() || ::connect(sock.fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        if (error) *error = "cannot connect to " + path + ": " + strerror(errno);
+        return UnixSocket();
+    }
+    return sock;
+}
+
+UnixSocket UnixSocket::accept() const {
+    int client;
+    do client = ::accept(fd, nullptr, nullptr);
+    while (client < 0 && errno == EINTR);
+    return UnixSocket(client);
+}
+
+void UnixSocket::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+void UnixSocket::shutdown() {
+    if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+}
+
+static bool writeAll(int fd, const char* p, size_t n) {
+    while (n) {
+        ssize_t w = ::send(fd, p, n, SEND_FLAGS);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* p, size_t n) {
+    while (n) {
+        ssize_t r = ::recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+// Small frames go out as one write, so a request/reply round trip is one
+// packet each way.
+bool UnixSocket::send(const string& payload) {
+    uint32_t length = payload.size();
+    if (payload.size() > WIRE_MAX_FRAME) return false;
+    if (payload.size() <= 4096) {
+        char frame[4 + 4096];
+        memcpy(frame, &length, 4);
+        memcpy(frame + 4, payload.data(), payload.size());
+        return writeAll(fd, frame, 4 + payload.size());
+    }
+    return writeAll(fd, (const char*)&length, 4) && writeAll(fd, payload.data(), payload.size());
+}
+
+bool UnixSocket::receive(string& payload) {
+    uint32_t length;
+    if (!readAll(fd, (char*)&length, 4) || length > WIRE_MAX_FRAME) return false;
+    payload.resize(length);
+    return readAll(fd, payload.data(), length);
+}
+
+#endif
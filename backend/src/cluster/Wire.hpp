@@ -0,0 +1,109 @@
+#ifndef WIRE_HPP
+#define WIRE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// Binary messages between the --cluster coordinator and its shard
+// processes. Both ends run on one machine from one build, so values go out
+// in native byte order with no versioning.
+//
+// A frame is a uint32 payload length followed by the payload; a request's
+// payload starts with its ShardOp (see ShardServer.hpp). Arrays are a uint32
+// count followed by the elements.
+constexpr size_t WIRE_MAX_FRAME = 1u << 30;
+
+class WireWriter {
+private:
+    string bytes;
+
+public:
+    void clear() { bytes.clear(); }
+    const string& data() const { return bytes; }
+
+    template <class T>
+    void put(T value) {
+        static_assert(is_trivially_copyable_v<T>);
+        bytes.append((const char*)&value, sizeof(T));
+    }
+    template <class T>
+    void putArray(span<const T> values) {
+        put<uint32_t>(values.size());
+        bytes.append((const char*)values.data(), values.size_bytes());
+    }
+    template <class T>
+    void putArray(const vector<T>& values) { putArray(span<const T>(values)); }
+};
+
+// Reads a payload front to back. A short payload turns the reader bad and
+// every later read returns zero/empty, so callers check good() once at the end.
+class WireReader {
+private:
+    string_view rest;
+    bool ok = true;
+
+    bool take(void* out, size_t bytes) {
+        if (!ok || rest.size() < bytes) { ok = false; return false; }
+        if (bytes) memcpy(out, rest.data(), bytes);   // out is null for an empty array
+        rest.remove_prefix(bytes);
+        return true;
+    }
+
+public:
+    explicit WireReader(string_view payload) : rest(payload) {}
+    bool good() const { return ok; }
+
+    template <class T>
+    T get() {
+        static_assert(is_trivially_copyable_v<T>);
+        T value{};
+        take(&value, sizeof(T));
+        return value;
+    }
+    template <class T>
+    vector<T> getArray() {
+        vector<T> values;
+        uint32_t n = get<uint32_t>();
+        if (!ok || rest.size() / sizeof(T) < n) { ok = false; return values; }
+        values.resize(n);
+        take(values.data(), n * sizeof(T));
+        return values;
+    }
+};
+
+// A connected (or listening) Unix domain stream socket. POSIX only; on
+// Windows every operation fails with a message.
+class UnixSocket {
+private:
+    int fd = -1;
+
+public:
+    UnixSocket() = default;
+    explicit UnixSocket(int socketFd) : fd(socketFd) {}
+    ~UnixSocket() { close(); }
+    UnixSocket(UnixSocket&& other) noexcept : fd(other.fd) { other.fd = -1; }
+    UnixSocket& operator=(UnixSocket&& other) noexcept;
+    UnixSocket(const UnixSocket&) = delete;
+    UnixSocket& operator=(const UnixSocket&) = delete;
+
+    // listen() replaces a stale socket file at `path`.
+    static UnixSocket listen(const string& path, string* error = nullptr);
+    static UnixSocket connect(const string& path, string* error = nullptr);
+    UnixSocket accept() const;
+
+    bool isOpen() const { return fd >= 0; }
+    void close();
+    void shutdown();   // wakes a thread blocked in accept() or receive()
+
+    bool send(const string& payload);
+    bool receive(string& payload);   // false on EOF or error
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "BatchRecommend.hpp"
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t BLOCK = 256;   // users per scheduling unit
+constexpr size_t WINDOW_PER_THREAD = 4;   // blocks that may wait for output, per thread
+
+// Per-worker totals, padded so neighbouring workers don't share a line.
+struct alignas(64) Tally {
+    size_t users = 0;
+    size_t recommendations = 0;
+};
+
+void appendScore(string& line, double score) {
+    char buf[32];
+    auto res = to_chars(buf, buf + sizeof(buf), score, chars_format::general, 6);
+    line.append(buf, res.ptr);
+}
+}
+
+BatchResult recommendAll(const CsrGraph& graph, size_t topK, ScoreFunction fn,
+                         span<const double> pageRank, ThreadPool& pool, size_t threads,
+                         ostream& out, const WalkOptions& walk, const MinHashIndex* circles) {
+    auto start = chrono::steady_clock::now();
+    BatchResult result;
+    result.threads = threads ? min(threads, pool.size()) : pool.size();
+
+    size_t slots = graph.vertexSlots();
+    size_t blocks = (slots + BLOCK - 1) / BLOCK;
+    vector<Recommender> scratch(pool.size());
+    vector<Tally> tally(pool.size());
+
+    // Reorder window: a block is parked until all blocks before it are written.
+    // A worker only starts a block within `window` of the next one to write,
+    // so one slow block holds back at most that many finished ones. The next
+    // block to write is always inside the window, so its worker never waits.
+    mutex outMutex;
+    condition_variable advanced;
+    size_t window = result.threads * WINDOW_PER_THREAD;
+    vector<string> finished(blocks);
+    vector<uint8_t> ready(blocks, 0);
+    size_t nextBlock = 0;
+
+    pool.parallelFor(slots, BLOCK, [&](size_t w, size_t b, size_t e) {
+        size_t block = b / BLOCK;
+        {
+            unique_lock<mutex> lock(outMutex);
+            advanced.wait(lock, [&] { return block < nextBlock + window; });
+        }
+
+        string text;
+        for (VertexId u = b; u < e; ++u) {
+            if (!graph.isAlive(u)) continue;
+            auto recs = scratch[w].recommend(graph, u, topK, fn, pageRank, walk, circles);
+            text += graph.name(u);
+            text.push_back(',');
+            for (size_t i = 0; i < recs.size(); ++i) {
+                if (i) text.push_back('|');
+                text += graph.name(recs[i].vertex);
+                text.push_back(':');
+                appendScore(text, recs[i].score);
+            }
+            text.push_back('\n');
+            tally[w].recommendations += recs.size();
+            tally[w].users++;
+        }
+
+        lock_guard<mutex> lock(outMutex);
+        finished[block] = std::move(text);
+        ready[block] = 1;
+        size_t before = nextBlock;
+        while (nextBlock < blocks && ready[nextBlock]) {
+            out.write(finished[nextBlock].data(), finished[nextBlock].size());
+            string().swap(finished[nextBlock]);
+            nextBlock++;
+        }
+        if (nextBlock != before) advanced.notify_all();
+    }, result.threads);
+    out.flush();
+
+    for (const Tally& t : tally) {
+        result.users += t.users;
+        result.recommendations += t.recommendations;
+    }
+    result.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
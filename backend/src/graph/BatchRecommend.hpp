@@ -0,0 +1,35 @@
+#ifndef BATCH_RECOMMEND_HPP
+#define BATCH_RECOMMEND_HPP
+
+#include <ostream>
+#include <span>
+#include "CsrGraph.hpp"
+#include "Recommender.hpp"
+#include "../utils/ThreadPool.hpp"
+
+using namespace std;
+
+struct BatchResult {
+    size_t users = 0;
+    size_t recommendations = 0;
+    size_t threads = 0;
+    double millis = 0.0;
+
+    double usersPerSec() const { return millis > 0 ? users * 1000.0 / millis : 0.0; }
+};
+
+// Top-K recommendations for every user, one line each:
+//
+//     username,candidate:score|candidate:score|...
+//
+// Users are handed to the pool in small blocks (a shared cursor, so threads
+// that draw cheap users simply take more blocks) and each worker reuses its
+// own Recommender scratch. Finished blocks are written as soon as every
+// earlier block is out, so output stays in vertex order; workers run at most
+// a few blocks per thread ahead of the output, which bounds what is buffered.
+BatchResult recommendAll(const CsrGraph& graph, size_t topK, ScoreFunction fn,
+                         span<const double> pageRank, ThreadPool& pool, size_t threads,
+                         ostream& out, const WalkOptions& walk = {},
+                         const MinHashIndex* circles = nullptr);
+
+#endif
@@ -0,0 +1,100 @@
+#include "Components.hpp"
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+namespace {
+// Lock-free find/link used only while build() runs in parallel.
+VertexId concurrentRoot(vector<VertexId>& parent, VertexId v) {
+    for (;;) {
+        VertexId p = atomic_ref<VertexId>(parent[v]).load(memory_order_relaxed);
+        if (p == v) return v;
+        VertexId gp = atomic_ref<VertexId>(parent[p]).load(memory_order_relaxed);
+        if (gp != p)  // path halving; losing the race is harmless
+            atomic_ref<VertexId>(parent[v]).compare_exchange_weak(p, gp, memory_order_relaxed);
+        v = gp;
+    }
+}
+
+void concurrentUnite(vector<VertexId>& parent, VertexId a, VertexId b) {
+    for (;;) {
+        a = concurrentRoot(parent, a);
+        b = concurrentRoot(parent, b);
+        if (a == b) return;
+        if (a < b) swap(a, b);
+        VertexId expected = a;
+        if (atomic_ref<VertexId>(parent[a]).compare_exchange_strong(expected, b, memory_order_acq_rel))
+            return;
+    }
+}
+}
+
+void ConnectedComponents::build(const CsrGraph& graph, ThreadPool& pool) {
+    size_t n = graph.vertexSlots();
+    parent.resize(n);
+    for (VertexId v = 0; v < n; ++v) parent[v] = v;
+
+    pool.parallelFor(n, 1024, [&](size_t, size_t b, size_t e) {
+        for (VertexId u = b; u < e; ++u)
+            for (VertexId v : graph.neighbors(u))
+                if (u < v) concurrentUnite(parent, u, v);
+    });
+    built = true;
+    stale = false;
+}
+
+void ConnectedComponents::reset() {
+    parent.clear();
+    built = false;
+    stale = false;
+}
+
+VertexId ConnectedComponents::root(VertexId v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+void ConnectedComponents::addVertex(VertexId v) {
+    if (!built) return;
+    while (parent.size() <= v) parent.push_back(parent.size());
+}
+
+void ConnectedComponents::addEdge(VertexId a, VertexId b) {
+    if (!built) return;
+    a = root(a);
+    b = root(b);
+    if (a == b) return;
+    if (a < b) swap(a, b);
+    parent[a] = b;
+}
+
+ConnectedComponents::Answer ConnectedComponents::connected(VertexId a, VertexId b) {
+    if (!built) return Answer::Unknown;
+    if (root(a) != root(b)) return Answer::No;
+    return stale ? Answer::Unknown : Answer::Yes;
+}
+
+ComponentStats ConnectedComponents::stats(const CsrGraph& graph) {
+    ComponentStats st;
+    vector<size_t> size(parent.size(), 0);
+    for (VertexId v = 0; v < parent.size(); ++v) {
+        if (!graph.isAlive(v)) continue;
+        size[root(v)]++;
+        if (graph.degree(v) == 0) st.isolated++;
+    }
+
+    for (size_t s : size) {
+        if (!s) continue;
+        st.components++;
+        st.topSizes.push_back(s);
+    }
+    size_t keep = min<size_t>(st.topSizes.size(), 5);
+    partial_sort(st.topSizes.begin(), st.topSizes.begin() + keep, st.topSizes.end(), greater<size_t>());
+    st.topSizes.resize(keep);
+    st.largest = keep ? st.topSizes[0] : 0;
+    return st;
+}
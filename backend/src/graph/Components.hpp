@@ -0,0 +1,50 @@
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include <cstdint>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "../utils/ThreadPool.hpp"
+
+using namespace std;
+
+struct ComponentStats {
+    size_t components = 0;
+    size_t largest = 0;
+    size_t isolated = 0;             // users with no friends
+    vector<size_t> topSizes;         // largest few, descending
+};
+
+// Connected-component labels via union-find over vertex IDs.
+//
+// build() links every edge concurrently (CAS on the parent array, always
+// pointing the larger root at the smaller, so no cycles can form). After that
+// added vertices and edges are plain unions. Removals can split a component,
+// which union-find can't undo, so they only mark the labels stale: different
+// roots are still proof of "not connected", but equal roots must be confirmed
+// by the caller until the next build().
+class ConnectedComponents {
+public:
+    enum class Answer { No, Yes, Unknown };
+
+    bool isBuilt() const { return built; }
+    bool isStale() const { return stale; }
+    void build(const CsrGraph& graph, ThreadPool& pool);
+    void reset();                    // back to unbuilt
+
+    void addVertex(VertexId v);
+    void addEdge(VertexId a, VertexId b);
+    void removeEdge() { stale = true; }
+
+    Answer connected(VertexId a, VertexId b);
+    ComponentStats stats(const CsrGraph& graph);   // requires a fresh build
+
+private:
+    vector<VertexId> parent;
+    bool built = false;
+    bool stale = false;
+
+    VertexId root(VertexId v);
+};
+
+#endif
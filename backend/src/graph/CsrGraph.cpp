@@ -0,0 +1,364 @@
+#include "CsrGraph.hpp"
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+CsrGraph::CsrGraph() : base(make_shared<NameTable>()), csr(make_shared<CsrArrays>()) {}
+
+// The loaders hand over unique names; a repeated ID keeps its first vertex in
+// the index.
+void CsrGraph::setNames(StringArena vertexNames, StringArena vertexIds) {
+    auto table = make_shared<NameTable>();
+    table->names = std::move(vertexNames);
+    table->ids = std::move(vertexIds);
+    size_t n = table->names.size();
+    while (table->ids.size() < n) table->ids.add("");
+    table->index.reserve(n);
+    table->idIndex.reserve(n);
+    for (VertexId v = 0; v < n; ++v) {
+        table->index.insert(v, table->names);
+        if (!table->ids[v].empty()) table->idIndex.insert(v, table->ids);
+    }
+    base = std::move(table);
+    clearAdded();
+    alive.assign(n, 1);
+    aliveCount = n;
+    freeSlots.clear();
+}
+
+// Fresh table holding every slot's current strings; only live vertices are
+// indexed.
+shared_ptr<CsrGraph::NameTable> CsrGraph::rebuiltNames(StringArena vertexIds) const {
+    auto table = make_shared<NameTable>();
+    size_t n = alive.size();
+    for (VertexId v = 0; v < n; ++v) table->names.add(name(v));
+    table->ids = std::move(vertexIds);
+    while (table->ids.size() < n) table->ids.add("");
+    table->index.reserve(aliveCount);
+    table->idIndex.reserve(aliveCount);
+    for (VertexId v = 0; v < n; ++v) {
+        if (!alive[v]) continue;
+        table->index.insert(v, table->names);
+        if (!table->ids[v].empty()) table->idIndex.insert(v, table->ids);
+    }
+    return table;
+}
+
+void CsrGraph::clearAdded() {
+    addedNames.clear();
+    addedIds.clear();
+    addedIndex.clear();
+    addedIdIndex.clear();
+    addedVertex.clear();
+    appendedHandle.clear();
+    reusedBase.clear();
+}
+
+// =================== BULK BUILD ===================
+
+void CsrGraph::build(StringArena vertexNames, StringArena vertexIds,
+                     const vector<pair<VertexId, VertexId>>& edgeList) {
+    clear();
+    setNames(std::move(vertexNames), std::move(vertexIds));
+    size_t n = alive.size();
+
+    // Counting sort by source: degree pass, prefix sum, scatter.
+    auto arrays = make_shared<CsrArrays>();
+    vector<uint64_t>& offsets = arrays->ownedOffsets;
+    vector<VertexId>& adj = arrays->ownedAdj;
+    offsets.assign(n + 1, 0);
+    for (auto [a, b] : edgeList) {
+        if (a == b || a >= n || b >= n) continue;
+        offsets[a + 1]++;
+        offsets[b + 1]++;
+    }
+    for (size_t v = 0; v < n; ++v) offsets[v + 1] += offsets[v];
+
+    adj.resize(offsets[n]);
+    vector<uint64_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (auto [a, b] : edgeList) {
+        if (a == b || a >= n || b >= n) continue;
+        adj[cursor[a]++] = b;
+        adj[cursor[b]++] = a;
+    }
+
+    // Sort and dedupe each row in place, then squeeze out the gaps.
+    uint64_t write = 0;
+    for (size_t v = 0; v < n; ++v) {
+        auto first = adj.begin() + offsets[v];
+        auto last = adj.begin() + offsets[v + 1];
+        sort(first, last);
+        last = unique(first, last);
+        offsets[v] = write;
+        write = copy(first, last, adj.begin() + write) - adj.begin();
+    }
+    offsets[n] = write;
+    adj.resize(write);
+    adj.shrink_to_fit();
+    arrays->offsets = offsets;
+    arrays->adj = adj;
+    csr = std::move(arrays);
+    edges = write / 2;
+}
+
+void CsrGraph::adopt(StringArena vertexNames, StringArena vertexIds, span<const uint64_t> csrOffsets,
+                     span<const VertexId> csrAdj, shared_ptr<const void> backingMemory) {
+    clear();
+    setNames(std::move(vertexNames), std::move(vertexIds));
+
+    auto arrays = make_shared<CsrArrays>();
+    arrays->ownedOffsets.clear();
+    arrays->offsets = csrOffsets;
+    arrays->adj = csrAdj;
+    arrays->backing = std::move(backingMemory);
+    csr = std::move(arrays);
+    edges = csrAdj.size() / 2;
+}
+
+// The name table may point into the same mapping, so it is copied too.
+void CsrGraph::detach() {
+    if (!csr->backing) return;
+    auto table = make_shared<NameTable>();
+    size_t n = base->names.size();
+    for (VertexId v = 0; v < n; ++v) {
+        table->names.add(base->names[v]);
+        table->ids.add(base->ids[v]);
+    }
+    table->index = base->index;   // same handles, same strings
+    table->idIndex = base->idIndex;
+    base = std::move(table);
+
+    auto arrays = make_shared<CsrArrays>();
+    arrays->ownedOffsets.assign(csr->offsets.begin(), csr->offsets.end());
+    arrays->ownedAdj.assign(csr->adj.begin(), csr->adj.end());
+    arrays->offsets = arrays->ownedOffsets;
+    arrays->adj = arrays->ownedAdj;
+    csr = std::move(arrays);
+}
+
+void CsrGraph::clear() {
+    base = make_shared<NameTable>();
+    clearAdded();
+    alive.clear();
+    aliveCount = 0;
+    freeSlots.clear();
+    csr = make_shared<CsrArrays>();
+    delta.clear();
+    deltaEntries = 0;
+    edges = 0;
+}
+
+// Builds fresh arrays (and, if many users were added, a fresh name table).
+// Copies still holding the old ones keep them alive until they go away.
+void CsrGraph::compact() {
+    if (!hasDelta()) return;
+
+    size_t n = alive.size();
+    auto arrays = make_shared<CsrArrays>();
+    vector<uint64_t>& offsets = arrays->ownedOffsets;
+    offsets.assign(n + 1, 0);
+    for (VertexId v = 0; v < n; ++v)
+        offsets[v + 1] = offsets[v] + neighbors(v).size();
+
+    vector<VertexId>& adj = arrays->ownedAdj;
+    adj.resize(offsets[n]);
+    for (VertexId v = 0; v < n; ++v) {
+        auto row = neighbors(v);
+        copy(row.begin(), row.end(), adj.begin() + offsets[v]);
+    }
+    arrays->offsets = offsets;
+    arrays->adj = adj;
+    csr = std::move(arrays);
+    delta.clear();
+    deltaEntries = 0;
+
+    if (addedNames.size() > 4096 && addedNames.size() > base->names.size() / 8) {
+        if (!reusedBase.empty()) {
+            // Base entries can't be overwritten in place, so start over.
+            StringArena ids;
+            for (VertexId v = 0; v < n; ++v) ids.add(id(v));
+            base = rebuiltNames(std::move(ids));
+            clearAdded();
+            return;
+        }
+        auto table = make_shared<NameTable>(*base);
+        size_t first = table->names.size();
+        for (VertexId v = first; v < n; ++v) {
+            table->names.add(name(v));
+            table->ids.add(id(v));
+        }
+        // Removed vertices leave the index; a name re-added later may then
+        // take the slot its old vertex had.
+        for (VertexId v = 0; v < first; ++v) {
+            if (alive[v]) continue;
+            if (table->index.find(table->names[v], table->names) == v)
+                table->index.erase(table->names[v], table->names);
+            if (table->idIndex.find(table->ids[v], table->ids) == v)
+                table->idIndex.erase(table->ids[v], table->ids);
+        }
+        for (VertexId v = first; v < n; ++v) {
+            if (!alive[v]) continue;
+            table->index.insert(v, table->names);
+            if (!table->ids[v].empty()) table->idIndex.insert(v, table->ids);
+        }
+        base = std::move(table);
+        clearAdded();
+    }
+}
+
+void CsrGraph::setIds(StringArena vertexIds) {
+    base = rebuiltNames(std::move(vertexIds));
+    clearAdded();
+}
+
+void CsrGraph::holdCompaction(bool hold) {
+    compactionHeld = hold;
+    if (!hold) maybeCompact();
+}
+
+// Keep the delta layer small relative to the base so neighbors() stays on the
+// contiguous arrays for almost every vertex.
+void CsrGraph::maybeCompact() {
+    if (compactionHeld) return;
+    if (deltaEntries > 4096 && deltaEntries > csr->adj.size() / 8)
+        compact();
+}
+
+vector<VertexId>& CsrGraph::mutableRow(VertexId v) {
+    auto it = delta.find(v);
+    if (it != delta.end()) {
+        if (it->second.use_count() > 1) {
+            it->second = make_shared<vector<VertexId>>(*it->second);
+        } else {
+            // Sole owner: nobody else can gain a reference. use_count() is a
+            // relaxed load, though, so fence to order the edits after the
+            // last reads by whichever snapshot just released the row.
+            atomic_thread_fence(memory_order_acquire);
+        }
+        return *it->second;
+    }
+    auto row = neighbors(v);
+    deltaEntries += row.size();
+    return *delta.emplace(v, make_shared<vector<VertexId>>(row.begin(), row.end())).first->second;
+}
+
+// =================== MUTATION ===================
+
+VertexId CsrGraph::addVertex(string_view name, string_view id) {
+    if (find(name) != INVALID_VERTEX) return INVALID_VERTEX;
+    bool indexId = !id.empty() && findId(id) == INVALID_VERTEX;
+
+    VertexId v;
+    if (!freeSlots.empty()) {
+        v = freeSlots.back();
+        freeSlots.pop_back();
+        alive[v] = 1;
+    } else {
+        v = alive.size();
+        alive.push_back(1);
+    }
+    aliveCount++;
+
+    StringHandle h = addedNames.add(name);
+    addedIds.add(id);
+    addedVertex.push_back(v);
+    size_t n = base->names.size();
+    if (v >= n) {
+        if (v - n < appendedHandle.size()) appendedHandle[v - n] = h;
+        else appendedHandle.push_back(h);
+    } else {
+        auto it = lower_bound(reusedBase.begin(), reusedBase.end(), pair{v, StringHandle(0)});
+        if (it != reusedBase.end() && it->first == v) it->second = h;
+        else reusedBase.insert(it, {v, h});
+    }
+    addedIndex.insert(h, addedNames);
+    if (indexId) addedIdIndex.insert(h, addedIds);
+    return v;
+}
+
+// Each neighbor loses one entry and v's row is dropped whole, so the cost
+// is the degree, not its square.
+bool CsrGraph::removeVertex(VertexId v) {
+    if (!isAlive(v)) return false;
+    auto row = neighbors(v);
+    vector<VertexId> nbrs(row.begin(), row.end());
+    for (VertexId u : nbrs) {
+        auto& other = mutableRow(u);
+        other.erase(lower_bound(other.begin(), other.end(), v));
+    }
+    if (!nbrs.empty()) delta[v] = make_shared<vector<VertexId>>();
+    edges -= nbrs.size();
+
+    StringHandle h = addedHandle(v);
+    if (h != INVALID_HANDLE) {
+        addedIndex.erase(addedNames[h], addedNames);
+        if (addedIdIndex.find(addedIds[h], addedIds) == h) addedIdIndex.erase(addedIds[h], addedIds);
+    }
+    alive[v] = 0;
+    aliveCount--;
+    freeSlots.push_back(v);
+    maybeCompact();
+    return true;
+}
+
+bool CsrGraph::addEdge(VertexId a, VertexId b) {
+    if (a == b || !isAlive(a) || !isAlive(b) || hasEdge(a, b)) return false;
+    for (auto [x, y] : {pair{a, b}, pair{b, a}}) {
+        auto& row = mutableRow(x);
+        row.insert(lower_bound(row.begin(), row.end(), y), y);
+        deltaEntries++;
+    }
+    edges++;
+    maybeCompact();
+    return true;
+}
+
+bool CsrGraph::removeEdge(VertexId a, VertexId b) {
+    if (!isAlive(a) || !isAlive(b) || !hasEdge(a, b)) return false;
+    for (auto [x, y] : {pair{a, b}, pair{b, a}}) {
+        auto& row = mutableRow(x);
+        row.erase(lower_bound(row.begin(), row.end(), y));
+    }
+    edges--;
+    maybeCompact();
+    return true;
+}
+
+// =================== QUERY ===================
+
+StringHandle CsrGraph::reusedHandle(VertexId v) const {
+    auto it = lower_bound(reusedBase.begin(), reusedBase.end(), pair{v, StringHandle(0)});
+    return it != reusedBase.end() && it->first == v ? it->second : INVALID_HANDLE;
+}
+
+// Names added since the table was built shadow it; a removed vertex keeps
+// its table entry, so the base hit must still be alive and not reused.
+VertexId CsrGraph::find(string_view name) const {
+    StringHandle h = addedIndex.find(name, addedNames);
+    if (h != INVALID_HANDLE) return addedVertex[h];
+    VertexId v = base->index.find(name, base->names);
+    return v != INVALID_HANDLE && alive[v] && addedHandle(v) == INVALID_HANDLE ? v : INVALID_VERTEX;
+}
+
+VertexId CsrGraph::findId(string_view id) const {
+    StringHandle h = addedIdIndex.find(id, addedIds);
+    if (h != INVALID_HANDLE) return addedVertex[h];
+    VertexId v = base->idIndex.find(id, base->ids);
+    return v != INVALID_HANDLE && alive[v] && addedHandle(v) == INVALID_HANDLE ? v : INVALID_VERTEX;
+}
+
+span<const VertexId> CsrGraph::neighbors(VertexId v) const {
+    if (!delta.empty()) {
+        auto it = delta.find(v);
+        if (it != delta.end()) return *it->second;
+    }
+    if (v + 1 >= csr->offsets.size()) return {};  // added since the last compaction
+    return csr->adj.subspan(csr->offsets[v], csr->offsets[v + 1] - csr->offsets[v]);
+}
+
+bool CsrGraph::hasEdge(VertexId a, VertexId b) const {
+    auto ra = neighbors(a), rb = neighbors(b);
+    if (rb.size() < ra.size()) { swap(ra, rb); swap(a, b); }
+    return binary_search(ra.begin(), ra.end(), b);
+}
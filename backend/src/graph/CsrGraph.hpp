@@ -0,0 +1,155 @@
+#ifndef CSR_GRAPH_HPP
+#define CSR_GRAPH_HPP
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../intern/NameIndex.hpp"
+#include "../intern/StringArena.hpp"
+
+using namespace std;
+
+using VertexId = uint32_t;
+constexpr VertexId INVALID_VERTEX = UINT32_MAX;
+
+// Undirected graph over dense integer vertex IDs.
+//
+// Adjacency lives in compressed sparse row form: offsets[v]..offsets[v+1]
+// indexes a sorted run of neighbor IDs in adj. Mutations don't touch the CSR
+// arrays; a modified row is copied into a small delta layer and edited there,
+// and neighbors() serves the delta copy when one exists. Once the delta grows
+// past a fraction of the base, compact() folds it back into fresh arrays.
+//
+// Each vertex's username and hash ID are interned in string arenas, with the
+// vertex ID as the handle, and open-addressing indexes map names and IDs
+// back (the ID index is how new IDs are checked for collisions); the rest of
+// the program refers to users by vertex ID and only reads the strings
+// back to print them.
+//
+// Removing a vertex touches only its neighbors' rows, and its ID goes on a
+// free list that addVertex() draws from before growing. A reused slot keeps
+// its stale base-table entry; its new strings live in the added arenas, and
+// lookups skip base entries that have been superseded this way.
+//
+// The CSR arrays and the name table are immutable once built and shared
+// between copies, and delta rows are copy-on-write, so copying a graph costs
+// a byte per vertex (the alive flags) plus the delta rows and the names added
+// since the last rebuild, rather than O(V + E): that is what makes
+// publishing read-only versions to other threads cheap. The arrays are read
+// through spans so they can also live in memory the graph doesn't own (a
+// mapped snapshot file, see adopt()).
+class CsrGraph {
+private:
+    struct NameTable {
+        StringArena names;    // vertex -> username
+        StringArena ids;      // vertex -> hash ID
+        NameIndex index;      // username -> vertex
+        NameIndex idIndex;    // hash ID -> vertex
+    };
+    struct CsrArrays {
+        vector<uint64_t> ownedOffsets{0};
+        vector<VertexId> ownedAdj;
+        span<const uint64_t> offsets{ownedOffsets};  // size = base vertex count + 1
+        span<const VertexId> adj;
+        shared_ptr<const void> backing;          // keeps external memory alive
+    };
+    using Row = shared_ptr<vector<VertexId>>;
+
+    shared_ptr<const NameTable> base;
+    StringArena addedNames, addedIds;        // vertices added since the table was built
+    NameIndex addedIndex;                    // handles into addedNames
+    NameIndex addedIdIndex;                  // handles into addedIds
+    vector<VertexId> addedVertex;            // handle -> vertex
+    vector<StringHandle> appendedHandle;     // vertex (base size + i) -> handle
+    vector<pair<VertexId, StringHandle>> reusedBase;   // sorted; base slots given to new users
+    vector<uint8_t> alive;
+    size_t aliveCount = 0;
+    vector<VertexId> freeSlots;              // removed vertices, reused LIFO
+
+    shared_ptr<const CsrArrays> csr;
+    unordered_map<VertexId, Row> delta;      // rows shared with copies are cloned before writes
+    size_t deltaEntries = 0;
+    size_t edges = 0;                        // undirected edge count
+    bool compactionHeld = false;             // see holdCompaction()
+
+    vector<VertexId>& mutableRow(VertexId v);
+    void maybeCompact();
+    void setNames(StringArena vertexNames, StringArena vertexIds);
+    shared_ptr<NameTable> rebuiltNames(StringArena vertexIds) const;
+    void clearAdded();
+
+    // Where v's strings are in the added arenas; INVALID_HANDLE if they are
+    // in the base table.
+    StringHandle addedHandle(VertexId v) const {
+        size_t n = base->names.size();
+        if (v >= n) return appendedHandle[v - n];
+        return reusedBase.empty() ? INVALID_HANDLE : reusedHandle(v);
+    }
+    StringHandle reusedHandle(VertexId v) const;
+
+public:
+    CsrGraph();
+
+    // Replaces the whole graph; vertex v is named vertexNames[v] and has hash
+    // ID vertexIds[v]. Edges may be listed once or in both directions;
+    // duplicates and self-loops are dropped.
+    void build(StringArena vertexNames, StringArena vertexIds,
+               const vector<pair<VertexId, VertexId>>& edgeList);
+    // Uses externally owned CSR arrays as the base without copying them.
+    // `backing` is held for as long as the arrays are referenced.
+    void adopt(StringArena vertexNames, StringArena vertexIds, span<const uint64_t> csrOffsets,
+               span<const VertexId> csrAdj, shared_ptr<const void> backingMemory);
+    void clear();
+    void compact();
+    // While held, mutations never trigger compact(); releasing runs the
+    // check once. Lets a batch of edits compact at most once, at the end.
+    void holdCompaction(bool hold);
+    // Replaces every vertex's hash ID (vertexIds[v] for v < vertexSlots()),
+    // folding added vertices into a fresh name table.
+    void setIds(StringArena vertexIds);
+    void detach();   // copy an adopted base into owned storage
+
+    // Reuses a removed vertex ID when there is one. INVALID_VERTEX if the
+    // name exists.
+    VertexId addVertex(string_view name, string_view id);
+    bool removeVertex(VertexId v);   // O(degree)
+    bool addEdge(VertexId a, VertexId b);
+    bool removeEdge(VertexId a, VertexId b);
+
+    VertexId find(string_view name) const;
+    VertexId findId(string_view id) const;   // live vertex with this hash ID
+    // Valid until the next addVertex() (or, for a copy, as long as it lives).
+    string_view name(VertexId v) const {
+        StringHandle h = addedHandle(v);
+        return h == INVALID_HANDLE ? base->names[v] : addedNames[h];
+    }
+    string_view id(VertexId v) const {
+        StringHandle h = addedHandle(v);
+        return h == INVALID_HANDLE ? base->ids[v] : addedIds[h];
+    }
+    bool isAlive(VertexId v) const { return v < alive.size() && alive[v]; }
+
+    size_t vertexSlots() const { return alive.size(); }  // includes removed IDs not yet reused
+    size_t vertexCount() const { return aliveCount; }
+    size_t edgeCount() const { return edges; }
+
+    span<const VertexId> neighbors(VertexId v) const;
+    span<const uint64_t> csrOffsets() const { return csr->offsets; }
+    span<const VertexId> csrAdjacency() const { return csr->adj; }
+    bool hasDelta() const { return !delta.empty() || csr->offsets.size() != alive.size() + 1; }
+    // True if v's row is no longer the one in the base arrays (edited, or
+    // added since they were built).
+    bool rowChanged(VertexId v) const {
+        return v + 1 >= csr->offsets.size() || (!delta.empty() && delta.count(v));
+    }
+    // Identifies the base arrays; replaced whenever they are rebuilt.
+    shared_ptr<const void> csrArrays() const { return csr; }
+    size_t degree(VertexId v) const { return neighbors(v).size(); }
+    bool hasEdge(VertexId a, VertexId b) const;
+};
+
+#endif
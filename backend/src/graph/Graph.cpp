@@ -1,138 +1,467 @@
 #include "Graph.hpp"
+#include "../utils/Metrics.hpp"
 #include <iostream>
 #include <queue>
 #include <algorithm>
 #include <iomanip>
+#include <chrono>
+#include <filesystem>
 
 using namespace std;
 
-// Constructor: load CSV data at start
-Graph::Graph(bool silentMode) : fileManager("dataset/users.csv", silentMode), silent(silentMode)  {
-    fileManager.loadWithHashes(adjList, idToUser, userToId);
+// Constructor: load the binary snapshot if it is current, else the CSV, then
+// replay the write-ahead log on top
+Graph::Graph(bool silentMode)
+    : fileManager("dataset/users.csv", silentMode), wal(fileManager.getLogPath()), silent(silentMode)  {
+    uint64_t baseLsn = 0;
+    if (!fileManager.snapshotIsCurrent() ||
+        !fileManager.loadSnapshot(core, pageRank, baseLsn))
+        fileManager.loadWithHashes(core, workers());
     buildTrie();
+
+    size_t replayed = wal.recover(baseLsn, [this](const WalRecord& r) { applyLogRecord(r); });
+    if (!silent && replayed)
+        cout << "Replayed " << replayed << " logged mutations\n";
+    if (wal.hasRotated()) checkpoint();  // finish a checkpoint that was interrupted
+}
+
+Graph::~Graph() {
+    if (checkpointThread.joinable()) checkpointThread.join();
+    if (walkSegmentsThread.joinable()) walkSegmentsThread.join();
 }
 
 // =================== USER MANAGEMENT ===================
 
 bool Graph::addUser(const string& username) {
-    if (adjList.count(username)) return false;
-    string id = generateHashId(username);
-    userToId[username] = id;
-    idToUser[id] = username;
-    adjList[username];
-    fileManager.addUser(id, username);
-    buildTrie();
+    METRIC_TIMER(AddUserSeconds);
+    if (username.size() > MAX_USERNAME_BYTES || core.find(username) != INVALID_VERTEX) return false;
+    string id = newUserId(username);
+    if (!applyAddUser(username, id)) return false;
+    wal.append(WalOp::AddUser, username, id);
+    return true;
+}
+
+// First salted hash of the username that no live user holds.
+string Graph::newUserId(const string& username) const {
+    char buf[USER_ID_CHARS];
+    string_view id;
+    for (uint32_t attempt = 0;; ++attempt) {
+        id = formatUserId(userIdHash(username, attempt), buf);
+        if (core.findId(id) == INVALID_VERTEX) break;
+        METRIC_ADD(UserIdCollisions, 1);
+    }
+    return string(id);
+}
+
+// Legacy IDs get the 64-bit ID addUser() would give them; IDs already in
+// the new format are kept, so running this twice changes nothing. The
+// result is written by a checkpoint rather than logged record by record.
+bool Graph::migrateIds(size_t& migrated) {
+    size_t slots = core.vertexSlots();
+    StringArena ids, oldIds;
+    unordered_set<uint64_t> assigned;   // new IDs handed out so far
+    migrated = 0;
+    char buf[USER_ID_CHARS];
+    for (VertexId v = 0; v < slots; ++v) {
+        string_view id = core.id(v);
+        oldIds.add(id);
+        if (!core.isAlive(v) || !isLegacyUserId(id)) { ids.add(id); continue; }
+        for (uint32_t attempt = 0;; ++attempt) {
+            uint64_t h = userIdHash(core.name(v), attempt);
+            id = formatUserId(h, buf);
+            if (core.findId(id) == INVALID_VERTEX && assigned.insert(h).second) break;
+        }
+        ids.add(id);
+        migrated++;
+    }
+    if (!migrated) return true;
+    // The new IDs are not logged; they only exist once the checkpoint is on
+    // disk, so undo them if it isn't.
+    core.setIds(std::move(ids));
+    version++;
+    if (!checkpoint()) {
+        core.setIds(std::move(oldIds));
+        version++;
+        migrated = 0;
+        return false;
+    }
     return true;
 }
 
 bool Graph::removeUser(const string& username) {
-    if (!adjList.count(username)) return false;
-    for (auto& entry : adjList) entry.second.erase(username);
-    adjList.erase(username);
-    if (userToId.count(username)) {
-        string id = userToId[username];
-        userToId.erase(username);
-        idToUser.erase(id);
-        fileManager.removeUser(id);
+    METRIC_TIMER(RemoveUserSeconds);
+    if (!applyRemoveUser(username)) return false;
+    wal.append(WalOp::RemoveUser, username);
+    return true;
+}
+
+// Every removal is logged as usual; the survivors' Trie ranks and cached
+// recommendations are settled once at the end instead of after each user,
+// since neighbors shared by several removed users would otherwise be
+// revisited each time.
+size_t Graph::removeUsers(const vector<string>& usernames) {
+    METRIC_TIMER(RemoveUserSeconds);
+    vector<VertexId> touched;
+    size_t removed = 0;
+    for (const string& username : usernames) {
+        if (!detachUser(username, touched)) continue;
+        wal.append(WalOp::RemoveUser, username);
+        removed++;
     }
-    buildTrie();
+    settleNeighbors(touched);
+    return removed;
+}
+
+bool Graph::applyAddUser(const string& username, const string& id) {
+    VertexId v = core.addVertex(username, id);
+    if (v == INVALID_VERTEX) return false;
+    version++;
+    rankNeedsFull = true;
+    if (v < pageRank.size()) pageRank[v] = 0.0;   // reused slot
+    userTrie.insert(username, v, 0);
+    components.addVertex(v);
+    recCache.invalidate(v);
+    return true;
+}
+
+bool Graph::applyRemoveUser(const string& username) {
+    vector<VertexId> touched;
+    if (!detachUser(username, touched)) return false;
+    settleNeighbors(touched);
+    return true;
+}
+
+// Removes the vertex and appends its former friends to `touched`.
+bool Graph::detachUser(const string& username, vector<VertexId>& touched) {
+    VertexId v = core.find(username);
+    if (v == INVALID_VERTEX) return false;
+    auto friends = core.neighbors(v);
+    touched.insert(touched.end(), friends.begin(), friends.end());
+    if (!friends.empty()) components.removeEdge();
+    core.removeVertex(v);
+    circles.refresh(core, v);
+    version++;
+    rankNeedsFull = true;
+    userTrie.erase(username);
+    recCache.invalidate(v);
     return true;
 }
 
+// Trie ranks, MinHash signatures and cached recommendations for users whose
+// friend lists changed, each visited once however many changes it saw.
+void Graph::settleNeighbors(vector<VertexId>& touched) {
+    sort(touched.begin(), touched.end());
+    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+    bool dropCache = touched.size() > BATCH_CACHE_CLEAR_USERS;
+    bool rebuildTrie = touched.size() > core.vertexCount() / 4;   // cheaper than re-ranking each
+    if (dropCache) recCache.clear();
+    if (rebuildTrie) buildTrie();
+    for (VertexId f : touched) {
+        if (!core.isAlive(f)) continue;
+        circles.refresh(core, f);
+        if (!rebuildTrie) rankInTrie(f);
+        if (!dropCache) recCache.invalidateAround(core, f);
+    }
+}
+
+// =================== BATCH MUTATION ===================
+
+namespace {
+struct PairHash {
+    size_t operator()(const pair<string_view, string_view>& p) const {
+        hash<string_view> h;
+        return h(p.first) * 0x9E3779B97F4A7C15ull ^ h(p.second);
+    }
+};
+} // namespace
+
+// The batch is reduced to its net effect before anything is applied:
+//   - a clear drops every operation before it and runs first;
+//   - the last add/remove of each user wins, and a user removed and then
+//     re-added is removed first (so it comes back without friends);
+//   - the last add/remove of each friendship wins, and friendship operations
+//     older than a removal of either user are dropped.
+// Users are then removed and added in name order, and friendships applied in
+// vertex order so consecutive edits land in the same rows. Because user
+// changes go first, a friendship may name a user added later in the batch.
+// The CSR delta is compacted, and Trie ranks and the recommendation cache
+// settled, once at the end; PageRank picks the changes up on its next refresh.
+MutationBatchStats Graph::applyBatch(span<const Mutation> ops) {
+    METRIC_TIMER(BatchApplySeconds);
+    auto start = chrono::steady_clock::now();
+    MutationBatchStats st;
+    st.submitted = ops.size();
+
+    size_t begin = 0;
+    bool clearFirst = false;
+    for (size_t i = ops.size(); i-- > 0;)
+        if (ops[i].op == WalOp::Clear) { begin = i + 1; clearFirst = true; break; }
+
+    struct UserPlan { size_t lastRemove = SIZE_MAX; bool add = false; };
+    struct EdgePlan { size_t at; bool add; };
+    unordered_map<string_view, UserPlan> users;
+    unordered_map<pair<string_view, string_view>, EdgePlan, PairHash> friendships;
+    for (size_t i = begin; i < ops.size(); ++i) {
+        const Mutation& m = ops[i];
+        switch (m.op) {
+            case WalOp::AddUser: users[m.a].add = true; break;
+            case WalOp::RemoveUser: users[m.a] = {i, false}; break;
+            case WalOp::AddFriendship:
+            case WalOp::RemoveFriendship: {
+                if (m.a == m.b) break;
+                auto key = m.a < m.b ? pair<string_view, string_view>{m.a, m.b}
+                                     : pair<string_view, string_view>{m.b, m.a};
+                friendships[key] = {i, m.op == WalOp::AddFriendship};
+                break;
+            }
+            case WalOp::Clear: break;
+        }
+    }
+
+    vector<string_view> removals, additions;
+    for (auto& [name, plan] : users) {
+        if (plan.lastRemove != SIZE_MAX) removals.push_back(name);
+        if (plan.add) additions.push_back(name);
+    }
+    sort(removals.begin(), removals.end());
+    sort(additions.begin(), additions.end());
+    st.planned = clearFirst + removals.size() + additions.size();
+
+    bool changed = false;
+    vector<VertexId> touched;
+    core.holdCompaction(true);
+    if (clearFirst) {
+        applyClear();
+        wal.append(WalOp::Clear, "");
+        st.applied++;
+        changed = true;
+    }
+    for (string_view name : removals) {
+        string username(name);
+        if (!detachUser(username, touched)) continue;
+        wal.append(WalOp::RemoveUser, username);
+        st.applied++;
+        changed = true;
+    }
+    for (string_view name : additions) {
+        string username(name);
+        if (username.size() > MAX_USERNAME_BYTES || core.find(username) != INVALID_VERTEX) continue;
+        string id = newUserId(username);
+        if (!applyAddUser(username, id)) continue;
+        wal.append(WalOp::AddUser, username, id);
+        st.applied++;
+        changed = true;
+    }
+
+    struct EdgeOp { VertexId a, b; bool add; };
+    vector<EdgeOp> edgeOps;
+    edgeOps.reserve(friendships.size());
+    for (auto& [key, plan] : friendships) {
+        auto removedAt = [&](string_view u) {
+            auto it = users.find(u);
+            return it == users.end() ? SIZE_MAX : it->second.lastRemove;
+        };
+        size_t ra = removedAt(key.first), rb = removedAt(key.second);
+        if ((ra != SIZE_MAX && ra > plan.at) || (rb != SIZE_MAX && rb > plan.at)) continue;
+        st.planned++;
+        VertexId a = core.find(key.first), b = core.find(key.second);
+        if (a == INVALID_VERTEX || b == INVALID_VERTEX) continue;
+        edgeOps.push_back({min(a, b), max(a, b), plan.add});
+    }
+    sort(edgeOps.begin(), edgeOps.end(),
+         [](const EdgeOp& x, const EdgeOp& y) { return x.a != y.a ? x.a < y.a : x.b < y.b; });
+
+    for (const EdgeOp& e : edgeOps) {
+        if (e.add ? !core.addEdge(e.a, e.b) : !core.removeEdge(e.a, e.b)) continue;
+        noteEdgeChange(e.a, e.b, e.add);
+        if (e.add) components.addEdge(e.a, e.b);
+        else components.removeEdge();
+        touched.push_back(e.a);
+        touched.push_back(e.b);
+        string u1(core.name(e.a)), u2(core.name(e.b));
+        wal.append(e.add ? WalOp::AddFriendship : WalOp::RemoveFriendship, u1, u2);
+        st.applied++;
+        changed = true;
+    }
+
+    core.holdCompaction(false);
+    if (changed) version++;
+    settleNeighbors(touched);
+    st.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return st;
+}
+
 // =================== FRIENDSHIP MANAGEMENT ===================
 
 bool Graph::addFriendship(const string& u1, const string& u2) {
-    if (u1 == u2) return false;
-    if (!adjList.count(u1) || !adjList.count(u2)) return false;
-    adjList[u1].insert(u2);
-    adjList[u2].insert(u1);
-    fileManager.updateFriendships(adjList, userToId);
+    METRIC_TIMER(AddFriendshipSeconds);
+    VertexId a = core.find(u1), b = core.find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX || a == b) return false;
+    if (applyAddFriendship(u1, u2)) wal.append(WalOp::AddFriendship, u1, u2);
     return true;
 }
 
 bool Graph::removeFriendship(const string& u1, const string& u2) {
-    if (!adjList.count(u1) || !adjList.count(u2)) return false;
-    adjList[u1].erase(u2);
-    adjList[u2].erase(u1);
-    fileManager.updateFriendships(adjList, userToId);
+    METRIC_TIMER(RemoveFriendshipSeconds);
+    VertexId a = core.find(u1), b = core.find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX) return false;
+    if (applyRemoveFriendship(u1, u2)) wal.append(WalOp::RemoveFriendship, u1, u2);
+    return true;
+}
+
+// Both return whether the edge set actually changed.
+bool Graph::applyAddFriendship(const string& u1, const string& u2) {
+    VertexId a = core.find(u1), b = core.find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX || !core.addEdge(a, b)) return false;
+    version++;
+    noteEdgeChange(a, b, true);
+    components.addEdge(a, b);
+    circles.addEdge(a, b);
+    rankInTrie(a);
+    rankInTrie(b);
+    recCache.invalidateAround(core, a);
+    recCache.invalidateAround(core, b);
+    return true;
+}
+
+bool Graph::applyRemoveFriendship(const string& u1, const string& u2) {
+    VertexId a = core.find(u1), b = core.find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX || !core.removeEdge(a, b)) return false;
+    version++;
+    noteEdgeChange(a, b, false);
+    components.removeEdge();
+    circles.removeEdge(core, a, b);
+    rankInTrie(a);
+    rankInTrie(b);
+    // Anything within two hops before the removal is still within two hops
+    // of a or b afterwards, so walking the new graph is enough.
+    recCache.invalidateAround(core, a);
+    recCache.invalidateAround(core, b);
     return true;
 }
 
+void Graph::applyLogRecord(const WalRecord& r) {
+    switch (r.op) {
+        case WalOp::AddUser: applyAddUser(r.a, r.b); break;
+        case WalOp::RemoveUser: applyRemoveUser(r.a); break;
+        case WalOp::AddFriendship: applyAddFriendship(r.a, r.b); break;
+        case WalOp::RemoveFriendship: applyRemoveFriendship(r.a, r.b); break;
+        case WalOp::Clear: applyClear(); break;
+    }
+}
+
 // =================== FRIEND QUERYING ===================
 
 vector<string> Graph::getFriends(const string& username) const {
-    vector<string> result;
-    auto it = adjList.find(username);
-    if (it == adjList.end()) return result;
-    result.insert(result.end(), it->second.begin(), it->second.end());
-    return result;
+    return friendNames(core, username);
 }
 
 vector<string> Graph::getMutualFriends(const string& u1, const string& u2) const {
-    vector<string> mutual;
-    auto it1 = adjList.find(u1);
-    auto it2 = adjList.find(u2);
-    if (it1 == adjList.end() || it2 == adjList.end()) return mutual;
-
-    const auto& set1 = it1->second;
-    const auto& set2 = it2->second;
-    for (const auto& f : set1)
-        if (set2.find(f) != set2.end()) mutual.push_back(f);
-    return mutual;
-}
-
-bool Graph::areConnected(const string& u1, const string& u2) const {
-    if (u1 == u2) return true;
-    if (!adjList.count(u1) || !adjList.count(u2)) return false;
-
-    unordered_set<string> visited;
-    queue<string> q;
-    q.push(u1);
-    visited.insert(u1);
-
-    while (!q.empty()) {
-        auto curr = q.front();
-        q.pop();
-        for (const auto& nei : adjList.at(curr)) {
-            if (nei == u2) return true;
-            if (visited.insert(nei).second)
-                q.push(nei);
-        }
+    return mutualFriendNames(core, u1, u2);
+}
+
+// Two root lookups in the common case. Only when removals have left the
+// labels stale and both users still share one does it fall back to BFS; a
+// "no" there proves the labels wrong, so they are rebuilt straight away.
+bool Graph::areConnected(const string& u1, const string& u2) {
+    VertexId src = core.find(u1), dst = core.find(u2);
+    if (src == INVALID_VERTEX || dst == INVALID_VERTEX) return false;
+
+    switch (freshComponents(false).connected(src, dst)) {
+        case ConnectedComponents::Answer::No: return false;
+        case ConnectedComponents::Answer::Yes: return true;
+        case ConnectedComponents::Answer::Unknown: break;
+    }
+    bool found = pathFinder.find(core, src, dst).found;
+    if (!found || ++staleComponentQueries >= COMPONENT_REBUILD_QUERIES)
+        freshComponents(true);
+    return found;
+}
+
+ComponentStats Graph::componentStats() {
+    return freshComponents(true).stats(core);
+}
+
+// exact: also rebuild labels that removals have made stale.
+ConnectedComponents& Graph::freshComponents(bool exact) {
+    if (!components.isBuilt() || (exact && components.isStale())) {
+        components.build(core, workers());
+        staleComponentQueries = 0;
     }
-    return false;
+    return components;
+}
+
+vector<string> Graph::shortestPath(const string& u1, const string& u2, int maxDepth) const {
+    vector<string> chain;
+    VertexId src = core.find(u1), dst = core.find(u2);
+    if (src == INVALID_VERTEX || dst == INVALID_VERTEX) return chain;
+    for (VertexId v : pathFinder.find(core, src, dst, maxDepth).path)
+        chain.emplace_back(core.name(v));
+    return chain;
 }
 
 // =================== PAGE RANK ===================
 
-void Graph::computePageRank() {
-    int N = adjList.size();
-    if (N == 0) {
+PageRankResult Graph::computePageRank(const PageRankOptions& opts) {
+    if (core.vertexCount() == 0) {
         cout << "Graph is empty.\n";
-        return;
+        return {};
     }
 
-    double initRank = 1.0 / N;
-    for (auto& p : adjList)
-        pageRank[p.first] = initRank;
+    rankOptions = opts;
+    pageRank.clear();  // cold start
+    rankResidual.clear();
+    rankNeedsFull = false;
+    auto result = ::computePageRank(core, pageRank, opts, workers());
+    rankChanged();
 
-    for (int i = 0; i < iterations; i++) {
-        unordered_map<string, double> newRank;
-        for (auto& p : adjList)
-            newRank[p.first] = (1.0 - damping) / N;
+    cout << "\nPageRank computed successfully!\n";
+    cout << (result.converged ? "Converged" : "Stopped") << " after " << result.iterations
+         << " iterations (residual " << scientific << setprecision(2) << result.residual
+         << ", " << fixed << setprecision(2) << result.millis << " ms)\n";
+    return result;
+}
 
-        for (auto& p : adjList) {
-            const auto& u = p.first;
-            const auto& friends = p.second;
-            if (friends.empty()) continue;
+// Keeps influence scores fresh without a cold recompute per write: edge
+// changes are pushed out locally, anything that changes N or the dangling set
+// gets a warm-started power iteration from the previous vector.
+PageRankResult Graph::refreshPageRank() {
+    if (core.vertexCount() == 0) return {};
+    if (pageRank.empty()) {
+        rankResidual.clear();
+        rankNeedsFull = false;
+        rankChanged();
+        return ::computePageRank(core, pageRank, rankOptions, workers());
+    }
 
-            double share = damping * pageRank[u] / friends.size();
-            for (const auto& v : friends)
-                newRank[v] += share;
+    PageRankResult result;
+    if (!rankNeedsFull) {
+        if (rankResidual.empty()) {
+            result.converged = true;
+            return result;
         }
-        pageRank = newRank;
+        rankChanged();
+        result = pushResidual(core, pageRank, rankResidual, rankOptions);
+        if (result.converged) return result;
     }
 
-    cout << "\nPageRank computed successfully!\n";
+    rankResidual.clear();
+    rankNeedsFull = false;
+    rankChanged();
+    return ::computePageRank(core, pageRank, rankOptions, workers());
+}
+
+void Graph::noteEdgeChange(VertexId a, VertexId b, bool added) {
+    if (pageRank.empty() || rankNeedsFull) return;
+    // An endpoint entering or leaving degree 0 moves mass between the
+    // link structure and the uniform dangling term: not a local change.
+    size_t boundary = added ? 1 : 0;
+    if (core.degree(a) == boundary || core.degree(b) == boundary) {
+        rankNeedsFull = true;
+        rankResidual.clear();
+        return;
+    }
+    accumulateEdgeResidual(core, pageRank, a, b, added, rankOptions.damping, rankResidual);
 }
 
 void Graph::displayPageRank() const {
@@ -141,90 +470,306 @@ void Graph::displayPageRank() const {
         return;
     }
     cout << "\n--- PageRank Scores ---\n";
-    for (auto& p : pageRank)
-        cout << p.first << ": " << fixed << setprecision(4) << p.second << "\n";
+    for (VertexId v = 0; v < pageRank.size(); ++v)
+        if (core.isAlive(v))
+            cout << core.name(v) << ": " << fixed << setprecision(4) << pageRank[v] << "\n";
 }
 
 // =================== FRIEND RECOMMENDATION ===================
 
-vector<pair<string, double>> Graph::recommendFriends(const string& user, int topK) const {
-    if (!adjList.count(user)) {
-        cout << "User not found.\n";
-        return {};
+vector<pair<string, double>> Graph::recommendFriends(const string& user, int topK, ScoreFunction fn,
+                                                     WalkOptions walk) {
+    vector<pair<string, double>> result;
+    if (!cachedRecommendations(user, max(topK, 0), fn, result)) {
+        VertexId u = core.find(user);
+        if (u != INVALID_VERTEX) {
+            if (fn == ScoreFunction::PersonalizedPageRank) walk.segments = freshWalkSegments();
+            const MinHashIndex* index = fn == ScoreFunction::SimilarCircles ? &freshCircles() : nullptr;
+            auto recs = recommender.recommend(core, u, max(topK, 0), fn, pageRank, walk, index);
+            recCache.store(u, fn, max(topK, 0), recs);
+            for (auto& r : recs)
+                result.emplace_back(core.name(r.vertex), r.score);
+        }
     }
+    printRecommendations(cout, user, core.find(user) != INVALID_VERTEX, result);
+    return result;
+}
 
-    unordered_set<string> friends = adjList.at(user);
-    friends.insert(user);
+bool Graph::cachedRecommendations(const string& user, size_t topK, ScoreFunction fn,
+                                  vector<pair<string, double>>& out) {
+    VertexId u = core.find(user);
+    if (u == INVALID_VERTEX) return false;
+    if (fn == ScoreFunction::PageRankMutual) refreshPageRank();
+
+    vector<Recommendation> recs;
+    if (!recCache.lookup(u, fn, topK, recs)) return false;
+    out.clear();
+    for (auto& r : recs)
+        out.emplace_back(core.name(r.vertex), r.score);
+    return true;
+}
 
-    unordered_map<string, double> score;
+void Graph::storeRecommendations(const GraphSnapshot& snap, const string& user, size_t topK,
+                                 ScoreFunction fn, const vector<Recommendation>& recs) {
+    // Anything that changed since the snapshot may have invalidated the list.
+    if (snap.version != version || (fn == ScoreFunction::PageRankMutual && snap.rankVersion != rankVersion))
+        return;
+    VertexId u = core.find(user);
+    if (u != INVALID_VERTEX) recCache.store(u, fn, topK, recs);
+}
 
-    for (const auto& p : adjList) {
-        const string& candidate = p.first;
-        if (friends.count(candidate)) continue;
+void printRecommendations(ostream& out, const string& user, bool found,
+                          const vector<pair<string, double>>& recs) {
+    if (!found) {
+        out << "User not found.\n";
+        return;
+    }
+    out << "\n--- Friend Recommendations for " << user << " ---\n";
+    for (auto& p : recs)
+        out << p.first << " | Score: " << fixed << setprecision(4) << p.second << "\n";
 
-        auto mutual = getMutualFriends(user, candidate);
-        double mutualCount = mutual.size();
-        double influence = pageRank.count(candidate) ? pageRank.at(candidate) : 1.0;
+    if (recs.empty())
+        out << "No friend recommendations available.\n";
+}
 
-        score[candidate] = mutualCount * influence;
-    }
+BatchResult Graph::recommendAll(size_t topK, ScoreFunction fn, size_t threads, ostream& out,
+                                WalkOptions walk) {
+    if (fn == ScoreFunction::PageRankMutual) refreshPageRank();
+    if (fn == ScoreFunction::PersonalizedPageRank) walk.segments = freshWalkSegments();
+    const MinHashIndex* index = fn == ScoreFunction::SimilarCircles ? &freshCircles() : nullptr;
+    return ::recommendAll(core, topK, fn, pageRank, workers(), threads, out, walk, index);
+}
 
-    vector<pair<string, double>> sorted(score.begin(), score.end());
-    sort(sorted.begin(), sorted.end(),
-         [](auto& a, auto& b) { return a.second > b.second; });
+void Graph::enableWalkSegments(uint32_t perVertex) {
+    if (walkSegmentsThread.joinable()) walkSegmentsThread.join();
+    rebuiltWalkSegments.store(nullptr);
+    walkSegmentsPerVertex = perVertex;
+    walkSegments.reset();
+    if (!perVertex) {
+        cout << "Walk segments disabled.\n";
+        return;
+    }
+    auto start = chrono::steady_clock::now();
+    freshWalkSegments();
+    double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Precomputed " << walkSegments->segmentsPerVertex() << " walk segments for each of "
+         << walkSegments->vertexCount() << " users (" << fixed << setprecision(1)
+         << walkSegments->bytes() / 1e6 << " MB) in " << millis << " ms\n";
+}
 
-    cout << "\n--- Friend Recommendations for " << user << " ---\n";
-    int count = 0;
-    for (auto& p : sorted) {
-        if (p.second <= 0) continue;
-        cout << p.first << " | Score: " << fixed << setprecision(4) << p.second << "\n";
-        if (++count >= topK) break;
+// Segments follow the base CSR arrays, so they only go stale when the graph
+// compacts; rows edited since are skipped by the walker itself. Rebuilding
+// costs O(vertices x perVertex), so after a compaction it happens on its own
+// thread (and pool, leaving workers() free) from a copy of the graph, and
+// the stale set stays in place meanwhile: the walker ignores segments that
+// don't match the graph and samples the adjacency rows instead, so queries
+// stay bounded by their walk budget. Only the first build, from
+// enableWalkSegments(), runs inline.
+const WalkSegments* Graph::freshWalkSegments() {
+    if (!walkSegmentsPerVertex) return nullptr;
+    if (auto rebuilt = rebuiltWalkSegments.exchange(nullptr)) {
+        walkSegmentsThread.join();
+        walkSegments = std::move(rebuilt);
     }
+    if (!walkSegments) {
+        walkSegments = WalkSegments::build(core, walkSegmentsPerVertex, workers());
+    } else if (!walkSegments->builtFor(core) && !walkSegmentsThread.joinable()) {
+        auto frozen = make_shared<const CsrGraph>(core);
+        walkSegmentsThread = thread([this, frozen, perVertex = walkSegmentsPerVertex] {
+            ThreadPool pool;
+            rebuiltWalkSegments.store(WalkSegments::build(*frozen, perVertex, pool));
+        });
+    }
+    return walkSegments.get();
+}
 
-    if (count == 0)
-        cout << "No friend recommendations available.\n";
+// =================== SIMILAR USERS ===================
 
-    return sorted;
+vector<pair<string, double>> Graph::similarUsers(const string& user, int topK) {
+    vector<pair<string, double>> result;
+    VertexId u = core.find(user);
+    if (u == INVALID_VERTEX) {
+        cout << "User not found.\n";
+        return result;
+    }
+    for (auto& r : lshProbe.similar(freshCircles(), core, u, max(topK, 0), false))
+        result.emplace_back(core.name(r.vertex), r.score);
+
+    cout << "\n--- Users with Friend Circles Like " << user << "'s ---\n";
+    for (auto& p : result)
+        cout << p.first << " | Jaccard: " << fixed << setprecision(4) << p.second << "\n";
+    if (result.empty())
+        cout << "No similar users found.\n";
+    return result;
+}
+
+// Built on first use, then kept in step by every mutation; the sorted base
+// is only redone once enough users have moved off it.
+const MinHashIndex& Graph::freshCircles() {
+    if (!circles.isBuilt()) circles.build(core, workers());
+    else if (circles.needsSort()) circles.sortBands(workers());
+    return circles;
 }
 
 // =================== DISPLAY AND UTILITY ===================
 
 void Graph::displayAllUsers() const {
     cout << "\n--- Users and their Friends ---\n";
-    if (adjList.empty()) {
+    if (core.vertexCount() == 0) {
         cout << "(Graph is empty)\n";
         return;
     }
-    for (const auto& entry : adjList) {
-        cout << "- " << entry.first << ": ";
-        for (const auto& f : entry.second)
-            cout << f << " ";
+    for (VertexId v = 0; v < core.vertexSlots(); ++v) {
+        if (!core.isAlive(v)) continue;
+        cout << "- " << core.name(v) << ": ";
+        for (VertexId f : core.neighbors(v))
+            cout << core.name(f) << " ";
         cout << "\n";
     }
 }
 
+vector<string> Graph::getUsers() const {
+    vector<string> users;
+    users.reserve(core.vertexCount());
+    for (VertexId v = 0; v < core.vertexSlots(); ++v)
+        if (core.isAlive(v)) users.emplace_back(core.name(v));
+    return users;
+}
+
 void Graph::clear() {
-    adjList.clear();
-    pageRank.clear();
-    userToId.clear();
-    idToUser.clear();
-    fileManager.saveWithHashes(adjList, idToUser, userToId);
-    buildTrie();
+    applyClear();
+    wal.append(WalOp::Clear, "");
     cout << "Graph cleared.\n";
 }
 
-void Graph::save() {
-    fileManager.saveWithHashes(adjList, idToUser, userToId);
+void Graph::applyClear() {
+    core.clear();
+    version++;
+    pageRank.clear();
+    rankResidual.clear();
+    rankNeedsFull = false;
+    userTrie.clear();
+    components.reset();
+    circles.reset();
+    recCache.clear();
+    // walkSegments no longer match and are rebuilt like after a compaction.
+}
+
+// =================== PERSISTENCE ===================
+
+bool Graph::save() {
+    if (!wal.commit()) return false;
+    if (wal.size() > CHECKPOINT_LOG_BYTES)
+        checkpoint(backgroundCheckpoints);
+    return true;
+}
+
+namespace {
+// Frozen copy of everything a checkpoint writes, so the live graph can keep
+// taking mutations while a background checkpoint runs.
+struct CheckpointState {
+    CsrGraph core;
+    vector<double> pageRank;
+};
+}
+
+void Graph::waitForCheckpoint() {
+    if (checkpointThread.joinable()) checkpointThread.join();
+}
+
+bool Graph::checkpoint(bool background) {
+    waitForCheckpoint();
+#ifdef _WIN32
+    core.detach();  // Windows can't replace a file that is still mapped
+#endif
+
+    uint64_t lsn;
+    if (!wal.rotate(lsn)) return false;  // the log still holds everything; retry later
+    auto state = make_shared<CheckpointState>(CheckpointState{core, pageRank});
+    auto job = [this, state, lsn] {
+        // CSV first so the snapshot ends up newer and stays the startup source.
+        // Either file alone is newer than the last snapshot, so the state is
+        // saved once one of them is written; only a snapshot ends the log.
+        bool csv = fileManager.saveWithHashes(state->core);
+        if (!fileManager.saveSnapshot(state->core, state->pageRank, "", lsn)) return csv;
+        wal.dropRotated();
+        return true;
+    };
+
+    if (!background) return job();
+    checkpointThread = thread(job);
+    return true;
+}
+
+bool Graph::exportSnapshot(const string& path) {
+    waitForCheckpoint();
+    if (!pageRank.empty()) refreshPageRank();
+#ifdef _WIN32
+    core.detach();
+#endif
+    wal.commit();
+    return fileManager.saveSnapshot(core, pageRank, path, wal.lastLsn());
+}
+
+bool Graph::partition(uint32_t shards, PartitionScheme scheme, const string& dir, PartitionStats& stats) {
+    if (shards == 0) return false;
+    auto owner = partitionVertices(core, shards, scheme);
+    return writePartition(dir.empty() ? defaultPartitionDir() : dir, core, owner, shards, scheme, stats);
+}
+
+string Graph::defaultPartitionDir() const {
+    return (filesystem::path(fileManager.getSnapshotPath()).parent_path() / "shards").string();
+}
+
+void Graph::rankChanged() {
+    rankVersion++;
+    recCache.bumpEpoch();
+}
+
+// =================== SNAPSHOTS ===================
+
+// Copies are cheap (see CsrGraph), and a new version is only made when the
+// graph or the ranks changed since the last one.
+shared_ptr<const GraphSnapshot> Graph::publish(bool withRank, bool withWalks) {
+    if (withRank) refreshPageRank();
+    if (withWalks) freshWalkSegments();
+    auto current = published.load(memory_order_acquire);
+    if (current && current->version == version && current->rankVersion == rankVersion &&
+        current->walkSegments == walkSegments)
+        return current;
+
+    auto snap = make_shared<GraphSnapshot>();
+    snap->graph = core;
+    snap->version = version;
+    snap->rankVersion = rankVersion;
+    if (current && current->rankVersion == rankVersion) snap->pageRank = current->pageRank;
+    else if (!pageRank.empty()) snap->pageRank = make_shared<const vector<double>>(pageRank);
+    snap->walkSegments = walkSegments;
+    published.store(snap, memory_order_release);
+    return snap;
+}
+
+ThreadPool& Graph::workers() {
+    if (!pool) pool = make_unique<ThreadPool>();
+    return *pool;
 }
 
 // =================== TRIE SEARCH ===================
 
+// Autocomplete ranks users by friend count; mutations keep the ranking
+// current through rankInTrie(), so this only runs after a bulk load.
 void Graph::buildTrie() {
-    userTrie = Trie(); // reset
-    for(auto& [user, _] : adjList)
-        userTrie.insert(user);
+    userTrie.clear();
+    for (VertexId v = 0; v < core.vertexSlots(); ++v)
+        if (core.isAlive(v)) userTrie.insertUnranked(core.name(v), v, core.degree(v));
+    userTrie.rerank();
+}
+
+void Graph::rankInTrie(VertexId v) {
+    userTrie.setScore(core.name(v), core.degree(v));
 }
 
-vector<string> Graph::searchPrefix(const string& prefix) {
-return userTrie.prefixSearch(prefix);
-}
\ No newline at end of file
+vector<string> Graph::searchPrefix(const string& prefix) const {
+    METRIC_TIMER(SearchSeconds);
+    return userTrie.prefixSearch(prefix);
+}
@@ -5,50 +5,202 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <thread>
+#include "CsrGraph.hpp"
+#include "Recommender.hpp"
+#include "PageRank.hpp"
+#include "PathFinder.hpp"
+#include "Components.hpp"
+#include "BatchRecommend.hpp"
+#include "RecommendationCache.hpp"
+#include "GraphReader.hpp"
+#include "../cluster/Partition.hpp"
 #include "../io/FileManager.hpp"
-#include "../utils/utils.hpp"
+#include "../io/WriteAheadLog.hpp"
+#include "../utils/Utils.hpp"
 #include "../search/Trie.hpp"
 
 using namespace std;
 
+// Log size at which save() folds the write-ahead log into a new snapshot.
+constexpr size_t CHECKPOINT_LOG_BYTES = 8 << 20;
+// Entries (user x score function) kept by the recommendation cache.
+constexpr size_t RECOMMENDATION_CACHE_ENTRIES = 4096;
+// Connectivity queries answered by BFS (because removals left the component
+// labels stale) before the labels are rebuilt.
+constexpr size_t COMPONENT_REBUILD_QUERIES = 16;
+// Users touched by one mutation batch beyond which the recommendation cache
+// is dropped whole rather than invalidated two hops around each of them.
+constexpr size_t BATCH_CACHE_CLEAR_USERS = 256;
+
+// One operation for applyBatch(): the same vocabulary the log records. `b`
+// is the second username of a friendship and unused otherwise.
+struct Mutation {
+    WalOp op;
+    string a, b;
+};
+
+struct MutationBatchStats {
+    size_t submitted = 0;
+    size_t planned = 0;        // left after dropping duplicates and superseded operations
+    size_t applied = 0;        // operations that changed the graph
+    double millis = 0.0;
+
+    double opsPerSec() const { return millis > 0 ? submitted * 1000.0 / millis : 0.0; }
+};
+
 class Graph {
 private:
-    unordered_map<string, unordered_set<string>> adjList;
-    unordered_map<string, double> pageRank;
-    unordered_map<string, string> userToId;  // username -> id
-    unordered_map<string, string> idToUser;  // id -> username
+    CsrGraph core;
+    vector<double> pageRank;                 // indexed by vertex, empty until computed
+    PageRankOptions rankOptions;
+    unordered_map<VertexId, double> rankResidual;  // pending incremental correction
+    bool rankNeedsFull = false;              // vertex set or dangling set changed
+    uint64_t version = 0;                    // bumped by every graph mutation
+    uint64_t rankVersion = 0;                // bumped whenever pageRank changes
+    atomic<shared_ptr<const GraphSnapshot>> published;
 
-    double damping = 0.85;
-    int iterations = 20;
+    unique_ptr<ThreadPool> pool;             // created on first parallel job
+
+    Recommender recommender;                 // reusable 2-hop scratch buffers
+    RecommendationCache recCache{RECOMMENDATION_CACHE_ENTRIES};
+    shared_ptr<const WalkSegments> walkSegments;   // null unless enabled
+    uint32_t walkSegmentsPerVertex = 0;
+    thread walkSegmentsThread;               // rebuilds them after a compaction
+    atomic<shared_ptr<const WalkSegments>> rebuiltWalkSegments;   // handed over by that thread
+    mutable PathFinder pathFinder;           // reusable BFS scratch buffers
+    ConnectedComponents components;          // built on first connectivity query
+    size_t staleComponentQueries = 0;        // BFS fallbacks since the last build
+    MinHashIndex circles;                    // built on first similarity query
+    LshProbe lshProbe;                       // reusable --similar scratch buffers
 
     FileManager fileManager;
-    Trie userTrie;
+    WriteAheadLog wal;
+    thread checkpointThread;
+    bool backgroundCheckpoints = false;
+    Trie userTrie;                           // usernames ranked by degree
     bool silent;
 
+    ThreadPool& workers();
+    void noteEdgeChange(VertexId a, VertexId b, bool added);
+    void rankInTrie(VertexId v);
+    void rankChanged();
+    ConnectedComponents& freshComponents(bool exact);
+    const WalkSegments* freshWalkSegments();
+    const MinHashIndex& freshCircles();
+
+    // Mutations without logging; shared by the public API and log replay.
+    bool applyAddUser(const string& username, const string& id);
+    bool applyRemoveUser(const string& username);
+    bool detachUser(const string& username, vector<VertexId>& touched);
+    void settleNeighbors(vector<VertexId>& touched);
+    string newUserId(const string& username) const;
+    bool applyAddFriendship(const string& u1, const string& u2);
+    bool applyRemoveFriendship(const string& u1, const string& u2);
+    void applyClear();
+    void applyLogRecord(const WalRecord& r);
+
 public:
     Graph(bool silentMode = false);
+    ~Graph();
 
+    // False if the user exists or the name is over MAX_USERNAME_BYTES.
     bool addUser(const string& username);
     bool removeUser(const string& username);
+    // Removes many users in one pass; returns how many existed. Each costs
+    // O(its degree), not O(users).
+    size_t removeUsers(const vector<string>& usernames);
+
+    // Applies a stream of mutations in one pass (see Graph.cpp for how the
+    // batch is normalized). Every change is logged; the caller persists once.
+    MutationBatchStats applyBatch(span<const Mutation> ops);
+    // Gives every user still on a legacy 6-digit ID a 64-bit one and
+    // checkpoints; `migrated` is the number of users changed. False (and
+    // nothing changed) if the checkpoint could not be written.
+    bool migrateIds(size_t& migrated);
 
     bool addFriendship(const string& u1, const string& u2);
     bool removeFriendship(const string& u1, const string& u2);
 
     vector<string> getFriends(const string& username) const;
     vector<string> getMutualFriends(const string& u1, const string& u2) const;
-    bool areConnected(const string& u1, const string& u2) const;
+    bool areConnected(const string& u1, const string& u2);
+    // Shortest friendship chain u1 .. u2 (empty if none, or longer than
+    // maxDepth hops when maxDepth >= 0).
+    vector<string> shortestPath(const string& u1, const string& u2, int maxDepth = -1) const;
+    ComponentStats componentStats();
 
-    void computePageRank();
+    PageRankResult computePageRank(const PageRankOptions& opts = {});
+    PageRankResult refreshPageRank();   // bring pageRank up to date after mutations
     void displayPageRank() const;
 
-    vector<pair<string, double>> recommendFriends(const string& user, int topK = 3) const;
+    vector<pair<string, double>> recommendFriends(const string& user, int topK = 3,
+                                                  ScoreFunction fn = ScoreFunction::PageRankMutual,
+                                                  WalkOptions walk = {});
+    // Users whose friend lists are most like `user`'s (Jaccard similarity,
+    // found through the MinHash/LSH index), friends included.
+    vector<pair<string, double>> similarUsers(const string& user, int topK = 5);
+    // Precomputes perVertex walk segments from every user for personalized
+    // PageRank (0 turns them off). Once the graph compacts they are rebuilt
+    // on a background thread; queries keep the old set, which the walker
+    // no longer takes steps from, until the new one is swapped in.
+    void enableWalkSegments(uint32_t perVertex);
+
+    // Cache lookup only (refreshing PageRank first if fn needs it); false on a miss.
+    bool cachedRecommendations(const string& user, size_t topK, ScoreFunction fn,
+                               vector<pair<string, double>>& out);
+    // Caches a list computed on `snap`, unless the graph has moved on since.
+    void storeRecommendations(const GraphSnapshot& snap, const string& user, size_t topK,
+                              ScoreFunction fn, const vector<Recommendation>& recs);
+    CacheStats recommendationCacheStats() const { return recCache.stats(); }
+
+    // Writes top-K recommendations for every user to `out` (see BatchRecommend.hpp).
+    BatchResult recommendAll(size_t topK, ScoreFunction fn, size_t threads, ostream& out,
+                             WalkOptions walk = {});
+
+    vector<string> getUsers() const;
+    size_t userCount() const { return core.vertexCount(); }
 
     void displayAllUsers() const;
     void clear();
-    void save();
+
+    // Makes logged mutations durable (one fsync for everything since the last
+    // call) and checkpoints once the log has grown past CHECKPOINT_LOG_BYTES.
+    // False if the log could not be written: changes since the last
+    // successful save may be lost on restart.
+    bool save();
+    // Writes users.csv + users.snap as of now and truncates the log. False if
+    // the log could not be moved aside or (in the foreground) neither file
+    // was written; a background checkpoint only reports the former.
+    bool checkpoint(bool background = false);
+    void enableBackgroundCheckpoints() { backgroundCheckpoints = true; }
+    // Blocks until a background checkpoint is done. Anything else that
+    // writes users.snap or users.csv must call this first: both writers go
+    // through the same AtomicFile temp path.
+    void waitForCheckpoint();
+    bool exportSnapshot(const string& path = "");
+    // Splits the graph into shard files for --cluster (see
+    // cluster/Partition.hpp); `dir` defaults to shards/ next to the snapshot.
+    bool partition(uint32_t shards, PartitionScheme scheme, const string& dir, PartitionStats& stats);
+    string defaultPartitionDir() const;
+
+    // Read-only version of the current state for lock-free readers. Only the
+    // thread that mutates the graph may call publish(); any thread may call
+    // currentSnapshot(). withRank / withWalks bring PageRank / the walk
+    // segments up to date first.
+    shared_ptr<const GraphSnapshot> publish(bool withRank = false, bool withWalks = false);
+    shared_ptr<const GraphSnapshot> currentSnapshot() const { return published.load(memory_order_acquire); }
 
     void buildTrie();    // builds from all usernames
-    vector<string> searchPrefix(const string& prefix);
+    vector<string> searchPrefix(const string& prefix) const;  // best-connected matches first
 };
 
+// Output of --recommend, shared by the live graph and snapshot readers.
+void printRecommendations(ostream& out, const string& user, bool found,
+                          const vector<pair<string, double>>& recs);
+
 #endif
@@ -0,0 +1,46 @@
+#include "GraphReader.hpp"
+#include "Intersect.hpp"
+
+using namespace std;
+
+vector<string> friendNames(const CsrGraph& graph, const string& user) {
+    vector<string> result;
+    VertexId v = graph.find(user);
+    if (v == INVALID_VERTEX) return result;
+    for (VertexId f : graph.neighbors(v))
+        result.emplace_back(graph.name(f));
+    return result;
+}
+
+vector<string> mutualFriendNames(const CsrGraph& graph, const string& u1, const string& u2) {
+    vector<string> mutual;
+    VertexId a = graph.find(u1), b = graph.find(u2);
+    if (a == INVALID_VERTEX || b == INVALID_VERTEX) return mutual;
+
+    vector<VertexId> common;
+    intersectSorted(graph.neighbors(a), graph.neighbors(b), common);
+    mutual.reserve(common.size());
+    for (VertexId v : common) mutual.emplace_back(graph.name(v));
+    return mutual;
+}
+
+vector<string> GraphReader::shortestPath(const GraphSnapshot& snap, const string& u1, const string& u2,
+                                         int maxDepth) {
+    vector<string> chain;
+    VertexId src = snap.graph.find(u1), dst = snap.graph.find(u2);
+    if (src == INVALID_VERTEX || dst == INVALID_VERTEX) return chain;
+    for (VertexId v : pathFinder.find(snap.graph, src, dst, maxDepth).path)
+        chain.emplace_back(snap.graph.name(v));
+    return chain;
+}
+
+bool GraphReader::recommend(const GraphSnapshot& snap, const string& user, size_t topK, ScoreFunction fn,
+                            vector<Recommendation>& out, WalkOptions walk) {
+    VertexId u = snap.graph.find(user);
+    if (u == INVALID_VERTEX) return false;
+    span<const double> rank;
+    if (snap.pageRank) rank = *snap.pageRank;
+    walk.segments = snap.walkSegments.get();
+    out = recommender.recommend(snap.graph, u, topK, fn, rank, walk);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef GRAPH_READER_HPP
+#define GRAPH_READER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "PathFinder.hpp"
+#include "Recommender.hpp"
+
+using namespace std;
+
+// Immutable version of the graph. Graph publishes one after mutations and
+// any number of threads may query it without locks; it stays valid (sharing
+// the CSR arrays and untouched delta rows with the live graph) for as long
+// as someone holds it.
+struct GraphSnapshot {
+    CsrGraph graph;
+    shared_ptr<const vector<double>> pageRank;   // null if never computed
+    shared_ptr<const WalkSegments> walkSegments; // null unless enabled (see Graph)
+    uint64_t version = 0;                        // Graph mutation counter
+    uint64_t rankVersion = 0;
+};
+
+// Queries shared by the live Graph and by snapshot readers.
+vector<string> friendNames(const CsrGraph& graph, const string& user);
+vector<string> mutualFriendNames(const CsrGraph& graph, const string& u1, const string& u2);
+
+// Read-only queries over snapshots with reusable scratch buffers. Snapshots
+// may be shared between threads; a GraphReader may not.
+class GraphReader {
+private:
+    Recommender recommender;
+    PathFinder pathFinder;
+
+public:
+    vector<string> shortestPath(const GraphSnapshot& snap, const string& u1, const string& u2,
+                                int maxDepth = -1);
+    // False if the user doesn't exist in this snapshot.
+    bool recommend(const GraphSnapshot& snap, const string& user, size_t topK, ScoreFunction fn,
+                   vector<Recommendation>& out, WalkOptions walk = {});
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "Intersect.hpp"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INTERSECT_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// =================== SCALAR ===================
+
+template <bool Count>
+static size_t mergeScalar(const VertexId* a, size_t na, const VertexId* b, size_t nb, VertexId* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        VertexId x = a[i], y = b[j];
+        if (x == y) {
+            if constexpr (!Count) out[k] = x;
+            ++k; ++i; ++j;
+        } else if (x < y) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    return k;
+}
+
+// Looks up each element of the short list in the long one, galloping from
+// the previous hit: O(ns * log(nl / ns)) instead of O(ns + nl).
+template <bool Count>
+static size_t gallop(const VertexId* s, size_t ns, const VertexId* l, size_t nl, VertexId* out) {
+    size_t lo = 0, k = 0;
+    for (size_t i = 0; i < ns && lo < nl; ++i) {
+        VertexId x = s[i];
+        size_t hi = lo, step = 1;
+        while (hi < nl && l[hi] < x) {
+            lo = hi + 1;
+            hi += step;
+            step <<= 1;
+        }
+        lo = lower_bound(l + lo, l + min(hi + 1, nl), x) - l;
+        if (lo < nl && l[lo] == x) {
+            if constexpr (!Count) out[k] = x;
+            ++k;
+            ++lo;
+        }
+    }
+    return k;
+}
+
+// =================== SIMD ===================
+
+#ifdef INTERSECT_X86
+
+// For each match mask, the shuffle that packs the matching lanes to the front.
+struct ShuffleTables {
+    alignas(16) uint8_t sse[16][16];     // pshufb byte indices, 4 lanes
+    alignas(32) uint32_t avx[256][8];    // vpermd lane indices, 8 lanes
+};
+
+static constexpr ShuffleTables makeShuffleTables() {
+    ShuffleTables t{};
+    for (int mask = 0; mask < 16; ++mask) {
+        int n = 0;
+        for (int lane = 0; lane < 4; ++lane) {
+            if (!(mask & (1 << lane))) continue;
+            for (int byte = 0; byte < 4; ++byte) t.sse[mask][n * 4 + byte] = lane * 4 + byte;
+            ++n;
+        }
+        for (int pos = n * 4; pos < 16; ++pos) t.sse[mask][pos] = 0x80;
+    }
+    for (int mask = 0; mask < 256; ++mask) {
+        int n = 0;
+        for (int lane = 0; lane < 8; ++lane)
+            if (mask & (1 << lane)) t.avx[mask][n++] = lane;
+    }
+    return t;
+}
+
+static constexpr ShuffleTables SHUFFLES = makeShuffleTables();
+
+// Block-wise merge: compare 4 elements of `a` against all 4 rotations of a
+// block of `b`, pack the hits, then advance whichever block ends lower (both
+// on a tie). Elements are unique, so no match is reported twice.
+template <bool Count>
+__attribute__((target("sse4.2")))
+static size_t intersectSse(const VertexId* a, size_t na, const VertexId* b, size_t nb, VertexId* out) {
+    size_t i = 0, j = 0, k = 0;
+    size_t na4 = na & ~size_t(3), nb4 = nb & ~size_t(3);
+    while (i < na4 && j < nb4) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i eq = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if constexpr (!Count) {
+            __m128i pack = _mm_load_si128((const __m128i*)SHUFFLES.sse[mask]);
+            _mm_storeu_si128((__m128i*)(out + k), _mm_shuffle_epi8(va, pack));
+        }
+        k += __builtin_popcount(mask);
+
+        VertexId amax = a[i + 3], bmax = b[j + 3];
+        if (amax <= bmax) i += 4;
+        if (bmax <= amax) j += 4;
+    }
+    return k + mergeScalar<Count>(a + i, na - i, b + j, nb - j, out + k);
+}
+
+// Same with 8x8 blocks: the 8 rotations are the 4 in-lane rotations of the
+// block and of its 128-bit halves swapped.
+template <bool Count>
+__attribute__((target("avx2")))
+static size_t intersectAvx2(const VertexId* a, size_t na, const VertexId* b, size_t nb, VertexId* out) {
+    size_t i = 0, j = 0, k = 0;
+    size_t na8 = na & ~size_t(7), nb8 = nb & ~size_t(7);
+    while (i < na8 && j < nb8) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        __m256i vs = _mm256_permute2x128_si256(vb, vb, 1);
+        __m256i eq = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, vb),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))))),
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, vs),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(1, 0, 3, 2))),
+                                _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(2, 1, 0, 3))))));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if constexpr (!Count) {
+            __m256i pack = _mm256_load_si256((const __m256i*)SHUFFLES.avx[mask]);
+            _mm256_storeu_si256((__m256i*)(out + k), _mm256_permutevar8x32_epi32(va, pack));
+        }
+        k += __builtin_popcount(mask);
+
+        VertexId amax = a[i + 7], bmax = b[j + 7];
+        if (amax <= bmax) i += 8;
+        if (bmax <= amax) j += 8;
+    }
+    return k + mergeScalar<Count>(a + i, na - i, b + j, nb - j, out + k);
+}
+
+#endif
+
+// =================== DISPATCH ===================
+
+// The SIMD kernels store whole blocks, so the output needs this much room
+// past the last match.
+constexpr size_t OUTPUT_SLACK = 8;
+
+static IntersectKernel detectKernel() {
+#ifdef INTERSECT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return IntersectKernel::Avx2;
+    if (__builtin_cpu_supports("sse4.2")) return IntersectKernel::Sse42;
+#endif
+    return IntersectKernel::Scalar;
+}
+
+static const IntersectKernel BEST_KERNEL = detectKernel();
+
+// Crossover points measured with bench/IntersectBench.cpp: the wider the
+// merge, the more skew it takes before galloping's cache misses pay off.
+static size_t gallopRatioFor(IntersectKernel kernel) {
+    switch (kernel) {
+        case IntersectKernel::Avx2: return 128;
+        case IntersectKernel::Sse42: return 64;
+        default: return 16;
+    }
+}
+
+static const size_t GALLOP_RATIO = gallopRatioFor(BEST_KERNEL);
+
+template <bool Count>
+static size_t run(IntersectKernel kernel, span<const VertexId> a, span<const VertexId> b, VertexId* out) {
+    if (a.empty() || b.empty()) return 0;
+    switch (kernel) {
+        case IntersectKernel::Galloping:
+            return a.size() <= b.size() ? gallop<Count>(a.data(), a.size(), b.data(), b.size(), out)
+                                        : gallop<Count>(b.data(), b.size(), a.data(), a.size(), out);
+#ifdef INTERSECT_X86
+        case IntersectKernel::Sse42:
+            return intersectSse<Count>(a.data(), a.size(), b.data(), b.size(), out);
+        case IntersectKernel::Avx2:
+            return intersectAvx2<Count>(a.data(), a.size(), b.data(), b.size(), out);
+#endif
+        default:
+            return mergeScalar<Count>(a.data(), a.size(), b.data(), b.size(), out);
+    }
+}
+
+static IntersectKernel chooseKernel(size_t na, size_t nb) {
+    size_t shorter = min(na, nb), longer = max(na, nb);
+    return shorter * GALLOP_RATIO < longer ? IntersectKernel::Galloping : BEST_KERNEL;
+}
+
+size_t intersectSortedWith(IntersectKernel kernel, span<const VertexId> a, span<const VertexId> b,
+                           vector<VertexId>& out) {
+    out.resize(min(a.size(), b.size()) + OUTPUT_SLACK);
+    out.resize(run<false>(kernel, a, b, out.data()));
+    return out.size();
+}
+
+size_t intersectCountWith(IntersectKernel kernel, span<const VertexId> a, span<const VertexId> b) {
+    return run<true>(kernel, a, b, nullptr);
+}
+
+size_t intersectSorted(span<const VertexId> a, span<const VertexId> b, vector<VertexId>& out) {
+    return intersectSortedWith(chooseKernel(a.size(), b.size()), a, b, out);
+}
+
+size_t intersectCount(span<const VertexId> a, span<const VertexId> b) {
+    return intersectCountWith(chooseKernel(a.size(), b.size()), a, b);
+}
+
+bool intersectKernelSupported(IntersectKernel kernel) {
+    switch (kernel) {
+        case IntersectKernel::Avx2: return BEST_KERNEL == IntersectKernel::Avx2;
+        case IntersectKernel::Sse42: return BEST_KERNEL != IntersectKernel::Scalar;
+        default: return true;
+    }
+}
+
+IntersectKernel bestIntersectKernel() { return BEST_KERNEL; }
+
+size_t intersectGallopRatio() { return GALLOP_RATIO; }
+
+const char* intersectKernelName(IntersectKernel kernel) {
+    switch (kernel) {
+        case IntersectKernel::Scalar: return "scalar";
+        case IntersectKernel::Galloping: return "galloping";
+        case IntersectKernel::Sse42: return "sse4.2";
+        case IntersectKernel::Avx2: return "avx2";
+    }
+    return "?";
+}
@@ -0,0 +1,40 @@
+#ifndef INTERSECT_HPP
+#define INTERSECT_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "CsrGraph.hpp"
+
+using namespace std;
+
+// Intersection of sorted, duplicate-free vertex lists (CSR neighbor rows).
+//
+// Lists of similar length go through a block-wise merge that compares a
+// whole block of one list against a block of the other in SIMD registers
+// (4x4 with SSE4.2, 8x8 with AVX2) and compacts the matches with a shuffle
+// table; the widest kernel the CPU supports is picked at startup, with a
+// scalar merge as the fallback. When one list is much longer than the other
+// (see intersectGallopRatio()), each element of the short list is located in
+// the long one by galloping (exponential then binary) search instead.
+enum class IntersectKernel { Scalar, Galloping, Sse42, Avx2 };
+
+// Writes the elements common to a and b to `out` (replacing its contents),
+// sorted, and returns how many there are.
+size_t intersectSorted(span<const VertexId> a, span<const VertexId> b, vector<VertexId>& out);
+// Same, counting matches without writing them anywhere.
+size_t intersectCount(span<const VertexId> a, span<const VertexId> b);
+
+// Runs one particular kernel regardless of list lengths (benchmarks, checks).
+// The kernel must be supported.
+size_t intersectSortedWith(IntersectKernel kernel, span<const VertexId> a, span<const VertexId> b,
+                           vector<VertexId>& out);
+size_t intersectCountWith(IntersectKernel kernel, span<const VertexId> a, span<const VertexId> b);
+
+bool intersectKernelSupported(IntersectKernel kernel);
+IntersectKernel bestIntersectKernel();   // what the dispatcher uses for balanced lists
+// Length ratio above which galloping beats the best merge kernel.
+size_t intersectGallopRatio();
+const char* intersectKernelName(IntersectKernel kernel);
+
+#endif
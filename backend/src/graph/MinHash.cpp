@@ -0,0 +1,299 @@
+#include "MinHash.hpp"
+#include "Intersect.hpp"
+#include "Recommender.hpp"
+#include "../utils/Metrics.hpp"
+#include <algorithm>
+#include <bit>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MINHASH_X86 1
+#endif
+
+using namespace std;
+
+namespace {
+constexpr uint32_t EMPTY = UINT32_MAX;   // every lane of an empty row's signature
+
+// Multipliers (odd) and offsets of the hash functions. The seed is fixed
+// but arbitrary: signatures live only as long as the process.
+struct HashFamily {
+    alignas(32) uint32_t mul[MINHASH_SIZE];
+    alignas(32) uint32_t add[MINHASH_SIZE];
+
+    HashFamily() {
+        uint64_t s = 0x243F6A8885A308D3ull;
+        for (size_t k = 0; k < MINHASH_SIZE; ++k) {
+            uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            mul[k] = (uint32_t)z | 1;
+            add[k] = (uint32_t)(z >> 32);
+        }
+    }
+};
+const HashFamily FAMILY;
+
+// Murmur3 finalizer; spreads the dense vertex IDs before the affine maps.
+inline uint32_t mixVertex(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+// Lowers `sig` to the minimum over `row` of every hash function. The inner
+// loop is fixed-length over independent 32-bit lanes, so the compiler turns
+// it into vector multiplies and mins; it is compiled once per target below.
+[[gnu::always_inline]] inline void foldRow(span<const VertexId> row, uint32_t* sig) {
+    uint32_t acc[MINHASH_SIZE];
+    copy(sig, sig + MINHASH_SIZE, acc);
+    for (VertexId x : row) {
+        uint32_t fx = mixVertex(x);
+        for (size_t k = 0; k < MINHASH_SIZE; ++k) {
+            uint32_t h = fx * FAMILY.mul[k] + FAMILY.add[k];
+            h ^= h >> 15;
+            h *= 0x2C1B3C6Du;
+            h ^= h >> 12;
+            acc[k] = min(acc[k], h);
+        }
+    }
+    copy(acc, acc + MINHASH_SIZE, sig);
+}
+
+void foldScalar(span<const VertexId> row, uint32_t* sig) { foldRow(row, sig); }
+
+#ifdef MINHASH_X86
+__attribute__((target("avx2")))
+void foldAvx2(span<const VertexId> row, uint32_t* sig) { foldRow(row, sig); }
+#endif
+
+using FoldFn = void (*)(span<const VertexId>, uint32_t*);
+
+FoldFn pickFold() {
+#ifdef MINHASH_X86
+    if (__builtin_cpu_supports("avx2")) return foldAvx2;
+#endif
+    return foldScalar;
+}
+const FoldFn fold = pickFold();
+
+// Bucket of `sig` within one band's table: the band's values folded to 32
+// bits (with one value per band, that value itself).
+uint32_t bandKey(const uint32_t* sig, size_t band) {
+    uint32_t h = sig[band * LSH_ROWS];
+    for (size_t r = 1; r < LSH_ROWS; ++r) h = mixVertex(h) ^ sig[band * LSH_ROWS + r];
+    return h;
+}
+
+// All bands share the moved-user map.
+uint64_t movedKey(size_t band, uint32_t key) { return (uint64_t)band << 32 | key; }
+}
+
+// =================== BUILD ===================
+
+void MinHashIndex::build(const CsrGraph& graph, ThreadPool& pool) {
+    size_t n = graph.vertexSlots();
+    signatures.assign(n * MINHASH_SIZE, EMPTY);
+    pool.parallelFor(n, 1024, [&](size_t, size_t b, size_t e) {
+        for (VertexId v = b; v < e; ++v)
+            if (graph.isAlive(v)) fold(graph.neighbors(v), sig(v));
+    });
+    built = true;
+    sortBands(pool);
+}
+
+// One band per task. Keys are hash values, so a counting pass over their
+// top bits leaves only a few entries per bucket to sort (several times
+// faster than sorting the whole band; a popular user's friends can still
+// share a key, which the per-bucket sort takes in its stride).
+void MinHashIndex::sortBands(ThreadPool& pool) {
+    size_t n = signatures.size() / MINHASH_SIZE;
+    int shift = 32 - (int)clamp<size_t>(bit_width(n), 1, 16);   // about one bucket per user
+    bands.assign(LSH_BANDS, {});
+    pool.parallelFor(LSH_BANDS, 1, [&](size_t, size_t b, size_t e) {
+        vector<uint32_t> offsets(((size_t)1 << (32 - shift)) + 1);
+        vector<uint64_t> entries;   // key << 32 | vertex
+        for (size_t band = b; band < e; ++band) {
+            fill(offsets.begin(), offsets.end(), 0);
+            size_t count = 0;
+            for (VertexId v = 0; v < n; ++v)
+                if (indexed(v)) {
+                    offsets[(bandKey(sig(v), band) >> shift) + 1]++;
+                    count++;
+                }
+            for (size_t i = 1; i < offsets.size(); ++i) offsets[i] += offsets[i - 1];
+
+            entries.resize(count);
+            for (VertexId v = 0; v < n; ++v) {
+                if (!indexed(v)) continue;
+                uint32_t key = bandKey(sig(v), band);
+                entries[offsets[key >> shift]++] = (uint64_t)key << 32 | v;
+            }
+            // Each offset now marks the end of its bucket.
+            for (size_t i = 0, begin = 0; i + 1 < offsets.size(); begin = offsets[i++])
+                if (offsets[i] - begin > 1) sort(entries.begin() + begin, entries.begin() + offsets[i]);
+
+            Band& out = bands[band];
+            out.keys.resize(count);
+            out.members.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                out.keys[i] = entries[i] >> 32;
+                out.members[i] = (VertexId)entries[i];
+            }
+        }
+    });
+    moved.assign(n, 0);
+    movedCount = 0;
+    movedBuckets.clear();
+}
+
+void MinHashIndex::reset() {
+    signatures.clear();
+    bands.clear();
+    moved.clear();
+    movedCount = 0;
+    movedBuckets.clear();
+    built = false;
+}
+
+bool MinHashIndex::needsSort() const {
+    return movedCount > 4096 && movedCount > moved.size() / 8;
+}
+
+size_t MinHashIndex::bytes() const {
+    size_t total = signatures.size() * sizeof(uint32_t) + moved.size();
+    for (const Band& band : bands)
+        total += band.keys.size() * (sizeof(uint32_t) + sizeof(VertexId));
+    for (auto& [key, users] : movedBuckets)
+        total += sizeof(key) + users.size() * sizeof(VertexId);
+    return total;
+}
+
+// =================== UPDATES ===================
+
+bool MinHashIndex::indexed(VertexId v) const {
+    return (size_t)v * MINHASH_SIZE < signatures.size() && signatures[(size_t)v * MINHASH_SIZE] != EMPTY;
+}
+
+// Slots added since build() have no base entries; they start out moved.
+void MinHashIndex::grow(VertexId v) {
+    size_t n = moved.size();
+    if (v < n) return;
+    signatures.resize(((size_t)v + 1) * MINHASH_SIZE, EMPTY);
+    moved.resize((size_t)v + 1, 1);
+    movedCount += v + 1 - n;
+}
+
+void MinHashIndex::list(VertexId v) {
+    if (!indexed(v)) return;
+    for (size_t band = 0; band < LSH_BANDS; ++band)
+        movedBuckets[movedKey(band, bandKey(sig(v), band))].push_back(v);
+}
+
+void MinHashIndex::unlist(VertexId v) {
+    if (!indexed(v)) return;
+    for (size_t band = 0; band < LSH_BANDS; ++band) {
+        auto it = movedBuckets.find(movedKey(band, bandKey(sig(v), band)));
+        if (it == movedBuckets.end()) continue;
+        auto& users = it->second;
+        auto pos = find(users.begin(), users.end(), v);
+        if (pos != users.end()) {
+            *pos = users.back();
+            users.pop_back();
+        }
+        if (users.empty()) movedBuckets.erase(it);
+    }
+}
+
+// Call before v's signature changes: takes v out of wherever it is listed.
+void MinHashIndex::markMoved(VertexId v) {
+    grow(v);
+    if (moved[v]) {
+        unlist(v);
+    } else {
+        moved[v] = 1;
+        movedCount++;
+    }
+}
+
+void MinHashIndex::addEdge(VertexId a, VertexId b) {
+    if (!built) return;
+    for (auto [v, other] : {pair{a, b}, pair{b, a}}) {
+        grow(v);
+        uint32_t lowered[MINHASH_SIZE];
+        copy(sig(v), sig(v) + MINHASH_SIZE, lowered);
+        fold({&other, 1}, lowered);
+        if (equal(lowered, lowered + MINHASH_SIZE, sig(v))) continue;   // no new minimum
+        markMoved(v);
+        copy(lowered, lowered + MINHASH_SIZE, sig(v));
+        list(v);
+    }
+}
+
+void MinHashIndex::removeEdge(const CsrGraph& graph, VertexId a, VertexId b) {
+    if (!built) return;
+    for (auto [v, other] : {pair{a, b}, pair{b, a}}) {
+        if (!indexed(v)) continue;
+        uint32_t single[MINHASH_SIZE];
+        fill(single, single + MINHASH_SIZE, EMPTY);
+        fold({&other, 1}, single);
+        const uint32_t* current = sig(v);
+        bool heldMinimum = false;
+        for (size_t k = 0; k < MINHASH_SIZE; ++k) heldMinimum |= single[k] == current[k];
+        if (heldMinimum) refresh(graph, v);
+    }
+}
+
+void MinHashIndex::refresh(const CsrGraph& graph, VertexId v) {
+    if (!built) return;
+    markMoved(v);
+    fill(sig(v), sig(v) + MINHASH_SIZE, EMPTY);
+    if (graph.isAlive(v)) fold(graph.neighbors(v), sig(v));
+    list(v);
+}
+
+// =================== QUERIES ===================
+
+vector<Recommendation> LshProbe::similar(const MinHashIndex& index, const CsrGraph& graph, VertexId user,
+                                         size_t topK, bool skipFriends) {
+    METRIC_TIMER(SimilarSeconds);
+    vector<Recommendation> out;
+    if (!index.indexed(user)) return out;
+    size_t n = index.moved.size();
+    if (hits.size() < n) hits.resize(n, 0);
+
+    auto hit = [&](VertexId c) {
+        if (c == user || hits[c]++) return;
+        if (touched.size() < LSH_MAX_CANDIDATES) touched.push_back(c);
+        else hits[c] = 0;
+    };
+    const uint32_t* query = index.signatures.data() + (size_t)user * MINHASH_SIZE;
+    for (size_t band = 0; band < index.bands.size(); ++band) {
+        uint32_t key = bandKey(query, band);
+        const auto& b = index.bands[band];
+        auto [lo, hi] = equal_range(b.keys.begin(), b.keys.end(), key);
+        for (size_t i = lo - b.keys.begin(); i < (size_t)(hi - b.keys.begin()); ++i)
+            if (!index.moved[b.members[i]]) hit(b.members[i]);
+        auto it = index.movedBuckets.find(movedKey(band, key));
+        if (it != index.movedBuckets.end())
+            for (VertexId c : it->second) hit(c);
+    }
+    METRIC_OBSERVE(SimilarCandidates, touched.size());
+
+    // Candidates are only as good as their signatures; rank by the real thing.
+    auto friends = graph.neighbors(user);
+    for (VertexId c : touched) {
+        hits[c] = 0;
+        if (skipFriends && binary_search(friends.begin(), friends.end(), c)) continue;
+        auto row = graph.neighbors(c);
+        size_t common = intersectCount(friends, row);
+        if (common) out.push_back({c, (double)common / (friends.size() + row.size() - common)});
+    }
+    touched.clear();
+
+    keepTopK(out, topK);
+    return out;
+}
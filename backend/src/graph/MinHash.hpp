@@ -0,0 +1,102 @@
+#ifndef MIN_HASH_HPP
+#define MIN_HASH_HPP
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "../utils/ThreadPool.hpp"
+
+using namespace std;
+
+struct Recommendation;   // Recommender.hpp
+
+// Hashes per signature, and signature values per LSH band. With 16 bands
+// of one value, two users whose friend lists have Jaccard similarity J
+// share at least one band with probability 1 - (1 - J)^16: ~81% at 0.1,
+// ~97% at 0.2, >99% from 0.3. Longer bands would cut the candidates from
+// loosely similar users, but lose more of the similar ones than they save.
+constexpr size_t MINHASH_SIZE = 16;
+constexpr size_t LSH_ROWS = 1;
+constexpr size_t LSH_BANDS = MINHASH_SIZE / LSH_ROWS;
+// Colliding users scored per query at most, so a huge bucket (say, many
+// users whose only friend is the same celebrity) can't blow up a query.
+constexpr size_t LSH_MAX_CANDIDATES = 4096;
+
+// MinHash signatures of every user's friend list, bucketed into LSH bands,
+// for "who has a friend circle like this one" without comparing against
+// every user.
+//
+// A signature is the minimum of MINHASH_SIZE hash functions over the
+// neighbor row; each band hashes LSH_ROWS of those values into a bucket key.
+// The hash functions are affine maps of a mixed vertex ID computed in
+// 32-bit lanes, so folding a row into a signature vectorizes (AVX2 when the
+// CPU has it, picked at startup).
+//
+// Like CsrGraph, the buckets are a sorted base plus a small delta: build()
+// sorts (bucket, vertex) pairs per band, and a user whose friend list changes
+// afterwards is marked moved, its base entries are ignored, and its current
+// keys go into a hash map. Once a fraction of users have moved, the base is
+// re-sorted. Adding a friend only lowers the signature (O(MINHASH_SIZE));
+// removing one rescans the row, and only if the friend held a minimum.
+// Users with no friends are not indexed.
+class MinHashIndex {
+private:
+    struct Band {
+        vector<uint32_t> keys;     // sorted
+        vector<VertexId> members;  // parallel to keys
+    };
+
+    vector<uint32_t> signatures;   // MINHASH_SIZE per vertex slot
+    vector<Band> bands;            // LSH_BANDS once built
+    vector<uint8_t> moved;         // changed since the bands were sorted
+    size_t movedCount = 0;
+    unordered_map<uint64_t, vector<VertexId>> movedBuckets;   // band << 32 | key -> moved users
+    bool built = false;
+
+    uint32_t* sig(VertexId v) { return signatures.data() + (size_t)v * MINHASH_SIZE; }
+    void grow(VertexId v);
+    void unlist(VertexId v);
+    void list(VertexId v);
+    void markMoved(VertexId v);
+
+    friend class LshProbe;
+
+public:
+    bool isBuilt() const { return built; }
+    void build(const CsrGraph& graph, ThreadPool& pool);
+    void reset();                  // back to unbuilt
+    // True once enough users have moved that the base should be re-sorted;
+    // the owner does so with sortBands() before its next query.
+    bool needsSort() const;
+    void sortBands(ThreadPool& pool);
+
+    // Keep the index in step with the graph; no-ops until build(). Call
+    // after the edge (or, for refresh(), the whole row) has changed.
+    void addEdge(VertexId a, VertexId b);
+    void removeEdge(const CsrGraph& graph, VertexId a, VertexId b);
+    void refresh(const CsrGraph& graph, VertexId v);
+
+    bool indexed(VertexId v) const;
+    span<const uint32_t> signature(VertexId v) const {
+        return {signatures.data() + (size_t)v * MINHASH_SIZE, MINHASH_SIZE};
+    }
+    size_t bytes() const;
+};
+
+// Per-thread scratch for querying a MinHashIndex.
+class LshProbe {
+private:
+    vector<uint8_t> hits;          // bands shared with the query user
+    vector<VertexId> touched;
+
+public:
+    // Users sharing at least one band with `user`, ranked by the exact
+    // Jaccard similarity of the two friend lists (ties by vertex ID). With
+    // skipFriends, the user's current friends are left out (recommendations).
+    vector<Recommendation> similar(const MinHashIndex& index, const CsrGraph& graph, VertexId user,
+                                   size_t topK, bool skipFriends);
+};
+
+#endif
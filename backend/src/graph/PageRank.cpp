@@ -0,0 +1,164 @@
+#include "PageRank.hpp"
+#include "../utils/Metrics.hpp"
+#include <chrono>
+#include <cmath>
+#include <deque>
+
+using namespace std;
+
+namespace {
+// Per-worker partial sums, padded so neighbouring workers don't share a line.
+struct alignas(64) Partial {
+    double value = 0.0;
+};
+}
+
+PageRankResult computePageRank(const CsrGraph& graph, vector<double>& rank,
+                               const PageRankOptions& opts, ThreadPool& pool) {
+    auto start = chrono::steady_clock::now();
+    PageRankResult result;
+
+    size_t slots = graph.vertexSlots();
+    size_t N = graph.vertexCount();
+    if (N == 0) {
+        rank.assign(slots, 0.0);
+        return result;
+    }
+
+    size_t known = rank.size();
+    bool warm = known > 0;
+    rank.resize(slots, 0.0);
+    double sum = 0.0;
+    for (VertexId v = 0; v < slots; ++v) {
+        if (!graph.isAlive(v)) rank[v] = 0.0;
+        else if (!warm || v >= known) rank[v] = 1.0 / N;
+        sum += rank[v];
+    }
+    // A warm start from before users were added/removed no longer sums to 1.
+    if (warm && sum > 0)
+        for (double& r : rank) r /= sum;
+
+    const size_t grain = 4096;
+    const double d = opts.damping;
+    vector<double> contrib(slots), next(slots);
+    vector<Partial> dangling(pool.size()), delta(pool.size());
+
+    for (int it = 0; it < opts.maxIterations; ++it) {
+        METRIC_TIMER(PageRankIterationSeconds);
+        METRIC_ADD(PageRankIterations, 1);
+        // Scatter rank/degree once so the gather below is a pure read.
+        for (auto& p : dangling) p.value = 0.0;
+        pool.parallelFor(slots, grain, [&](size_t w, size_t b, size_t e) {
+            double local = 0.0;
+            for (VertexId u = b; u < e; ++u) {
+                size_t deg = graph.degree(u);
+                contrib[u] = deg ? rank[u] / deg : 0.0;
+                if (!deg) local += rank[u];
+            }
+            dangling[w].value += local;
+        }, opts.threads);
+
+        double danglingSum = 0.0;
+        for (auto& p : dangling) danglingSum += p.value;
+        double base = (1.0 - d) / N + d * danglingSum / N;
+
+        for (auto& p : delta) p.value = 0.0;
+        pool.parallelFor(slots, grain, [&](size_t w, size_t b, size_t e) {
+            double local = 0.0;
+            for (VertexId v = b; v < e; ++v) {
+                if (!graph.isAlive(v)) { next[v] = 0.0; continue; }
+                double acc = 0.0;
+                for (VertexId u : graph.neighbors(v)) acc += contrib[u];
+                next[v] = base + d * acc;
+                local += fabs(next[v] - rank[v]);
+            }
+            delta[w].value += local;
+        }, opts.threads);
+
+        rank.swap(next);
+        result.iterations = it + 1;
+        result.residual = 0.0;
+        for (auto& p : delta) result.residual += p.value;
+        if (result.residual < opts.tolerance) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    result.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// =================== INCREMENTAL ===================
+
+void accumulateEdgeResidual(const CsrGraph& graph, const vector<double>& rank,
+                            VertexId a, VertexId b, bool added, double damping,
+                            unordered_map<VertexId, double>& residual) {
+    for (auto [x, y] : {pair{a, b}, pair{b, a}}) {
+        if (x >= rank.size()) continue;
+        double newDeg = graph.degree(x);
+        double oldDeg = added ? newDeg - 1 : newDeg + 1;
+        if (newDeg == 0 || oldDeg == 0) continue;  // dangling change: caller recomputes
+
+        // Every remaining neighbor now receives x/newDeg instead of x/oldDeg.
+        double change = damping * rank[x] * (1.0 / newDeg - 1.0 / oldDeg);
+        for (VertexId w : graph.neighbors(x))
+            if (w != y) residual[w] += change;
+        // ...and y gains or loses its share entirely.
+        residual[y] += added ? damping * rank[x] / newDeg : -damping * rank[x] / oldDeg;
+    }
+}
+
+PageRankResult pushResidual(const CsrGraph& graph, vector<double>& rank,
+                            unordered_map<VertexId, double>& residual,
+                            const PageRankOptions& opts) {
+    METRIC_TIMER(PageRankPushSeconds);
+    auto start = chrono::steady_clock::now();
+    PageRankResult result;
+    size_t N = graph.vertexCount();
+    if (N == 0 || rank.size() != graph.vertexSlots()) return result;
+
+    // Per-vertex threshold keeps the total pending residual under pushTolerance.
+    double eps = opts.pushTolerance / N;
+    size_t budget = (graph.vertexSlots() + 2 * graph.edgeCount()) / 2;
+    size_t work = 0;
+
+    deque<VertexId> queue;
+    for (auto& [v, r] : residual)
+        if (fabs(r) > eps) queue.push_back(v);
+
+    while (!queue.empty()) {
+        VertexId v = queue.front();
+        queue.pop_front();
+        auto it = residual.find(v);
+        if (it == residual.end() || fabs(it->second) <= eps) continue;
+
+        double r = it->second;
+        it->second = 0.0;
+        rank[v] += r;
+        result.iterations++;
+
+        auto nbrs = graph.neighbors(v);
+        if (nbrs.empty()) continue;
+        work += nbrs.size() + 1;
+        if (work > budget) {
+            METRIC_ADD(PageRankPushes, result.iterations);
+            residual.clear();
+            return result;
+        }
+        double share = opts.damping * r / nbrs.size();
+        for (VertexId w : nbrs) {
+            double& rw = residual[w];
+            bool wasSmall = fabs(rw) <= eps;
+            rw += share;
+            if (wasSmall && fabs(rw) > eps) queue.push_back(w);
+        }
+    }
+
+    erase_if(residual, [](const auto& entry) { return entry.second == 0.0; });
+    for (auto& [v, r] : residual) result.residual += fabs(r);
+    result.converged = true;
+    METRIC_ADD(PageRankPushes, result.iterations);
+    result.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
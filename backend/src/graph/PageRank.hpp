@@ -0,0 +1,63 @@
+#ifndef PAGE_RANK_HPP
+#define PAGE_RANK_HPP
+
+#include <unordered_map>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "../utils/ThreadPool.hpp"
+
+using namespace std;
+
+struct PageRankOptions {
+    double damping = 0.85;
+    int maxIterations = 100;
+    double tolerance = 1e-6;     // stop once the L1 change between sweeps drops below this
+    double pushTolerance = 1e-4; // L1 bound on residual left pending by incremental refreshes
+    size_t threads = 0;          // 0 = every worker in the pool
+};
+
+struct PageRankResult {
+    int iterations = 0;
+    double residual = 0.0;       // L1 change of the last sweep
+    double millis = 0.0;
+    bool converged = false;
+};
+
+// Pull-based power iteration over the CSR arrays. Each vertex gathers
+// rank/degree from its neighbors, so vertex ranges can be split across
+// threads with no shared writes. Rank held by dangling (degree-0) vertices is
+// spread uniformly, keeping the vector a probability distribution.
+//
+// A non-empty `rank` is used as the starting point (warm start): slots added
+// since it was computed start at 1/N and the vector is renormalised. An empty
+// `rank` starts uniform. Removed vertex slots always end at 0.
+PageRankResult computePageRank(const CsrGraph& graph, vector<double>& rank,
+                               const PageRankOptions& opts, ThreadPool& pool);
+
+// ---- Incremental maintenance ----
+//
+// While `rank` is converged, the residual b + d*P*x - x is ~0 everywhere. An
+// edge change only alters the rows of its two endpoints, so the residual it
+// introduces is confined to those endpoints' neighbourhoods and can be
+// computed exactly from the old and new degrees. Accumulating it per mutation
+// and pushing it out Gauss-Southwell style (forward push) brings `rank` back
+// to the fixed point while touching only the affected region.
+//
+// This holds as long as the vertex count and the set of dangling vertices are
+// unchanged; callers must fall back to a warm-started computePageRank otherwise.
+
+// Call after the edge (a, b) was added or removed in `graph`.
+void accumulateEdgeResidual(const CsrGraph& graph, const vector<double>& rank,
+                            VertexId a, VertexId b, bool added, double damping,
+                            unordered_map<VertexId, double>& residual);
+
+// Pushes the accumulated residual into `rank` until no vertex holds more than
+// its share of opts.pushTolerance. Sub-threshold leftovers stay in `residual`
+// for the next refresh, so error never accumulates beyond that bound. Returns
+// a result with converged=false if the work exceeded half a full sweep, in
+// which case the caller should run a warm full iteration instead.
+PageRankResult pushResidual(const CsrGraph& graph, vector<double>& rank,
+                            unordered_map<VertexId, double>& residual,
+                            const PageRankOptions& opts);
+
+#endif
@@ -0,0 +1,93 @@
+#include "PathFinder.hpp"
+#include <algorithm>
+
+using namespace std;
+
+void PathFinder::reset(size_t n) {
+    if (++epoch == 0) {  // wrapped: stale stamps could look current
+        for (auto& side : sides) fill(side.seen.begin(), side.seen.end(), 0);
+        epoch = 1;
+    }
+    for (auto& side : sides) {
+        if (side.seen.size() < n) {
+            side.seen.resize(n, 0);
+            side.parent.resize(n);
+            side.depth.resize(n);
+        }
+        side.frontier.clear();
+        side.level = 0;
+    }
+}
+
+// Grows side s by one full level. Any vertex the other side has already
+// reached completes a path; the whole level is scanned so the shortest such
+// path wins, since the other side's marks span two depths.
+bool PathFinder::expand(const CsrGraph& graph, int s, VertexId& bestMeet, uint32_t& bestLength,
+                        size_t& explored) {
+    Side& me = sides[s];
+    Side& other = sides[1 - s];
+    me.next.clear();
+    bool met = false;
+
+    for (VertexId u : me.frontier) {
+        for (VertexId v : graph.neighbors(u)) {
+            if (me.seen[v] == epoch) continue;
+            me.seen[v] = epoch;
+            me.parent[v] = u;
+            me.depth[v] = me.level + 1;
+            me.next.push_back(v);
+            explored++;
+            if (other.seen[v] == epoch) {
+                uint32_t length = me.level + 1 + other.depth[v];
+                if (length < bestLength) {
+                    bestLength = length;
+                    bestMeet = v;
+                }
+                met = true;
+            }
+        }
+    }
+    me.frontier.swap(me.next);
+    me.level++;
+    return met;
+}
+
+PathResult PathFinder::find(const CsrGraph& graph, VertexId source, VertexId target, int maxDepth) {
+    PathResult result;
+    if (!graph.isAlive(source) || !graph.isAlive(target)) return result;
+    if (source == target) {
+        result.found = true;
+        result.path = {source};
+        result.explored = 1;
+        return result;
+    }
+
+    reset(graph.vertexSlots());
+    VertexId ends[2] = {source, target};
+    for (int s = 0; s < 2; ++s) {
+        sides[s].seen[ends[s]] = epoch;
+        sides[s].parent[ends[s]] = INVALID_VERTEX;
+        sides[s].depth[ends[s]] = 0;
+        sides[s].frontier.push_back(ends[s]);
+    }
+    result.explored = 2;
+
+    VertexId meet = INVALID_VERTEX;
+    uint32_t length = UINT32_MAX;
+    uint32_t limit = maxDepth < 0 ? UINT32_MAX : (uint32_t)maxDepth;
+    while (!sides[0].frontier.empty() && !sides[1].frontier.empty()) {
+        if (sides[0].level + sides[1].level + 1 > limit) break;
+        int s = sides[0].frontier.size() <= sides[1].frontier.size() ? 0 : 1;
+        if (expand(graph, s, meet, length, result.explored)) break;
+    }
+    if (meet == INVALID_VERTEX) return result;
+
+    // Walk back to the source, then forward to the target.
+    for (VertexId v = meet; v != INVALID_VERTEX; v = sides[0].parent[v])
+        result.path.push_back(v);
+    reverse(result.path.begin(), result.path.end());
+    for (VertexId v = sides[1].parent[meet]; v != INVALID_VERTEX; v = sides[1].parent[v])
+        result.path.push_back(v);
+    result.found = true;
+    return result;
+}
@@ -0,0 +1,45 @@
+#ifndef PATH_FINDER_HPP
+#define PATH_FINDER_HPP
+
+#include <cstdint>
+#include <vector>
+#include "CsrGraph.hpp"
+
+using namespace std;
+
+struct PathResult {
+    bool found = false;
+    vector<VertexId> path;       // source .. target, empty if not found
+    size_t explored = 0;         // vertices visited by both searches
+
+    size_t hops() const { return path.empty() ? 0 : path.size() - 1; }
+};
+
+// Shortest paths by bidirectional BFS. Each side grows a level at a time,
+// always the one with the smaller frontier, so a d-hop path explores about
+// 2 * b^(d/2) vertices instead of b^d. Visited marks are epoch-stamped and
+// the arrays are kept between queries, so nothing is cleared per call (one
+// PathFinder must not be shared between threads).
+class PathFinder {
+private:
+    struct Side {
+        vector<uint32_t> seen;       // == epoch when visited this query
+        vector<VertexId> parent;
+        vector<uint32_t> depth;
+        vector<VertexId> frontier, next;
+        uint32_t level = 0;
+    };
+    Side sides[2];
+    uint32_t epoch = 0;
+
+    void reset(size_t n);
+    bool expand(const CsrGraph& graph, int s, VertexId& bestMeet, uint32_t& bestLength,
+                size_t& explored);
+
+public:
+    // maxDepth < 0 means unlimited; otherwise paths longer than maxDepth
+    // hops count as not found.
+    PathResult find(const CsrGraph& graph, VertexId source, VertexId target, int maxDepth = -1);
+};
+
+#endif
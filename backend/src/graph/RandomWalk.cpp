@@ -0,0 +1,162 @@
+#include "RandomWalk.hpp"
+#include "Recommender.hpp"
+#include "../utils/Metrics.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+constexpr size_t BUILD_GRAIN = 1024;   // vertices per parallelFor chunk
+constexpr size_t WALK_LANES = 8;       // walks advanced in lockstep
+
+struct Lane {
+    VertexId v;                        // INVALID_VERTEX once the lane is retired
+    uint32_t left;                     // steps before this walk restarts
+    const VertexId* next;              // rest of the segment being followed
+    const VertexId* end;
+};
+
+uint64_t seedFor(uint64_t seed, VertexId v) {
+    return seed ^ ((uint64_t)v + 1) * 0x9E3779B97F4A7C15ull;
+}
+}
+
+// =================== SEGMENTS ===================
+
+shared_ptr<const WalkSegments> WalkSegments::build(const CsrGraph& graph, uint32_t perVertex,
+                                                   ThreadPool& pool, uint64_t seed) {
+    auto segs = make_shared<WalkSegments>();
+    auto offsets = graph.csrOffsets();
+    auto adj = graph.csrAdjacency();
+    size_t n = offsets.size() - 1;
+    segs->perVertex = min<uint32_t>(perVertex, 255);
+    segs->vertices = n;
+    segs->arrays = graph.csrArrays();
+    segs->steps.resize(n * segs->perVertex * WALK_SEGMENT_LENGTH);
+
+    // Each vertex draws from its own generator, so the result does not
+    // depend on how the range was split between threads. A vertex's segments
+    // advance together, one step each per round, so their loads overlap.
+    uint32_t per = segs->perVertex;
+    pool.parallelFor(n, BUILD_GRAIN, [&](size_t, size_t b, size_t e) {
+        for (VertexId v = b; v < e; ++v) {
+            WalkRng rng{seedFor(seed, v)};
+            VertexId* out = segs->steps.data() + (size_t)v * per * WALK_SEGMENT_LENGTH;
+            for (uint32_t j = 0; j < WALK_SEGMENT_LENGTH; ++j)
+                for (uint32_t i = 0; i < per; ++i) {
+                    VertexId* seg = out + (size_t)i * WALK_SEGMENT_LENGTH;
+                    VertexId x = j ? seg[j - 1] : v;
+                    if (x == INVALID_VERTEX || offsets[x] == offsets[x + 1]) {
+                        seg[j] = INVALID_VERTEX;   // dead end
+                        continue;
+                    }
+                    uint64_t begin = offsets[x];
+                    seg[j] = adj[begin + rng.below(offsets[x + 1] - begin)];
+                }
+        }
+    });
+    return segs;
+}
+
+// =================== WALKS ===================
+
+vector<Recommendation> RandomWalker::recommend(const CsrGraph& graph, VertexId user, size_t topK,
+                                               const WalkOptions& opts) {
+    size_t slots = graph.vertexSlots();
+    if (visits.size() < slots) {
+        visits.resize(slots, 0);
+        segmentsUsed.resize(slots, 0);
+        excluded.resize(slots, 0);
+    }
+    const WalkSegments* segs = opts.segments && opts.segments->builtFor(graph) ? opts.segments : nullptr;
+    size_t segVertices = segs ? segs->vertexCount() : 0;
+    uint32_t perVertex = segs ? segs->segmentsPerVertex() : 0;
+
+    WalkRng rng{seedFor(opts.seed, user)};
+    double restart = clamp(opts.restart, 0.0, 1.0);
+    double logStay = log1p(-restart);
+    uint64_t steps = 0, stitchedSteps = 0;
+
+    // Steps before a walk restarts are geometric: draw the count once
+    // instead of flipping a coin per step.
+    size_t started = 0;
+    auto start = [&](Lane& lane) {
+        if (started == opts.walks) return false;
+        started++;
+        lane = {user, opts.maxLength, nullptr, nullptr};
+        if (restart >= 1.0) lane.left = 0;
+        else if (restart > 0.0) lane.left = (uint32_t)min<double>(lane.left, log(rng.unit()) / logStay);
+        return true;
+    };
+
+    // Lanes advance one step each per round. Every step is a dependent load
+    // (row, then neighbor), so keeping several independent walks in flight
+    // lets those cache misses overlap instead of queueing.
+    Lane lanes[WALK_LANES];
+    size_t active = 0;
+    for (Lane& lane : lanes) {
+        if (start(lane)) active++;
+        else lane.v = INVALID_VERTEX;
+    }
+    while (active) {
+        for (Lane& lane : lanes) {
+            if (lane.v == INVALID_VERTEX) continue;
+            if (lane.left == 0) {
+                if (!start(lane)) {
+                    lane.v = INVALID_VERTEX;
+                    active--;
+                }
+                continue;
+            }
+
+            VertexId v = lane.v;
+            if (lane.next == lane.end && v < segVertices && segmentsUsed[v] < perVertex &&
+                !graph.rowChanged(v)) {
+                if (segmentsUsed[v] == 0) stitched.push_back(v);
+                auto seg = segs->segment(v, segmentsUsed[v]++);
+                lane.next = seg.data();
+                lane.end = seg.data() + seg.size();
+            }
+            if (lane.next != lane.end) {
+                v = *lane.next++;
+                if (v == INVALID_VERTEX) {   // dead end
+                    lane.left = 0;
+                    continue;
+                }
+                stitchedSteps++;
+                // The rest of the segment was sampled from v's old row.
+                if (graph.rowChanged(v)) lane.next = lane.end;
+            } else {
+                auto nbrs = graph.neighbors(v);
+                if (nbrs.empty()) {
+                    lane.left = 0;
+                    continue;
+                }
+                v = nbrs[rng.below(nbrs.size())];
+            }
+            if (visits[v]++ == 0) touched.push_back(v);
+            lane.v = v;
+            lane.left--;
+            steps++;
+        }
+    }
+    METRIC_ADD(WalkSampledSteps, steps - stitchedSteps);
+    METRIC_ADD(WalkStitchedSteps, stitchedSteps);
+
+    excluded[user] = 1;
+    for (VertexId f : graph.neighbors(user)) excluded[f] = 1;
+    vector<Recommendation> out;
+    for (VertexId c : touched) {
+        if (!excluded[c]) out.push_back({c, (double)visits[c] / steps});
+        visits[c] = 0;
+    }
+    touched.clear();
+    for (VertexId v : stitched) segmentsUsed[v] = 0;
+    stitched.clear();
+    excluded[user] = 0;
+    for (VertexId f : graph.neighbors(user)) excluded[f] = 0;
+
+    keepTopK(out, topK);
+    return out;
+}
@@ -0,0 +1,100 @@
+#ifndef RANDOM_WALK_HPP
+#define RANDOM_WALK_HPP
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "../utils/ThreadPool.hpp"
+
+using namespace std;
+
+struct Recommendation;   // Recommender.hpp
+
+// Steps per precomputed walk segment. Walks restarting with probability 0.15
+// average ~6.7 steps, so one segment usually covers a whole walk.
+constexpr uint32_t WALK_SEGMENT_LENGTH = 8;
+
+// SplitMix64: one add and a mix per draw, statistically sound for sampling.
+struct WalkRng {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    // Uniform in [0, n) by multiply-shift (Lemire), no division.
+    uint32_t below(uint32_t n) { return (uint32_t)(((next() >> 32) * n) >> 32); }
+    // Uniform in (0, 1].
+    double unit() { return ((next() >> 11) + 1) * 0x1p-53; }
+};
+
+// Random walks precomputed from every vertex of a graph's base CSR arrays:
+// `perVertex` segments of WALK_SEGMENT_LENGTH steps each, stored back to
+// back (INVALID_VERTEX after a dead end). A query stitches them together
+// instead of sampling each step from the adjacency arrays, using every
+// segment at most once so its walks stay independent.
+//
+// A step out of v stays a uniform sample of v's neighbors for as long as v's
+// row is unchanged, so segments stay usable across mutations: the walker
+// leaves a segment at the first vertex whose row has moved to the delta
+// layer. Once the graph compacts, the segments no longer match its arrays and
+// have to be rebuilt (see builtFor()).
+class WalkSegments {
+private:
+    vector<VertexId> steps;
+    uint32_t perVertex = 0;
+    size_t vertices = 0;
+    weak_ptr<const void> arrays;     // the base CSR they were sampled from
+
+public:
+    // perVertex is capped at 255.
+    static shared_ptr<const WalkSegments> build(const CsrGraph& graph, uint32_t perVertex,
+                                                ThreadPool& pool, uint64_t seed = 0);
+
+    bool builtFor(const CsrGraph& graph) const { return arrays.lock() == graph.csrArrays(); }
+    uint32_t segmentsPerVertex() const { return perVertex; }
+    size_t vertexCount() const { return vertices; }
+    size_t bytes() const { return steps.size() * sizeof(VertexId); }
+
+    span<const VertexId> segment(VertexId v, uint32_t i) const {
+        return {steps.data() + ((size_t)v * perVertex + i) * WALK_SEGMENT_LENGTH, WALK_SEGMENT_LENGTH};
+    }
+};
+
+struct WalkOptions {
+    size_t walks = 2000;         // walk budget per query
+    double restart = 0.15;       // chance of jumping back to the user before each step
+    uint32_t maxLength = 32;     // steps per walk at most, so a query is <= walks * maxLength steps
+    uint64_t seed = 0;
+    const WalkSegments* segments = nullptr;   // optional, used if built for the queried graph
+};
+
+// Personalized PageRank by Monte Carlo: random walks with restart from the
+// query user, candidates ranked by the share of steps that landed on them.
+// Unlike friends-of-friends scoring this reaches past two hops and is not
+// dominated by globally popular users, and the cost of a query depends only
+// on the walk budget, never on the size of the graph.
+//
+// Visit counts live in scratch arrays reset through a touched list, so once
+// they have grown to the graph a query allocates only its result (one
+// RandomWalker per thread). Each query seeds its own generator from
+// (seed, user), so the same graph and options give the same answer.
+class RandomWalker {
+private:
+    vector<uint32_t> visits;     // per-vertex steps landed this query
+    vector<uint8_t> segmentsUsed;   // per-vertex segments consumed this query
+    vector<uint8_t> excluded;    // the user and their current friends
+    vector<VertexId> touched;    // vertices with visits > 0
+    vector<VertexId> stitched;   // vertices with segmentsUsed > 0
+
+public:
+    // Top-K candidates by descending score (ties by vertex ID).
+    vector<Recommendation> recommend(const CsrGraph& graph, VertexId user, size_t topK,
+                                     const WalkOptions& opts);
+};
+
+#endif
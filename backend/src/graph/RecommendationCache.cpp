@@ -0,0 +1,97 @@
+#include "RecommendationCache.hpp"
+#include "../utils/Metrics.hpp"
+#include <algorithm>
+
+using namespace std;
+
+bool RecommendationCache::lookup(VertexId user, ScoreFunction fn, size_t topK, vector<Recommendation>& out) {
+    if (!cacheable(fn)) return false;
+    auto it = index.find(keyOf(user, fn));
+    if (it == index.end()) {
+        counters.misses++;
+        METRIC_ADD(RecommendCacheMisses, 1);
+        return false;
+    }
+    Entry& e = *it->second;
+    bool stale = fn == ScoreFunction::PageRankMutual && e.epoch != epoch;
+    // A list shorter than what was asked for already holds every candidate.
+    bool covers = e.topK >= topK || e.recs.size() < e.topK;
+    if (stale || !covers) {
+        if (stale) {
+            erase(e.key);
+            counters.invalidations++;
+        }
+        counters.misses++;
+        METRIC_ADD(RecommendCacheMisses, 1);
+        return false;
+    }
+
+    lru.splice(lru.begin(), lru, it->second);
+    out.assign(e.recs.begin(), e.recs.begin() + min(topK, e.recs.size()));
+    counters.hits++;
+    METRIC_ADD(RecommendCacheHits, 1);
+    return true;
+}
+
+void RecommendationCache::store(VertexId user, ScoreFunction fn, size_t topK, const vector<Recommendation>& recs) {
+    if (capacity == 0 || !cacheable(fn)) return;
+    uint64_t key = keyOf(user, fn);
+    auto it = index.find(key);
+    if (it != index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        *it->second = {key, topK, epoch, recs};
+        return;
+    }
+
+    if (index.size() >= capacity) {
+        index.erase(lru.back().key);
+        lru.pop_back();
+        counters.evictions++;
+    }
+    lru.push_front({key, topK, epoch, recs});
+    index[key] = lru.begin();
+}
+
+void RecommendationCache::erase(uint64_t key) {
+    auto it = index.find(key);
+    if (it == index.end()) return;
+    lru.erase(it->second);
+    index.erase(it);
+}
+
+void RecommendationCache::invalidate(VertexId user) {
+    for (ScoreFunction fn : {ScoreFunction::PageRankMutual, ScoreFunction::AdamicAdar,
+                             ScoreFunction::Jaccard, ScoreFunction::ResourceAllocation,
+                             ScoreFunction::SimilarCircles}) {
+        size_t before = index.size();
+        erase(keyOf(user, fn));
+        counters.invalidations += before - index.size();
+    }
+}
+
+void RecommendationCache::invalidateAround(const CsrGraph& graph, VertexId v) {
+    if (index.empty()) return;
+    invalidate(v);
+    if (!graph.isAlive(v)) return;
+
+    // Dedup isn't worth it: invalidating an absent user is one hash probe.
+    for (VertexId f : graph.neighbors(v)) {
+        invalidate(f);
+        for (VertexId x : graph.neighbors(f))
+            if (x != v) invalidate(x);
+        if (index.empty()) return;
+    }
+}
+
+void RecommendationCache::clear() {
+    counters.invalidations += index.size();
+    lru.clear();
+    index.clear();
+}
+
+CacheStats RecommendationCache::stats() const {
+    CacheStats st = counters;
+    st.entries = index.size();
+    st.capacity = capacity;
+    return st;
+}
@@ -0,0 +1,68 @@
+#ifndef RECOMMENDATION_CACHE_HPP
+#define RECOMMENDATION_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "Recommender.hpp"
+
+using namespace std;
+
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t invalidations = 0;    // entries dropped by graph or PageRank changes
+    size_t entries = 0;
+    size_t capacity = 0;
+};
+
+// LRU cache of top-K recommendation lists, keyed by (user, score function).
+//
+// A list stays valid until something within two hops of its user changes:
+// candidates and their mutual counts come from friends-of-friends, and the
+// Jaccard/AA/RA weights read the degrees of vertices up to two hops out. So
+// a changed adjacency row invalidates exactly the users within two hops of
+// that vertex. PageRank-weighted lists also depend on the global rank
+// vector; they carry the rank epoch they were computed under. Personalized
+// PageRank walks can end anywhere in the graph, so those lists are never
+// cached (their cost is bounded by the walk budget instead). Similar-circle
+// lists only hold users sharing a friend, so two hops covers them too.
+class RecommendationCache {
+private:
+    struct Entry {
+        uint64_t key;
+        size_t topK;             // how many were asked for
+        uint64_t epoch;
+        vector<Recommendation> recs;
+    };
+    list<Entry> lru;             // most recently used first
+    unordered_map<uint64_t, list<Entry>::iterator> index;
+    size_t capacity;
+    uint64_t epoch = 0;
+    CacheStats counters;
+
+    static uint64_t keyOf(VertexId user, ScoreFunction fn) { return (uint64_t)user << 8 | (uint64_t)fn; }
+    static bool cacheable(ScoreFunction fn) { return fn != ScoreFunction::PersonalizedPageRank; }
+    void erase(uint64_t key);
+
+public:
+    explicit RecommendationCache(size_t maxEntries = 4096) : capacity(maxEntries) {}
+
+    // A hit needs a list computed for at least topK results, or one that came
+    // back short (it holds every candidate); it is truncated to topK in `out`.
+    bool lookup(VertexId user, ScoreFunction fn, size_t topK, vector<Recommendation>& out);
+    void store(VertexId user, ScoreFunction fn, size_t topK, const vector<Recommendation>& recs);
+
+    void invalidate(VertexId user);
+    // Drops every user within two hops of v, v included.
+    void invalidateAround(const CsrGraph& graph, VertexId v);
+    void bumpEpoch() { epoch++; }    // PageRank changed
+    void clear();
+
+    CacheStats stats() const;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "Recommender.hpp"
+#include "../utils/Metrics.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+bool parseScoreFunction(const string& name, ScoreFunction& out) {
+    if (name == "pagerank") out = ScoreFunction::PageRankMutual;
+    else if (name == "adamic-adar" || name == "aa") out = ScoreFunction::AdamicAdar;
+    else if (name == "jaccard") out = ScoreFunction::Jaccard;
+    else if (name == "resource-allocation" || name == "ra") out = ScoreFunction::ResourceAllocation;
+    else if (name == "personalized-pagerank" || name == "ppr") out = ScoreFunction::PersonalizedPageRank;
+    else if (name == "similar-circles" || name == "similar") out = ScoreFunction::SimilarCircles;
+    else return false;
+    return true;
+}
+
+const char* scoreFunctionName(ScoreFunction fn) {
+    switch (fn) {
+        case ScoreFunction::PageRankMutual: return "pagerank";
+        case ScoreFunction::AdamicAdar: return "adamic-adar";
+        case ScoreFunction::Jaccard: return "jaccard";
+        case ScoreFunction::ResourceAllocation: return "resource-allocation";
+        case ScoreFunction::PersonalizedPageRank: return "personalized-pagerank";
+        case ScoreFunction::SimilarCircles: return "similar-circles";
+    }
+    return "?";
+}
+
+uint64_t fixedWeight(ScoreFunction fn, size_t friendDegree) {
+    double w = 0.0;
+    if (fn == ScoreFunction::AdamicAdar) w = friendDegree > 1 ? 1.0 / log((double)friendDegree) : 0.0;
+    else if (fn == ScoreFunction::ResourceAllocation) w = 1.0 / friendDegree;
+    return (uint64_t)llround(w / WEIGHT_UNIT);
+}
+
+void keepTopK(vector<Recommendation>& recs, size_t topK) {
+    // Select the top K without sorting the whole candidate list.
+    auto better = [](const Recommendation& a, const Recommendation& b) {
+        return a.score != b.score ? a.score > b.score : a.vertex < b.vertex;
+    };
+    if (recs.size() > topK) {
+        nth_element(recs.begin(), recs.begin() + topK, recs.end(), better);
+        recs.resize(topK);
+    }
+    sort(recs.begin(), recs.end(), better);
+}
+
+vector<Recommendation> Recommender::recommend(const CsrGraph& graph, VertexId user, size_t topK,
+                                              ScoreFunction fn, span<const double> pageRank,
+                                              const WalkOptions& walk, const MinHashIndex* circles) {
+    METRIC_TIMER(RecommendSeconds);
+    if (fn == ScoreFunction::PersonalizedPageRank) return walker.recommend(graph, user, topK, walk);
+    if (fn == ScoreFunction::SimilarCircles)
+        return circles ? probe.similar(*circles, graph, user, topK, true) : vector<Recommendation>{};
+
+    size_t slots = graph.vertexSlots();
+    if (mutual.size() < slots) {
+        mutual.resize(slots, 0);
+        weight.resize(slots, 0);
+        excluded.resize(slots, 0);
+    }
+
+    auto friends = graph.neighbors(user);
+    excluded[user] = 1;
+    for (VertexId f : friends) excluded[f] = 1;
+
+    // Walk friends' friends, accumulating per-candidate mutual counts.
+    bool weighted = fn == ScoreFunction::AdamicAdar || fn == ScoreFunction::ResourceAllocation;
+    for (VertexId f : friends) {
+        auto fof = graph.neighbors(f);
+        uint64_t w = weighted ? fixedWeight(fn, fof.size()) : 0;
+        for (VertexId c : fof) {
+            if (excluded[c]) continue;
+            if (mutual[c]++ == 0) touched.push_back(c);
+            if (weighted) weight[c] += w;
+        }
+    }
+
+    METRIC_OBSERVE(RecommendCandidates, touched.size());
+    vector<Recommendation> out;
+    out.reserve(touched.size());
+    for (VertexId c : touched) {
+        double score = 0.0;
+        switch (fn) {
+            case ScoreFunction::PageRankMutual:
+                // An unranked vertex scores 0: a stand-in like 1.0 would be
+                // about N times any real rank and put it first.
+                score = c < pageRank.size() ? mutual[c] * pageRank[c] : 0.0;
+                break;
+            case ScoreFunction::Jaccard:
+                score = (double)mutual[c] / (friends.size() + graph.degree(c) - mutual[c]);
+                break;
+            default:
+                score = weight[c] * WEIGHT_UNIT;
+        }
+        if (score > 0) out.push_back({c, score});
+        mutual[c] = 0;
+        weight[c] = 0;
+    }
+    touched.clear();
+    excluded[user] = 0;
+    for (VertexId f : friends) excluded[f] = 0;
+
+    keepTopK(out, topK);
+    return out;
+}
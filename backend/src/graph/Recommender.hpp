@@ -0,0 +1,68 @@
+#ifndef RECOMMENDER_HPP
+#define RECOMMENDER_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include "CsrGraph.hpp"
+#include "MinHash.hpp"
+#include "RandomWalk.hpp"
+
+using namespace std;
+
+enum class ScoreFunction {
+    PageRankMutual,      // mutual friends x candidate PageRank (the original score)
+    AdamicAdar,          // sum over mutual friends z of 1 / log(deg z)
+    Jaccard,             // |N(u) & N(c)| / |N(u) | N(c)|
+    ResourceAllocation,  // sum over mutual friends z of 1 / deg z
+    PersonalizedPageRank, // share of random walks from the user that visit c (see RandomWalk.hpp)
+    SimilarCircles       // Jaccard of friend lists, over LSH collisions only (see MinHash.hpp)
+};
+
+// Accepts "pagerank", "adamic-adar"/"aa", "jaccard", "resource-allocation"/"ra",
+// "personalized-pagerank"/"ppr", "similar-circles"/"similar".
+bool parseScoreFunction(const string& name, ScoreFunction& out);
+const char* scoreFunctionName(ScoreFunction fn);
+
+struct Recommendation {
+    VertexId vertex;
+    double score;
+};
+
+// Keeps the topK best (descending score, ties by vertex ID), sorted.
+void keepTopK(vector<Recommendation>& recs, size_t topK);
+
+// AdamicAdar/ResourceAllocation weights are added up in fixed point, units
+// of 2^-32, so a score doesn't depend on the order its mutual friends are
+// visited in; a cluster adds per-shard partial sums and gets the same score
+// and tie order as one process (see cluster/Coordinator.hpp).
+constexpr double WEIGHT_UNIT = 0x1p-32;
+uint64_t fixedWeight(ScoreFunction fn, size_t friendDegree);
+
+// Friends-of-friends recommender. Only vertices two hops from the query user
+// are ever looked at; their mutual counts and weights are accumulated in
+// scratch arrays that are reused across queries (so one Recommender must not
+// be shared between threads). PersonalizedPageRank is handed to a
+// RandomWalker instead, and SimilarCircles to an LshProbe, which can reach
+// users with no friend in common.
+class Recommender {
+private:
+    vector<uint32_t> mutual;     // per-vertex mutual-friend count, 0 = untouched
+    vector<uint64_t> weight;     // per-vertex accumulated AA/RA weight, see fixedWeight()
+    vector<uint8_t> excluded;    // the user and their current friends
+    vector<VertexId> touched;    // vertices with mutual > 0 this query
+    RandomWalker walker;
+    LshProbe probe;
+
+public:
+    // Top-K candidates by descending score (ties by vertex ID). PageRankMutual
+    // needs pageRank to cover graph.vertexSlots(); candidates it doesn't rank
+    // score 0 and are left out.
+    // `walk` only applies to PersonalizedPageRank; SimilarCircles needs an
+    // index built over `graph` and returns nothing without one.
+    vector<Recommendation> recommend(const CsrGraph& graph, VertexId user, size_t topK,
+                                     ScoreFunction fn, span<const double> pageRank = {},
+                                     const WalkOptions& walk = {}, const MinHashIndex* circles = nullptr);
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "NameIndex.hpp"
+#include <functional>
+
+using namespace std;
+
+uint32_t NameIndex::tagOf(string_view key) {
+    size_t h = hash<string_view>{}(key);
+    return uint32_t(h ^ (h >> 32));
+}
+
+// The home slot is the tag's low bits, so growing never re-reads a key.
+void NameIndex::rehash(size_t capacity) {
+    vector<uint64_t> old = std::move(slots);
+    slots.assign(capacity, 0);
+    mask = capacity - 1;
+    for (uint64_t s : old) {
+        if (!s) continue;
+        size_t i = (s >> 32) & mask;
+        while (slots[i]) i = (i + 1) & mask;
+        slots[i] = s;
+    }
+}
+
+void NameIndex::reserve(size_t n) {
+    size_t cap = 16;
+    while (cap < n * 2) cap <<= 1;
+    if (cap > slots.size()) rehash(cap);
+}
+
+void NameIndex::clear() {
+    slots.clear();
+    mask = 0;
+    count = 0;
+}
+
+StringHandle NameIndex::find(string_view key, const StringArena& keys) const {
+    if (slots.empty()) return INVALID_HANDLE;
+    uint64_t tag = (uint64_t)tagOf(key) << 32;
+    for (size_t i = (tag >> 32) & mask;; i = (i + 1) & mask) {
+        uint64_t s = slots[i];
+        if (!s) return INVALID_HANDLE;
+        if ((s & ~0xffffffffull) == tag && keys[(s & 0xffffffff) - 1] == key)
+            return (s & 0xffffffff) - 1;
+    }
+}
+
+bool NameIndex::insert(StringHandle h, const StringArena& keys) {
+    if ((count + 1) * 2 > slots.size()) reserve(count + 1);
+    string_view key = keys[h];
+    uint64_t tag = (uint64_t)tagOf(key) << 32;
+    for (size_t i = (tag >> 32) & mask;; i = (i + 1) & mask) {
+        uint64_t s = slots[i];
+        if (!s) {
+            slots[i] = tag | (h + 1);
+            count++;
+            return true;
+        }
+        if ((s & ~0xffffffffull) == tag && keys[(s & 0xffffffff) - 1] == key) return false;
+    }
+}
+
+bool NameIndex::erase(string_view key, const StringArena& keys) {
+    if (slots.empty()) return false;
+    uint64_t tag = (uint64_t)tagOf(key) << 32;
+    size_t i = (tag >> 32) & mask;
+    for (;; i = (i + 1) & mask) {
+        uint64_t s = slots[i];
+        if (!s) return false;
+        if ((s & ~0xffffffffull) == tag && keys[(s & 0xffffffff) - 1] == key) break;
+    }
+
+    // Pull back each later entry of the run that may sit at the hole: one
+    // whose home slot is not cyclically within (hole, its position].
+    for (size_t j = (i + 1) & mask; slots[j]; j = (j + 1) & mask) {
+        size_t home = (slots[j] >> 32) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i] = 0;
+    count--;
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef NAME_INDEX_HPP
+#define NAME_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "StringArena.hpp"
+
+using namespace std;
+
+// String -> handle lookup for the strings of a StringArena.
+//
+// Linear-probing table kept at most half full. Each slot packs a 32-bit hash
+// tag with handle + 1 (0 = empty), and keys are compared against the arena,
+// so the index holds no strings and costs 16 bytes per entry at worst.
+// erase() shifts the following run back instead of leaving tombstones. The
+// arena isn't stored: every call takes the one the handles refer to.
+class NameIndex {
+private:
+    vector<uint64_t> slots;
+    size_t mask = 0;
+    size_t count = 0;
+
+    static uint32_t tagOf(string_view key);
+    void rehash(size_t capacity);
+
+public:
+    void reserve(size_t n);
+    void clear();
+
+    StringHandle find(string_view key, const StringArena& keys) const;
+    // Indexes keys[h]; false (and no change) if that string is already present.
+    bool insert(StringHandle h, const StringArena& keys);
+    bool erase(string_view key, const StringArena& keys);
+
+    size_t size() const { return count; }
+    size_t memoryBytes() const { return slots.capacity() * sizeof(uint64_t); }
+};
+
+#endif
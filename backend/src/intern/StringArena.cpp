@@ -0,0 +1,25 @@
+#include "StringArena.hpp"
+
+using namespace std;
+
+StringArena::StringArena(span<const uint64_t> tableOffsets, const char* tableBytes,
+                         shared_ptr<const void> backingMemory)
+    : externalOffsets(tableOffsets.data()), externalBytes(tableBytes),
+      externalCount(tableOffsets.empty() ? 0 : tableOffsets.size() - 1),
+      backing(std::move(backingMemory)) {}
+
+StringHandle StringArena::add(string_view s) {
+    StringHandle h = size();
+    bytes.insert(bytes.end(), s.begin(), s.end());
+    offsets.push_back(bytes.size());
+    return h;
+}
+
+void StringArena::reserve(size_t strings, size_t totalBytes) {
+    offsets.reserve(strings + 1);
+    bytes.reserve(totalBytes);
+}
+
+void StringArena::clear() {
+    *this = StringArena();
+}
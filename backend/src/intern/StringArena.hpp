@@ -0,0 +1,55 @@
+#ifndef STRING_ARENA_HPP
+#define STRING_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+using StringHandle = uint32_t;
+constexpr StringHandle INVALID_HANDLE = UINT32_MAX;
+
+// Append-only string storage addressed by dense 32-bit handles.
+//
+// Bytes are packed back to back with an offsets array alongside (string h is
+// bytes[offsets[h], offsets[h + 1])), so a string costs its length plus 8
+// bytes: no per-string allocation, header or terminator. An arena can start
+// from a table it doesn't own, such as a mapped snapshot's string section;
+// strings added afterwards go to an owned tail. Handles are stable for the
+// arena's lifetime, views until the next add().
+class StringArena {
+private:
+    // Adopted table, handles [0, externalCount); offsets index externalBytes.
+    const uint64_t* externalOffsets = nullptr;
+    const char* externalBytes = nullptr;
+    size_t externalCount = 0;
+    shared_ptr<const void> backing;          // keeps the adopted table alive
+
+    vector<uint64_t> offsets{0};             // owned tail, handles from externalCount
+    vector<char> bytes;
+
+public:
+    StringArena() = default;
+    // Adopts offsets.size() - 1 strings laid out as above, without copying.
+    StringArena(span<const uint64_t> tableOffsets, const char* tableBytes,
+                shared_ptr<const void> backingMemory);
+
+    StringHandle add(string_view s);
+    void reserve(size_t strings, size_t totalBytes);
+    void clear();
+
+    string_view operator[](StringHandle h) const {
+        if (h < externalCount)
+            return {externalBytes + externalOffsets[h], size_t(externalOffsets[h + 1] - externalOffsets[h])};
+        h -= externalCount;
+        return {bytes.data() + offsets[h], size_t(offsets[h + 1] - offsets[h])};
+    }
+    size_t size() const { return externalCount + offsets.size() - 1; }
+    size_t ownedBytes() const { return bytes.capacity() + offsets.capacity() * sizeof(uint64_t); }
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "AtomicFile.hpp"
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+AtomicFile::AtomicFile(const string& targetPath)
+    : path(targetPath), tmpPath(targetPath + ".tmp"), buffer(BUFFER_BYTES) {
+    file = fopen(tmpPath.c_str(), "wb");
+    if (file) setvbuf(file, nullptr, _IONBF, 0);   // already buffered here
+}
+
+AtomicFile::~AtomicFile() {
+    if (!file) return;
+    fclose(file);
+    error_code ec;
+    filesystem::remove(tmpPath, ec);
+}
+
+void AtomicFile::flush() {
+    if (!used) return;
+    if (!failed && fwrite(buffer.data(), 1, used, file) != used) failed = true;
+    flushed += used;
+    used = 0;
+}
+
+void AtomicFile::write(const void* data, size_t bytes) {
+    if (!file) return;
+    const char* p = (const char*)data;
+    if (bytes >= buffer.size()) {
+        flush();
+        if (!failed && fwrite(p, 1, bytes, file) != bytes) failed = true;
+        flushed += bytes;
+        return;
+    }
+    if (used + bytes > buffer.size()) flush();
+    memcpy(buffer.data() + used, p, bytes);
+    used += bytes;
+}
+
+void AtomicFile::writeAt(uint64_t offset, const void* data, size_t bytes) {
+    if (!file) return;
+    flush();
+    if (failed || fseek(file, (long)offset, SEEK_SET) != 0 || fwrite(data, 1, bytes, file) != bytes ||
+        fseek(file, 0, SEEK_END) != 0)
+        failed = true;
+}
+
+bool AtomicFile::commit() {
+    if (!file) return false;
+    flush();
+    if (fflush(file) != 0) failed = true;
+#ifdef _WIN32
+    if (!failed && _commit(_fileno(file)) != 0) failed = true;
+#else
+    if (!failed && fsync(fileno(file)) != 0) failed = true;
+#endif
+    if (fclose(file) != 0) failed = true;
+    file = nullptr;
+
+    error_code ec;
+    if (failed) {
+        filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    // The rename itself is only durable once the directory is synced.
+    syncDirectory(path);
+    return true;
+}
+
+bool syncDirectory(const string& filePath) {
+#ifdef _WIN32
+    (void)filePath;   // NTFS journals renames and deletes itself
+    return true;
+#else
+    string dir = filesystem::path(filePath).parent_path().string();
+    int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
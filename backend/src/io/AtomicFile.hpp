@@ -0,0 +1,54 @@
+#ifndef ATOMIC_FILE_HPP
+#define ATOMIC_FILE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Replaces a file all at once. Output goes to `path.tmp` through one large
+// buffer that is handed to the OS in big blocks; commit() flushes, fsyncs and
+// renames it over `path`, so a crash leaves either the old file or the new
+// one, never a prefix. Destroying an uncommitted file deletes the temp file.
+class AtomicFile {
+private:
+    string path, tmpPath;
+    FILE* file = nullptr;
+    vector<char> buffer;
+    size_t used = 0;
+    uint64_t flushed = 0;
+    bool failed = false;
+
+    void flush();
+
+public:
+    static constexpr size_t BUFFER_BYTES = 1 << 20;
+
+    explicit AtomicFile(const string& targetPath);
+    ~AtomicFile();
+    AtomicFile(const AtomicFile&) = delete;
+    AtomicFile& operator=(const AtomicFile&) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+
+    void write(const void* data, size_t bytes);
+    void write(string_view s) { write(s.data(), s.size()); }
+    void put(char c) {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+    // Overwrites bytes already written (e.g. a header patched at the end).
+    void writeAt(uint64_t offset, const void* data, size_t bytes);
+
+    uint64_t size() const { return flushed + used; }
+    bool commit();   // false if any write failed; the target is then untouched
+};
+
+// Makes a rename or removal of `filePath` durable by syncing the directory
+// that holds it. False if the directory could not be opened or synced.
+bool syncDirectory(const string& filePath);
+
+#endif
@@ -0,0 +1,266 @@
+#include "CsvLoader.hpp"
+#include "MappedFile.hpp"
+#include "../utils/Utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <cstdint>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+struct Row {
+    string_view id, username, friends;
+};
+
+// Per-chunk parse results; merged in chunk order so row order = file order.
+struct Chunk {
+    size_t begin = 0, end = 0;
+    vector<Row> rows;
+    size_t malformed = 0;
+    vector<pair<VertexId, VertexId>> edges;
+    size_t unresolved = 0;
+};
+
+// Open-addressing ID -> row table. Slots pack a 32-bit hash tag with row+1
+// and keys are compared against the mapped file, so a lookup touches one
+// slot array instead of chasing unordered_map nodes.
+class IdTable {
+    vector<uint64_t> slots;
+    size_t mask = 0;
+
+public:
+    void reserve(size_t n) {
+        size_t cap = 16;
+        while (cap < n * 2) cap <<= 1;
+        slots.assign(cap, 0);
+        mask = cap - 1;
+    }
+
+    // Returns the row already holding `id`, or stores `row` and returns it.
+    template <class RowId>
+    size_t insert(string_view id, size_t h, size_t row, const RowId& rowId) {
+        uint64_t tag = (uint64_t)(uint32_t)h << 32;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            uint64_t s = slots[i];
+            if (!s) { slots[i] = tag | (row + 1); return row; }
+            if ((s & ~0xffffffffull) == tag && rowId((s & 0xffffffff) - 1) == id)
+                return (s & 0xffffffff) - 1;
+        }
+    }
+
+    template <class RowId>
+    size_t find(string_view id, size_t h, const RowId& rowId) const {
+        uint64_t tag = (uint64_t)(uint32_t)h << 32;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            uint64_t s = slots[i];
+            if (!s) return SIZE_MAX;
+            if ((s & ~0xffffffffull) == tag && rowId((s & 0xffffffff) - 1) == id)
+                return (s & 0xffffffff) - 1;
+        }
+    }
+};
+
+string_view trimCR(string_view s) {
+    if (!s.empty() && s.back() == '\r') s.remove_suffix(1);
+    return s;
+}
+
+void parseChunk(const char* base, Chunk& chunk) {
+    const char* p = base + chunk.begin;
+    const char* end = base + chunk.end;
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        const char* lineEnd = nl ? nl : end;
+        string_view line = trimCR(string_view(p, lineEnd - p));
+        p = lineEnd + 1;
+        if (line.empty()) continue;
+
+        size_t c1 = line.find(',');
+        if (c1 == string_view::npos) { chunk.malformed++; continue; }
+        size_t c2 = line.find(',', c1 + 1);
+        Row row;
+        row.id = line.substr(0, c1);
+        row.username = c2 == string_view::npos ? line.substr(c1 + 1) : line.substr(c1 + 1, c2 - c1 - 1);
+        row.friends = c2 == string_view::npos ? string_view() : line.substr(c2 + 1);
+        if (row.id.empty() || row.username.empty() || row.username.size() > MAX_USERNAME_BYTES) {
+            chunk.malformed++;
+            continue;
+        }
+        chunk.rows.push_back(row);
+    }
+}
+
+} // namespace
+
+bool loadCsvParallel(const string& path, ThreadPool& pool, CsvGraphData& out,
+                     CsvLoadStats& stats, size_t threads) {
+    auto start = chrono::steady_clock::now();
+    stats = {};
+    out = {};
+
+    auto file = MappedFile::open(path);
+    if (!file) {
+        error_code ec;
+        return filesystem::file_size(path, ec) == 0 && !ec;  // empty file = empty graph
+    }
+    const char* base = (const char*)file->data();
+    size_t size = file->size();
+    stats.bytes = size;
+
+    // ---- Split on line boundaries ----
+    size_t workers = threads ? min(threads, pool.size()) : pool.size();
+    size_t target = max<size_t>(1 << 20, size / (workers * 4) + 1);
+    vector<Chunk> chunks;
+    for (size_t pos = 0; pos < size;) {
+        size_t end = min(size, pos + target);
+        if (end < size) {
+            const char* nl = (const char*)memchr(base + end, '\n', size - end);
+            end = nl ? nl - base + 1 : size;
+        }
+        chunks.push_back({pos, end});
+        pos = end;
+    }
+
+    // ---- Tokenize ----
+    pool.parallelFor(chunks.size(), 1, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) parseChunk(base, chunks[i]);
+    }, workers);
+
+    vector<size_t> rowStart(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        rowStart[i + 1] = rowStart[i] + chunks[i].rows.size();
+        stats.malformed += chunks[i].malformed;
+    }
+    size_t totalRows = rowStart.back();
+    stats.rows = totalRows + stats.malformed;
+    vector<string_view> rowIds(totalRows);
+    for (size_t c = 0; c < chunks.size(); ++c)
+        for (size_t i = 0; i < chunks[c].rows.size(); ++i)
+            rowIds[rowStart[c] + i] = chunks[c].rows[i].id;
+    auto rowId = [&](size_t r) { return rowIds[r]; };
+
+    // ---- Shard the ID table by hash; each shard sees its rows in file order ----
+    size_t shardCount = workers * 4;
+    hash<string_view> hasher;
+    vector<size_t> rowHash(totalRows);
+    vector<vector<size_t>> shardRows(shardCount);
+    for (size_t r = 0; r < totalRows; ++r) {
+        rowHash[r] = hasher(rowIds[r]);
+        shardRows[(rowHash[r] >> 40) % shardCount].push_back(r);
+    }
+
+    vector<IdTable> shards(shardCount);   // id -> first row
+    vector<uint8_t> firstOccurrence(totalRows, 0);
+    pool.parallelFor(shardCount, 1, [&](size_t, size_t b, size_t e) {
+        for (size_t s = b; s < e; ++s) {
+            shards[s].reserve(shardRows[s].size());
+            for (size_t r : shardRows[s])
+                if (shards[s].insert(rowIds[r], rowHash[r], r, rowId) == r) firstOccurrence[r] = 1;
+        }
+    }, workers);
+
+    // ---- Same again keyed by username: first row holding each name ----
+    vector<string_view> rowNames(totalRows);
+    for (size_t c = 0; c < chunks.size(); ++c)
+        for (size_t i = 0; i < chunks[c].rows.size(); ++i)
+            rowNames[rowStart[c] + i] = chunks[c].rows[i].username;
+    auto rowName = [&](size_t r) { return rowNames[r]; };
+    vector<size_t> nameHash(totalRows);
+    for (auto& rows : shardRows) rows.clear();
+    for (size_t r = 0; r < totalRows; ++r) {
+        nameHash[r] = hasher(rowNames[r]);
+        shardRows[(nameHash[r] >> 40) % shardCount].push_back(r);
+    }
+    vector<size_t> firstNamed(totalRows);
+    pool.parallelFor(shardCount, 1, [&](size_t, size_t b, size_t e) {
+        for (size_t s = b; s < e; ++s) {
+            IdTable names;
+            names.reserve(shardRows[s].size());
+            for (size_t r : shardRows[s]) firstNamed[r] = names.insert(rowNames[r], nameHash[r], r, rowName);
+        }
+    }, workers);
+    shardRows.clear();
+    nameHash.clear();
+
+    // Dense vertex IDs in file order; names and IDs are interned in that order.
+    // Every row of a username lands on the vertex of its first row; rows only
+    // get a vertex of their own for a username not seen before.
+    vector<VertexId> rowVertex(totalRows, INVALID_VERTEX);
+    unordered_set<string> freshIds;
+    auto idTaken = [&](string_view id) {
+        size_t h = hasher(id);
+        return shards[(h >> 40) % shardCount].find(id, h, rowId) != SIZE_MAX ||
+               freshIds.count(string(id));
+    };
+    VertexId next = 0;
+    for (size_t c = 0; c < chunks.size(); ++c)
+        for (size_t i = 0; i < chunks[c].rows.size(); ++i) {
+            size_t r = rowStart[c] + i;
+            const Row& row = chunks[c].rows[i];
+            size_t named = firstNamed[r];
+            if (named != r) {
+                rowVertex[r] = rowVertex[named];
+                if (rowIds[named] != row.id) stats.merged++;
+                continue;
+            }
+            if (firstOccurrence[r]) {
+                rowVertex[r] = next++;
+                out.names.add(row.username);
+                out.ids.add(row.id);
+                continue;
+            }
+
+            rowVertex[r] = next++;
+            char buf[USER_ID_CHARS];
+            string_view id;
+            for (uint32_t attempt = 0;; ++attempt) {
+                id = formatUserId(userIdHash(row.username, attempt), buf);
+                if (!idTaken(id)) break;
+            }
+            freshIds.emplace(id);
+            out.names.add(row.username);
+            out.ids.add(id);
+            stats.reassigned++;
+        }
+    stats.users = next;
+
+    // ---- Resolve friend lists ----
+    pool.parallelFor(chunks.size(), 1, [&](size_t, size_t b, size_t e) {
+        for (size_t c = b; c < e; ++c) {
+            Chunk& chunk = chunks[c];
+            for (size_t i = 0; i < chunk.rows.size(); ++i) {
+                const Row& row = chunk.rows[i];
+                size_t r = rowStart[c] + i;
+                VertexId self = rowVertex[r];
+
+                string_view rest = row.friends;
+                while (!rest.empty()) {
+                    size_t bar = rest.find('|');
+                    string_view fid = trimCR(rest.substr(0, bar));
+                    rest = bar == string_view::npos ? string_view() : rest.substr(bar + 1);
+                    if (fid.empty()) continue;
+                    size_t h = hasher(fid);
+                    size_t hit = shards[(h >> 40) % shardCount].find(fid, h, rowId);
+                    if (hit == SIZE_MAX) { chunk.unresolved++; continue; }
+                    chunk.edges.push_back({self, rowVertex[hit]});
+                }
+            }
+        }
+    }, workers);
+
+    size_t edgeTotal = 0;
+    for (auto& chunk : chunks) edgeTotal += chunk.edges.size();
+    out.edges.reserve(edgeTotal);
+    for (auto& chunk : chunks) {
+        out.edges.insert(out.edges.end(), chunk.edges.begin(), chunk.edges.end());
+        stats.unresolved += chunk.unresolved;
+    }
+
+    stats.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef CSV_LOADER_HPP
+#define CSV_LOADER_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../graph/CsrGraph.hpp"
+#include "../intern/StringArena.hpp"
+#include "../utils/ThreadPool.hpp"
+
+using namespace std;
+
+struct CsvLoadStats {
+    size_t bytes = 0;
+    size_t rows = 0;            // non-empty lines
+    size_t users = 0;           // distinct IDs
+    size_t malformed = 0;       // missing fields / empty id or username
+    size_t unresolved = 0;      // friend IDs with no matching row
+    size_t reassigned = 0;      // rows whose ID another username had first
+    size_t merged = 0;          // rows whose username another ID had first
+    double millis = 0.0;
+
+    double rowsPerSec() const { return millis > 0 ? rows * 1000.0 / millis : 0.0; }
+    double megabytesPerSec() const { return millis > 0 ? bytes / 1e3 / millis : 0.0; }
+};
+
+// Output of a bulk load, indexed by the dense vertex IDs assigned in file order.
+struct CsvGraphData {
+    StringArena names;
+    StringArena ids;                          // hash ID of each vertex
+    vector<pair<VertexId, VertexId>> edges;
+};
+
+// Parallel loader for the id,username,friend|friend|... format.
+//
+// The file is memory-mapped and cut into chunks on line boundaries. Workers
+// tokenize their chunks into string_views (no per-field allocation), then the
+// ID -> vertex table is built as hash-sharded open-addressing tables, and
+// finally friend lists are resolved against it in parallel. Usernames are
+// unique: every row of a username merges into its first row, whatever its ID,
+// and friend lists naming any of those IDs resolve to that one vertex. A
+// repeated ID with a different username is a collision left by the old 24-bit
+// IDs: that user is kept under a fresh 64-bit ID, while friend lists naming
+// the shared ID still resolve to the first row (the file cannot say which user
+// they meant).
+bool loadCsvParallel(const string& path, ThreadPool& pool, CsvGraphData& out,
+                     CsvLoadStats& stats, size_t threads = 0);
+
+#endif
@@ -1,9 +1,12 @@
 #include "FileManager.hpp"
-#include <fstream>
-#include <sstream>
+#include "Snapshot.hpp"
+#include "AtomicFile.hpp"
+#include "../utils/Metrics.hpp"
+#include <iomanip>
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
 
 using namespace std;
 
@@ -15,152 +18,120 @@ FileManager::FileManager(const string& path, bool silentMode) : silent(silentMod
     filesystem::path p(path);
     filePath = p.is_relative() ? (base / p).lexically_normal().string() : p.lexically_normal().string();
     filesystem::create_directories(filesystem::path(filePath).parent_path());
-}
-
-vector<string> FileManager::split(const string& s, char delimiter) {
-    vector<string> tokens;
-    stringstream ss(s);
-    string item;
-    while (getline(ss, item, delimiter)) {
-        if (!item.empty()) tokens.push_back(item);
-    }
-    return tokens;
-}
-
-string FileManager::join(const vector<string>& items, char delimiter) {
-    string result;
-    for (size_t i = 0; i < items.size(); ++i) {
-        result += items[i];
-        if (i + 1 < items.size()) result.push_back(delimiter);
-    }
-    return result;
+    snapshotPath = filesystem::path(filePath).replace_extension(".snap").string();
+    logPath = filesystem::path(filePath).replace_extension(".wal").string();
 }
 
 // ============ LOAD ============
 
-void FileManager::loadWithHashes(unordered_map<string, unordered_set<string>>& adjList,
-                                 unordered_map<string, string>& idToUser,
-                                 unordered_map<string, string>& userToId) {
-    ifstream file(filePath);
-    if (!file.is_open()) {
+bool FileManager::loadWithHashes(CsrGraph& graph, ThreadPool& pool, CsvLoadStats* stats) {
+    METRIC_TIMER(CsvLoadSeconds);
+    CsvGraphData data;
+    CsvLoadStats local;
+    CsvLoadStats& st = stats ? *stats : local;
+    if (!loadCsvParallel(filePath, pool, data, st)) {
         cerr << "users.csv not found at " << filePath << ", starting fresh.\n";
-        return;
-    }
-
-    // Two-pass load: first read all entries to build id<->username maps, then
-    // resolve friend IDs to usernames. This ensures friend IDs referencing
-    // later lines are handled correctly.
-    struct Entry { string id; string username; string friendsField; };
-    vector<Entry> entries;
-    string line;
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        stringstream ss(line);
-        string id, username, friendsField;
-        getline(ss, id, ',');
-        getline(ss, username, ',');
-        // read the rest as friendsField (may be empty)
-        getline(ss, friendsField);
-
-        // Trim possible Windows CR
-        if (!id.empty() && id.back() == '\r') id.pop_back();
-        if (!username.empty() && username.back() == '\r') username.pop_back();
-        if (!friendsField.empty() && friendsField.back() == '\r') friendsField.pop_back();
-
-        entries.push_back({id, username, friendsField});
-    }
-
-    // First pass: populate id<->username maps and ensure an entry exists in adjList
-    for (const auto &e : entries) {
-        if (e.id.empty() || e.username.empty()) continue;
-        idToUser[e.id] = e.username;
-        userToId[e.username] = e.id;
-        // create empty friend set (will be filled in second pass)
-        adjList[e.username];
-    }
-
-    // Second pass: resolve friend ID lists into usernames
-    for (const auto &e : entries) {
-        if (e.username.empty()) continue;
-        unordered_set<string> friendNames;
-        if (!e.friendsField.empty()) {
-            for (auto fid : split(e.friendsField, '|')) {
-                if (fid.empty()) continue;
-                if (!fid.empty() && fid.back() == '\r') fid.pop_back();
-                if (idToUser.count(fid))
-                    friendNames.insert(idToUser[fid]);
-            }
-        }
-        adjList[e.username] = friendNames;
+        return false;
     }
+    METRIC_ADD(CsvRowsLoaded, st.rows);
+    METRIC_ADD(CsvRowsMalformed, st.malformed);
+    if (st.malformed)
+        cerr << "Skipped " << st.malformed << " malformed lines in " << filePath << "\n";
+    if (st.reassigned)
+        cerr << "Gave " << st.reassigned << " users new IDs (their old IDs collided with another"
+             << " user's); the next checkpoint saves them\n";
+    if (st.merged)
+        cerr << "Merged " << st.merged << " rows into earlier rows for the same username\n";
+
+    graph.build(std::move(data.names), std::move(data.ids), data.edges);
 
-    file.close();
     if (!silent)
-        cout << "Loaded users (with hash IDs) from " << filePath << "\n";
+        cout << "Loaded users (with hash IDs) from " << filePath << " (" << st.rows << " rows in "
+             << fixed << setprecision(1) << st.millis << " ms, " << setprecision(0)
+             << st.rowsPerSec() << " rows/s)\n" << defaultfloat;
+    return true;
 }
 
 // ============ SAVE ============
 
-void FileManager::saveWithHashes(const unordered_map<string, unordered_set<string>>& adjList,
-                                 const unordered_map<string, string>& idToUser,
-                                 const unordered_map<string, string>& userToId) {
-    ofstream file(filePath, ios::trunc);
-    if (!file.is_open()) {
+// Rows are streamed straight from the interned strings into the file's
+// buffer, so saving allocates nothing per row.
+bool FileManager::saveWithHashes(const CsrGraph& graph) {
+    METRIC_TIMER(CsvSaveSeconds);
+    AtomicFile file(filePath);
+    if (!file.isOpen()) {
         cerr << "Error opening " << filePath << " for writing.\n";
-        return;
+        return false;
     }
 
-    for (auto& [id, username] : idToUser) {
-        const auto& friends = adjList.at(username);
-        vector<string> friendIds;
-        for (auto& f : friends)
-            if (userToId.count(f)) friendIds.push_back(userToId.at(f));
-
-        file << id << "," << username << "," << join(friendIds, '|') << "\n";
+    for (VertexId v = 0; v < graph.vertexSlots(); ++v) {
+        if (!graph.isAlive(v)) continue;
+        string_view id = graph.id(v);
+        if (id.empty()) continue;
+
+        file.write(id);
+        file.put(',');
+        file.write(graph.name(v));
+        file.put(',');
+        bool first = true;
+        for (VertexId f : graph.neighbors(v)) {
+            string_view friendId = graph.id(f);
+            if (friendId.empty()) continue;
+            if (!first) file.put('|');
+            file.write(friendId);
+            first = false;
+        }
+        file.put('\n');
     }
 
-    file.close();
+    [[maybe_unused]] uint64_t bytes = file.size();   // only read by METRIC_ADD
+    if (!file.commit()) {
+        cerr << "Error writing " << filePath << "; the previous file is unchanged.\n";
+        return false;
+    }
+    METRIC_ADD(CsvBytesSaved, bytes);
     if (!silent)
         cout << "Saved users with hash IDs to " << filePath << "\n";
+    return true;
 }
 
-// ============ ADD/REMOVE USERS ============
+// ============ SNAPSHOT ============
 
-void FileManager::addUser(const string& id, const string& username) {
-    ofstream file(filePath, ios::app);
-    if (!file.is_open()) return;
-    file << id << "," << username << ",\n";
-    file.close();
+bool FileManager::snapshotIsCurrent() const {
+    error_code ec;
+    if (!filesystem::exists(snapshotPath, ec)) return false;
+    if (!filesystem::exists(filePath, ec)) return true;
+    return filesystem::last_write_time(snapshotPath, ec) >= filesystem::last_write_time(filePath, ec);
 }
 
-void FileManager::removeUser(const string& id) {
-    ifstream in(filePath);
-    if (!in.is_open()) return;
-
-    stringstream buffer;
-    string line;
-    while (getline(in, line)) {
-        if (line.empty()) continue;
-        stringstream ss(line);
-        string currentId;
-        getline(ss, currentId, ',');
-        if (currentId == id) continue;
-        buffer << line << "\n";
+bool FileManager::loadSnapshot(CsrGraph& graph,
+                               vector<double>& pageRank,
+                               uint64_t& lsn) {
+    METRIC_TIMER(SnapshotLoadSeconds);
+    auto start = chrono::steady_clock::now();
+    string error;
+    if (!readSnapshot(snapshotPath, graph, pageRank, &lsn, &error)) {
+        cerr << "Ignoring snapshot " << snapshotPath << ": " << error << "\n";
+        return false;
     }
-
-    in.close();
-    ofstream out(filePath, ios::trunc);
-    out << buffer.str();
-    out.close();
+    if (!silent)
+        cout << "Loaded snapshot " << snapshotPath << " (" << graph.vertexCount() << " users, "
+             << graph.edgeCount() << " friendships) in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms\n";
+    return true;
 }
 
-// ============ UPDATE FRIENDSHIPS ============
-
-void FileManager::updateFriendships(const unordered_map<string, unordered_set<string>>& adjList,
-                                    const unordered_map<string, string>& userToId) {
-    unordered_map<string, string> idToUser;
-    for (auto& [u, id] : userToId)
-        idToUser[id] = u;
-
-    saveWithHashes(adjList, idToUser, userToId);
+bool FileManager::saveSnapshot(const CsrGraph& graph,
+                               const vector<double>& pageRank,
+                               const string& path,
+                               uint64_t lsn) {
+    METRIC_TIMER(SnapshotSaveSeconds);
+    const string& target = path.empty() ? snapshotPath : path;
+    if (!writeSnapshot(target, graph, pageRank, lsn)) {
+        cerr << "Error writing snapshot " << target << "\n";
+        return false;
+    }
+    if (!silent)
+        cout << "Saved snapshot to " << target << "\n";
+    return true;
 }
@@ -5,34 +5,41 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include "../graph/CsrGraph.hpp"
+#include "../utils/ThreadPool.hpp"
+#include "CsvLoader.hpp"
 using namespace std;
 
 class FileManager {
 private:
     string filePath;
+    string snapshotPath;   // filePath with a .snap extension
+    string logPath;        // filePath with a .wal extension
     bool silent;
 
 public:
     FileManager(const string& path = "dataset/users.csv", bool silentMode = false);
 
-    // Load and save using hashed IDs
-    void loadWithHashes(unordered_map<string, unordered_set<string>>& adjList,
-                        unordered_map<string, string>& idToUser,
-                        unordered_map<string, string>& userToId);
-
-    void saveWithHashes(const unordered_map<string, unordered_set<string>>& adjList,
-                        const unordered_map<string, string>& idToUser,
-                        const unordered_map<string, string>& userToId);
-
-    // Incremental updates
-    void addUser(const string& id, const string& username);
-    void removeUser(const string& id);
-    void updateFriendships(const unordered_map<string, unordered_set<string>>& adjList,
-                           const unordered_map<string, string>& userToId);
-
-private:
-    vector<string> split(const string& s, char delimiter);
-    string join(const vector<string>& items, char delimiter);
+    // Load and save using hashed IDs. Loading goes through the parallel
+    // CSV loader; `stats` receives its throughput and error counts. Saving
+    // replaces the file atomically (see AtomicFile.hpp) and returns false,
+    // leaving the old file, if anything could not be written.
+    bool loadWithHashes(CsrGraph& graph, ThreadPool& pool, CsvLoadStats* stats = nullptr);
+    bool saveWithHashes(const CsrGraph& graph);
+
+    // Binary snapshot next to the CSV (see Snapshot.hpp)
+    bool snapshotIsCurrent() const;   // exists and is not older than the CSV
+    bool loadSnapshot(CsrGraph& graph,
+                      vector<double>& pageRank,
+                      uint64_t& lsn);
+    bool saveSnapshot(const CsrGraph& graph,
+                      const vector<double>& pageRank,
+                      const string& path = "",
+                      uint64_t lsn = 0);
+
+    const string& getFilePath() const { return filePath; }
+    const string& getSnapshotPath() const { return snapshotPath; }
+    const string& getLogPath() const { return logPath; }
 };
 
 #endif
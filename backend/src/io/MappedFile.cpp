@@ -0,0 +1,64 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+shared_ptr<MappedFile> MappedFile::open(const string& path) {
+    shared_ptr<MappedFile> file(new MappedFile());
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return nullptr;
+    file->fileHandle = h;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size) || size.QuadPart == 0) return nullptr;
+    file->length = (size_t)size.QuadPart;
+
+    HANDLE m = CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) return nullptr;
+    file->mappingHandle = m;
+
+    file->ptr = (const uint8_t*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!file->ptr) return nullptr;
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+}
+
+#else
+
+shared_ptr<MappedFile> MappedFile::open(const string& path) {
+    shared_ptr<MappedFile> file(new MappedFile());
+    file->fd = ::open(path.c_str(), O_RDONLY);
+    if (file->fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(file->fd, &st) != 0 || st.st_size == 0) return nullptr;
+    file->length = (size_t)st.st_size;
+
+    void* p = mmap(nullptr, file->length, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (p == MAP_FAILED) return nullptr;
+    file->ptr = (const uint8_t*)p;
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (ptr) munmap((void*)ptr, length);
+    if (fd >= 0) close(fd);
+}
+
+#endif
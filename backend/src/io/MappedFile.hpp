@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping
+// view on Windows). The mapping lives as long as the object.
+class MappedFile {
+private:
+    const uint8_t* ptr = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    MappedFile() = default;
+
+public:
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // nullptr if the file can't be opened or mapped (or is empty).
+    static shared_ptr<MappedFile> open(const string& path);
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+};
+
+#endif
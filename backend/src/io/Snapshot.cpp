@@ -0,0 +1,209 @@
+#include "Snapshot.hpp"
+#include "MappedFile.hpp"
+#include "AtomicFile.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+uint64_t padded(uint64_t bytes) { return (bytes + 7) & ~uint64_t(7); }
+
+// Word-at-a-time mixing hash; sections are always padded to whole words.
+uint64_t hashWords(uint64_t h, const void* data, size_t bytes) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h ^= w;
+        h *= 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// Streams sections to disk while hashing them. Writes may be any length;
+// endSection() zero-pads to the next 8-byte boundary.
+struct SectionWriter {
+    AtomicFile& out;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    uint8_t carry[8] = {};
+    size_t carried = 0;
+
+    void write(const void* data, size_t bytes) {
+        out.write((const char*)data, bytes);
+        const uint8_t* p = (const uint8_t*)data;
+        if (carried) {
+            size_t take = min(bytes, 8 - carried);
+            memcpy(carry + carried, p, take);
+            carried += take;
+            p += take;
+            bytes -= take;
+            if (carried < 8) return;
+            hash = hashWords(hash, carry, 8);
+            carried = 0;
+        }
+        size_t whole = bytes - bytes % 8;
+        hash = hashWords(hash, p, whole);
+        carried = bytes - whole;
+        memcpy(carry, p + whole, carried);
+    }
+
+    void endSection() {
+        if (!carried) return;
+        static const uint8_t zeros[8] = {};
+        write(zeros, 8 - carried);
+    }
+};
+
+bool fail(string* error, const string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+} // namespace
+
+// ============ WRITE ============
+
+bool writeSnapshot(const string& path, const CsrGraph& graph,
+                   const vector<double>& pageRank, uint64_t lsn) {
+    // Dense renumbering of live vertices; monotonic, so rows stay sorted.
+    size_t slots = graph.vertexSlots();
+    vector<VertexId> remap(slots, INVALID_VERTEX);
+    vector<VertexId> order;
+    order.reserve(graph.vertexCount());
+    for (VertexId v = 0; v < slots; ++v)
+        if (graph.isAlive(v)) { remap[v] = order.size(); order.push_back(v); }
+    uint64_t V = order.size();
+
+    vector<uint64_t> stringOffsets(2 * V + 1, 0);
+    string strings;
+    for (uint64_t i = 0; i < V; ++i) {
+        strings += graph.name(order[i]);
+        stringOffsets[i + 1] = strings.size();
+    }
+    for (uint64_t i = 0; i < V; ++i) {
+        strings += graph.id(order[i]);
+        stringOffsets[V + i + 1] = strings.size();
+    }
+
+    vector<uint64_t> csrOffsets(V + 1, 0);
+    for (uint64_t i = 0; i < V; ++i)
+        csrOffsets[i + 1] = csrOffsets[i] + graph.degree(order[i]);
+
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.flags = pageRank.size() == slots && V > 0 ? SNAPSHOT_HAS_PAGERANK : 0;
+    header.vertexCount = V;
+    header.adjCount = csrOffsets[V];
+    header.stringBytes = strings.size();
+    header.lsn = lsn;
+
+    AtomicFile out(path);
+    if (!out.isOpen()) return false;
+    out.write(&header, sizeof header);  // checksum patched below
+
+    SectionWriter w{out};
+    w.write(stringOffsets.data(), stringOffsets.size() * sizeof(uint64_t));
+    w.write(strings.data(), strings.size());
+    w.endSection();
+    w.write(csrOffsets.data(), csrOffsets.size() * sizeof(uint64_t));
+
+    // Fast path: no removed slots and no pending delta, so the base CSR
+    // arrays are already exactly what goes on disk.
+    if (V == slots && !graph.hasDelta()) {
+        auto adj = graph.csrAdjacency();
+        w.write(adj.data(), adj.size() * sizeof(VertexId));
+    } else {
+        vector<VertexId> row;
+        for (VertexId v : order) {
+            row.clear();
+            for (VertexId u : graph.neighbors(v)) row.push_back(remap[u]);
+            w.write(row.data(), row.size() * sizeof(VertexId));
+        }
+    }
+    w.endSection();
+
+    if (header.flags & SNAPSHOT_HAS_PAGERANK) {
+        vector<double> ranks(V);
+        for (uint64_t i = 0; i < V; ++i) ranks[i] = pageRank[order[i]];
+        w.write(ranks.data(), ranks.size() * sizeof(double));
+    }
+
+    header.checksum = w.hash;
+    out.writeAt(0, &header, sizeof header);
+    return out.commit();
+}
+
+// ============ READ ============
+
+bool readSnapshot(const string& path, CsrGraph& graph, vector<double>& pageRank,
+                  uint64_t* lsn, string* error) {
+    auto file = MappedFile::open(path);
+    if (!file) return fail(error, "cannot map " + path);
+    if (file->size() < sizeof(SnapshotHeader)) return fail(error, "truncated header");
+
+    SnapshotHeader header;
+    memcpy(&header, file->data(), sizeof header);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof header.magic) != 0)
+        return fail(error, "not a snapshot file");
+    if (header.version != SNAPSHOT_VERSION)
+        return fail(error, "unsupported snapshot version " + to_string(header.version));
+
+    // Every section lies inside the file, so none of its counts can exceed the
+    // file size; checking that first keeps the size arithmetic below from
+    // overflowing on a crafted header.
+    uint64_t V = header.vertexCount;
+    uint64_t fileBytes = file->size();
+    if (V >= INVALID_VERTEX || V > fileBytes / sizeof(uint64_t) ||
+        header.adjCount > fileBytes / sizeof(VertexId) || header.stringBytes > fileBytes)
+        return fail(error, "size mismatch (truncated or corrupt)");
+    uint64_t stringOffsetsAt = sizeof(SnapshotHeader);
+    uint64_t stringsAt = stringOffsetsAt + (2 * V + 1) * sizeof(uint64_t);
+    uint64_t csrOffsetsAt = stringsAt + padded(header.stringBytes);
+    uint64_t adjAt = csrOffsetsAt + (V + 1) * sizeof(uint64_t);
+    uint64_t rankAt = adjAt + padded(header.adjCount * sizeof(VertexId));
+    uint64_t end = rankAt + ((header.flags & SNAPSHOT_HAS_PAGERANK) ? V * sizeof(double) : 0);
+    if (end != file->size()) return fail(error, "size mismatch (truncated or corrupt)");
+
+    const uint8_t* base = file->data();
+    uint64_t hash = hashWords(0xcbf29ce484222325ull, base + sizeof header, end - sizeof header);
+    if (hash != header.checksum) return fail(error, "checksum mismatch");
+
+    auto stringOffsets = (const uint64_t*)(base + stringOffsetsAt);
+    auto strings = (const char*)(base + stringsAt);
+    auto csrOffsets = span<const uint64_t>((const uint64_t*)(base + csrOffsetsAt), V + 1);
+    auto adj = span<const VertexId>((const VertexId*)(base + adjAt), header.adjCount);
+
+    // adopt() serves neighbors() straight from these arrays: rows must lie
+    // inside adj, and each must be a sorted run of valid vertex IDs.
+    if (csrOffsets[0] != 0 || csrOffsets[V] != header.adjCount)
+        return fail(error, "inconsistent CSR offsets");
+    for (uint64_t v = 0; v < V; ++v) {
+        uint64_t b = csrOffsets[v], e = csrOffsets[v + 1];
+        if (b > e || e > header.adjCount) return fail(error, "inconsistent CSR offsets");
+        for (uint64_t i = b; i < e; ++i)
+            if (adj[i] >= V || (i > b && adj[i] <= adj[i - 1]))
+                return fail(error, "invalid adjacency entry");
+    }
+
+    // The string table is used in place, so every string must lie inside it.
+    if (stringOffsets[0] != 0 || stringOffsets[2 * V] != header.stringBytes)
+        return fail(error, "inconsistent string table");
+    for (uint64_t i = 0; i < 2 * V; ++i)
+        if (stringOffsets[i] > stringOffsets[i + 1]) return fail(error, "inconsistent string table");
+
+    pageRank.clear();
+    if (header.flags & SNAPSHOT_HAS_PAGERANK) {
+        auto ranks = (const double*)(base + rankAt);
+        pageRank.assign(ranks, ranks + V);
+    }
+
+    StringArena names({stringOffsets, V + 1}, strings, file);
+    StringArena ids({stringOffsets + V, V + 1}, strings, file);
+    graph.adopt(std::move(names), std::move(ids), csrOffsets, adj, file);
+    if (lsn) *lsn = header.lsn;
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../graph/CsrGraph.hpp"
+
+using namespace std;
+
+// Versioned binary graph snapshot, laid out so the CSR arrays can be used
+// straight out of a memory mapping. All sections are 8-byte aligned.
+//
+//   SnapshotHeader                       64 bytes
+//   uint64 stringOffsets[2V + 1]         names are strings 0..V-1, hash IDs V..2V-1
+//   char   strings[stringBytes]          padded to 8
+//   uint64 csrOffsets[V + 1]
+//   uint32 adjacency[adjCount]           padded to 8
+//   double pageRank[V]                   only if SNAPSHOT_HAS_PAGERANK
+//
+// The checksum covers everything after the header.
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'G', 'S', 'N', 'A', 'P', 0, 0};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_HAS_PAGERANK = 1u << 0;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t vertexCount;
+    uint64_t adjCount;       // directed neighbor entries (2 x edges)
+    uint64_t stringBytes;
+    uint64_t lsn;            // last write-ahead log record folded in (0 = none)
+    uint64_t checksum;
+    uint64_t reserved;
+};
+static_assert(sizeof(SnapshotHeader) == 64);
+
+// Writes the live vertices of `graph` (removed slots are dropped and IDs
+// renumbered densely). pageRank is stored if it has one entry per slot.
+// Written through AtomicFile, so `path` is replaced only once the new
+// snapshot is complete and synced.
+bool writeSnapshot(const string& path, const CsrGraph& graph,
+                   const vector<double>& pageRank, uint64_t lsn = 0);
+
+// Maps `path` and adopts its CSR arrays and string table into `graph`
+// without copying them; only the name index and PageRank are built in memory.
+bool readSnapshot(const string& path, CsrGraph& graph, vector<double>& pageRank,
+                  uint64_t* lsn = nullptr, string* error = nullptr);
+
+#endif
@@ -0,0 +1,264 @@
+#include "WriteAheadLog.hpp"
+#include "AtomicFile.hpp"
+#include "../utils/Metrics.hpp"
+#include "../utils/Utils.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr char WAL_MAGIC[8] = {'S', 'G', 'W', 'A', 'L', 0, 0, 0};
+constexpr uint32_t WAL_VERSION = 1;
+constexpr size_t WAL_HEADER_BYTES = 24;
+constexpr size_t WAL_BUFFER_LIMIT = 1 << 16;
+
+uint32_t checksum32(const char* data, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (uint8_t)data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+template <typename T>
+void put(string& out, T value) {
+    out.append((const char*)&value, sizeof value);
+}
+
+template <typename T>
+bool get(const char*& p, const char* end, T& value) {
+    if (end - p < (ptrdiff_t)sizeof value) return false;
+    memcpy(&value, p, sizeof value);
+    p += sizeof value;
+    return true;
+}
+
+bool getString(const char*& p, const char* end, string& s) {
+    uint16_t len;
+    if (!get(p, end, len) || end - p < len) return false;
+    s.assign(p, len);
+    p += len;
+    return true;
+}
+
+bool syncFile(FILE* f) {
+    if (fflush(f) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Parses one segment, applying records past afterLsn. Returns the byte
+// length of the valid prefix (header + whole, checksummed records).
+size_t replaySegment(const string& segPath, uint64_t afterLsn, uint64_t& lastLsn, size_t& applied,
+                     const function<void(const WalRecord&)>& apply) {
+    ifstream in(segPath, ios::binary);
+    if (!in.is_open()) return 0;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (data.size() < WAL_HEADER_BYTES || memcmp(data.data(), WAL_MAGIC, 8) != 0) {
+        cerr << "Ignoring malformed log " << segPath << "\n";
+        return 0;
+    }
+
+    const char* p = data.data() + WAL_HEADER_BYTES;
+    const char* end = data.data() + data.size();
+    size_t valid = WAL_HEADER_BYTES;
+    while (p < end) {
+        uint32_t len, sum;
+        const char* rec = p;
+        if (!get(p, end, len) || !get(p, end, sum) || end - p < (ptrdiff_t)len) break;
+        if (checksum32(p, len) != sum) break;
+
+        const char* q = p;
+        const char* recEnd = p + len;
+        WalRecord r;
+        uint8_t op;
+        if (!get(q, recEnd, r.lsn) || !get(q, recEnd, op) ||
+            !getString(q, recEnd, r.a) || !getString(q, recEnd, r.b))
+            break;
+        r.op = (WalOp)op;
+        p = recEnd;
+        valid += p - rec;
+
+        lastLsn = max(lastLsn, r.lsn);
+        if (r.lsn > afterLsn) {
+            apply(r);
+            applied++;
+        }
+    }
+    if (valid < data.size())
+        cerr << "Discarding " << data.size() - valid << " torn bytes at the end of " << segPath << "\n";
+    return valid;
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const string& logPath) : path(logPath), rotatedPath(logPath + ".1") {}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (file) {
+        if (flushBuffer()) syncFile(file);
+        fclose(file);
+    }
+}
+
+size_t WriteAheadLog::recover(uint64_t afterLsn, const function<void(const WalRecord&)>& apply) {
+    size_t applied = 0;
+    last = afterLsn;
+    error_code ec;
+    // Cut torn tails so later appends (or a rotate() merge) follow valid data.
+    size_t rotatedValid = replaySegment(rotatedPath, afterLsn, last, applied, apply);
+    if (rotatedValid > 0 && rotatedValid < filesystem::file_size(rotatedPath, ec))
+        filesystem::resize_file(rotatedPath, rotatedValid, ec);
+    size_t valid = replaySegment(path, afterLsn, last, applied, apply);
+
+    if (valid > 0) {
+        if (valid < filesystem::file_size(path, ec))
+            filesystem::resize_file(path, valid, ec);
+        file = fopen(path.c_str(), "ab");
+        if (!file) {
+            cerr << "Error opening log " << path << " for writing.\n";
+            failed = true;
+        }
+        fileBytes = valid;
+    } else {
+        openActive(last);
+    }
+    return applied;
+}
+
+void WriteAheadLog::openActive(uint64_t baseLsn) {
+    if (file) fclose(file);
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        cerr << "Error opening log " << path << " for writing.\n";
+        failed = true;
+        return;
+    }
+    string header(WAL_MAGIC, 8);
+    put(header, WAL_VERSION);
+    put(header, uint32_t(0));
+    put(header, baseLsn);
+    if (fwrite(header.data(), 1, header.size(), file) != header.size() || !syncFile(file)) {
+        cerr << "Error writing log " << path << ".\n";
+        failed = true;
+    }
+    fileBytes = header.size();
+}
+
+uint64_t WriteAheadLog::append(WalOp op, const string& a, const string& b) {
+    static_assert(MAX_USERNAME_BYTES <= UINT16_MAX);
+    if (a.size() > MAX_USERNAME_BYTES || b.size() > MAX_USERNAME_BYTES) {
+        cerr << "Not logging a record with a " << max(a.size(), b.size()) << "-byte name (limit "
+             << MAX_USERNAME_BYTES << ").\n";
+        return 0;
+    }
+    string payload;
+    put(payload, ++last);
+    put(payload, (uint8_t)op);
+    put(payload, (uint16_t)a.size());
+    payload += a;
+    put(payload, (uint16_t)b.size());
+    payload += b;
+
+    put(buffer, (uint32_t)payload.size());
+    put(buffer, checksum32(payload.data(), payload.size()));
+    buffer += payload;
+    fileBytes += 8 + payload.size();
+    if (buffer.size() >= WAL_BUFFER_LIMIT) flushBuffer();
+    return last;
+}
+
+// A failed write may leave a torn record in the file, and recovery stops at
+// the first one, so nothing appended after it could be replayed: a failure
+// is sticky and every later commit reports it.
+bool WriteAheadLog::flushBuffer() {
+    if (buffer.empty()) return !failed;
+    if (!file || failed || fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        if (!failed) cerr << "Error writing log " << path << ".\n";
+        failed = true;
+    }
+    buffer.clear();
+    return !failed;
+}
+
+bool WriteAheadLog::commit() {
+    if (buffer.empty()) return !failed;
+    METRIC_TIMER(WalCommitSeconds);
+    if (flushBuffer() && !syncFile(file)) {
+        cerr << "Error syncing log " << path << ".\n";
+        failed = true;
+    }
+    return !failed;
+}
+
+bool WriteAheadLog::rotate(uint64_t& lsn) {
+    // A broken log can't be folded or renamed into something replayable.
+    if (!flushBuffer() || !file || !syncFile(file)) {
+        failed = true;
+        return false;
+    }
+    fclose(file);
+    file = nullptr;
+
+    error_code ec;
+    bool moved;
+    if (filesystem::exists(rotatedPath, ec)) {
+        // An earlier checkpoint never finished: fold the active records into
+        // the rotated segment so it still covers everything since that snapshot.
+        // The fold replaces the segment atomically and is synced before the
+        // active log is truncated, so acknowledged records are never lost.
+        ifstream rotated(rotatedPath, ios::binary), active(path, ios::binary);
+        string head((istreambuf_iterator<char>(rotated)), istreambuf_iterator<char>());
+        string tail((istreambuf_iterator<char>(active)), istreambuf_iterator<char>());
+        moved = !rotated.bad() && !active.bad() && tail.size() >= WAL_HEADER_BYTES;
+        if (moved) {
+            AtomicFile out(rotatedPath);
+            out.write(head);
+            out.write(string_view(tail).substr(WAL_HEADER_BYTES));
+            moved = out.commit();
+        }
+    } else {
+        filesystem::rename(path, rotatedPath, ec);
+        moved = !ec;
+        // Not durable yet: put the log back so it stays the active one.
+        if (moved && !syncDirectory(path)) {
+            filesystem::rename(rotatedPath, path, ec);
+            moved = false;
+        }
+    }
+    if (!moved) {
+        cerr << "Could not move " << path << " aside; keeping it and skipping the checkpoint.\n";
+        file = fopen(path.c_str(), "ab");
+        if (!file) failed = true;
+        return false;
+    }
+    openActive(last);
+    lsn = last;
+    return true;
+}
+
+void WriteAheadLog::dropRotated() {
+    error_code ec;
+    if (filesystem::remove(rotatedPath, ec)) syncDirectory(rotatedPath);
+}
+
+bool WriteAheadLog::hasRotated() const {
+    error_code ec;
+    return filesystem::exists(rotatedPath, ec);
+}
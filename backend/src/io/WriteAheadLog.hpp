@@ -0,0 +1,82 @@
+#ifndef WRITE_AHEAD_LOG_HPP
+#define WRITE_AHEAD_LOG_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+enum class WalOp : uint8_t {
+    AddUser = 1,           // a = username, b = hash ID
+    RemoveUser = 2,        // a = username
+    AddFriendship = 3,     // a, b = usernames
+    RemoveFriendship = 4,  // a, b = usernames
+    Clear = 5
+};
+
+struct WalRecord {
+    uint64_t lsn;
+    WalOp op;
+    string a, b;
+};
+
+// Append-only mutation log. Records are buffered in memory and reach disk on
+// commit(), which issues a single fsync for everything appended since the
+// previous commit (group commit). Each record carries its own checksum, so a
+// torn write at the tail is detected and cut off on recovery.
+//
+// Checkpointing moves the active log aside (rotate()), writes a snapshot of
+// the graph as of rotate()'s LSN, then deletes the rotated segment
+// (dropRotated()). Recovery replays the rotated segment, if a checkpoint was
+// interrupted, followed by the active log.
+//
+// File layout: 24-byte header (magic "SGWAL", version, base LSN), then records
+//   uint32 payloadLen, uint32 checksum,
+//   payload = uint64 lsn, uint8 op, uint16 len + bytes (a), uint16 len + bytes (b)
+// so a and b may be at most MAX_USERNAME_BYTES long (see Utils.hpp).
+class WriteAheadLog {
+private:
+    string path;
+    string rotatedPath;
+    FILE* file = nullptr;
+    string buffer;              // appended but not yet written
+    uint64_t last = 0;          // last assigned LSN
+    size_t fileBytes = 0;       // bytes in the active segment incl. buffer
+    bool failed = false;        // a write failed; nothing later is durable
+
+    void openActive(uint64_t baseLsn);
+    bool flushBuffer();
+
+public:
+    explicit WriteAheadLog(const string& logPath);
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Replays every record with lsn > afterLsn (rotated segment first), then
+    // opens the active log for appending. Returns the number of records applied.
+    size_t recover(uint64_t afterLsn, const function<void(const WalRecord&)>& apply);
+
+    // Returns the record's LSN, or 0 (nothing logged) if a or b is too long
+    // for the record format.
+    uint64_t append(WalOp op, const string& a, const string& b = "");
+    // False if any record appended so far is not on disk: a write, flush or
+    // fsync failed, or the log could not be opened. Once false, always false.
+    bool commit();
+
+    // Commits, moves the active log aside and starts a new one, setting lsn
+    // to the LSN that a snapshot taken now must record. False if the log
+    // could not be moved aside durably; the active log is then kept as is
+    // and the checkpoint must be skipped.
+    bool rotate(uint64_t& lsn);
+    void dropRotated();
+    bool hasRotated() const;
+
+    uint64_t lastLsn() const { return last; }
+    size_t size() const { return fileBytes; }
+    bool pending() const { return !buffer.empty(); }
+};
+
+#endif
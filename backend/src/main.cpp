@@ -1,5 +1,7 @@
 #include <bits/stdc++.h>
 #include "graph/Graph.hpp"
+#include "cli/Commands.hpp"
+#include "cli/Server.hpp"
 using namespace std;
 
 int main(int argc, char* argv[]) {
@@ -14,6 +16,10 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Shard processes and the cluster coordinator never load the whole graph.
+    if (argc >= 2 && (string(argv[1]) == "--shard" || string(argv[1]) == "--cluster"))
+        return runClusterMode(argv[0], vector<string>(argv + 1, argv + argc));
+
     Graph g(silentMode);
 
     // g.loadwithhashes();   // ensure graph loads from dataset/users.csv or users_demo.csv
@@ -23,109 +29,14 @@ int main(int argc, char* argv[]) {
     // ─────────────────────────────────────────────────────────────
     if (argc >= 2) {
         string cmd = argv[1];
-        
-        if(cmd == "--search" && argc >= 3) {
-            string prefix = argv[2];
-            auto results = g.searchPrefix(prefix);
-            for(size_t i=0;i<results.size();++i) {
-                cout << results[i];
-                if(i + 1 < results.size()) std::cout << ",";
-            }
-            cout << endl;
-            return 0;
-        }
-        
-        if (cmd == "--add" && argc == 3) {
-            string user = argv[2];
-            cout << (g.addUser(user) ? "Added user: " + user
-                                     : "User already exists.") << endl;
-            g.save();
-            return 0;
-        }
 
-        if (cmd == "--remove" && argc == 3) {
-            string user = argv[2];
-            cout << (g.removeUser(user) ? "Removed user: " + user
-                                        : "User not found.") << endl;
-            g.save();
-            return 0;
-        }
-
-        if (cmd == "--addFriend" && argc == 4) {
-            string u1 = argv[2], u2 = argv[3];
-            cout << (g.addFriendship(u1, u2)
-                     ? "Friendship added between " + u1 + " and " + u2
-                     : "Error adding friendship.") << endl;
-            g.save();
-            return 0;
-        }
+        if (cmd == "--serve") return serve(g) ? 0 : 1;
 
-        if (cmd == "--removeFriend" && argc == 4) {
-            string u1 = argv[2], u2 = argv[3];
-            cout << (g.removeFriendship(u1, u2)
-                     ? "Friendship removed between " + u1 + " and " + u2
-                     : "Error removing friendship.") << endl;
-            g.save();
-            return 0;
-        }
-
-        if (cmd == "--friends" && argc == 3) {
-            string uname = argv[2];
-            auto friends = g.getFriends(uname);
-            if (friends.empty()) cout << "No friends or user not found.\n";
-            else {
-                cout << "Friends of " << uname << ": ";
-                for (auto &f : friends) cout << f << " ";
-                cout << endl;
-            }
-            return 0;
-        }
-
-        if (cmd == "--mutual" && argc == 4) {
-            string u1 = argv[2], u2 = argv[3];
-            auto mutual = g.getMutualFriends(u1, u2);
-            if (mutual.empty()) cout << "No mutual friends.\n";
-            else {
-                cout << "Mutual friends of " << u1 << " & " << u2 << ": ";
-                for (auto &f : mutual) cout << f << " ";
-                cout << endl;
-            }
-            return 0;
+        runCommand(g, vector<string>(argv + 1, argv + argc));
+        if (!g.save()) {
+            cerr << "Changes could not be saved.\n";
+            return 1;
         }
-
-        if (cmd == "--connection" && argc == 4) {
-            string u1 = argv[2], u2 = argv[3];
-            cout << (g.areConnected(u1, u2)
-                     ? "Connected: Yes"
-                     : "Connected: No") << endl;
-            return 0;
-        }
-
-        if (cmd == "--pagerank") {
-            g.computePageRank();
-            g.displayPageRank();
-            return 0;
-        }
-
-        if (cmd == "--recommend" && argc == 3) {
-            string uname = argv[2];
-            g.recommendFriends(uname, 3);
-            return 0;
-        }
-
-        if (cmd == "--clear") {
-            g.clear();
-            g.save();
-            cout << "Graph cleared.\n";
-            return 0;
-        }
-
-        if (cmd == "--exit") {
-            cout << "Exiting...\n";
-            return 0;
-        }
-
-        cout << "Unknown command.\n";
         return 0;
     }
 
@@ -232,12 +143,16 @@ int main(int argc, char* argv[]) {
 
             case 0:
                 cout << "Saving data before exit...\n";
-                g.save();
+                if (!g.save()) {
+                    cerr << "Changes could not be saved.\n";
+                    return 1;
+                }
                 cout << "Exiting...\n";
                 return 0;
 
             default:
                 cout << "Invalid choice.\n";
         }
+        if (!g.save()) cerr << "Changes could not be saved.\n";
     }
 }
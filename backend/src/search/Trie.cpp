@@ -1,37 +1,206 @@
 #include "Trie.hpp"
 #include <algorithm>
 
-Trie::Trie() : root(new Node()) {}
-Trie::~Trie() { /* optional: free nodes */ }
-
-void Trie::insert(const std::string& word) {
-    Node* cur = root;
-    for(char c : word) {
-        if(!cur->next[c]) cur->next[c] = new Node();
-        cur = cur->next[c];
+Trie::Trie() { clear(); }
+
+void Trie::clear() {
+    nodes.assign(1, Node());
+    top.assign(TOP_K, Ranked());
+    freeNodes.clear();
+    words = 0;
+}
+
+// =================== NODE POOL ===================
+
+// Siblings are kept sorted by label, so a miss can stop early.
+uint32_t Trie::child(uint32_t n, char c) const {
+    for (uint32_t k = nodes[n].firstChild; k != NONE; k = nodes[k].nextSibling) {
+        if (nodes[k].label == c) return k;
+        if ((unsigned char)nodes[k].label > (unsigned char)c) break;
+    }
+    return NONE;
+}
+
+uint32_t Trie::addChild(uint32_t n, char c) {
+    uint32_t k;
+    if (!freeNodes.empty()) {
+        k = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[k] = Node();
+    } else {
+        k = nodes.size();
+        nodes.emplace_back();
+        top.resize(top.size() + TOP_K);
+    }
+    nodes[k].parent = n;
+    nodes[k].label = c;
+
+    uint32_t* link = &nodes[n].firstChild;
+    while (*link != NONE && (unsigned char)nodes[*link].label < (unsigned char)c)
+        link = &nodes[*link].nextSibling;
+    nodes[k].nextSibling = *link;
+    *link = k;
+    return k;
+}
+
+void Trie::unlink(uint32_t n) {
+    uint32_t* link = &nodes[nodes[n].parent].firstChild;
+    while (*link != n) link = &nodes[*link].nextSibling;
+    *link = nodes[n].nextSibling;
+    freeNodes.push_back(n);
+}
+
+// Returns the node spelling `word` (NONE if absent); `path` gets root..node.
+uint32_t Trie::findPath(std::string_view word, std::vector<uint32_t>* path) const {
+    uint32_t n = 0;
+    if (path) path->assign(1, 0);
+    for (char c : word) {
+        n = child(n, c);
+        if (n == NONE) return NONE;
+        if (path) path->push_back(n);
     }
-    cur->isEnd = true;
+    return n;
+}
+
+std::string Trie::wordAt(uint32_t n) const {
+    std::string word;
+    for (; n != 0; n = nodes[n].parent) word.push_back(nodes[n].label);
+    std::reverse(word.begin(), word.end());
+    return word;
 }
 
-void Trie::dfs(Node* node, std::string& cur, std::vector<std::string>& out) const {
-    if(out.size() >= 10) return;
-    if(node->isEnd) out.push_back(cur);
-    for(auto& [ch, nxt] : node->next) {
-        cur.push_back(ch);
-        dfs(nxt, cur, out);
-        cur.pop_back();
+// =================== RANKED LISTS ===================
+
+bool Trie::listed(uint32_t n, uint32_t terminal) const {
+    const Ranked* list = ranked(n);
+    for (int i = 0; i < nodes[n].topCount; ++i)
+        if (list[i].node == terminal) return true;
+    return false;
+}
+
+// Inserts or moves `entry` in n's list; the weakest entry drops off when full.
+void Trie::offer(uint32_t n, const Ranked& entry) {
+    Ranked* list = ranked(n);
+    int count = nodes[n].topCount;
+    for (int i = 0; i < count; ++i) {
+        if (list[i].node == entry.node) {
+            std::copy(list + i + 1, list + count, list + i);
+            --count;
+            break;
+        }
     }
+    int pos = std::lower_bound(list, list + count, entry, better) - list;
+    if (pos >= TOP_K) return;
+    if (count < TOP_K) ++count;
+    std::copy_backward(list + pos, list + count - 1, list + count);
+    list[pos] = entry;
+    nodes[n].topCount = count;
 }
 
-std::vector<std::string> Trie::prefixSearch(const std::string& prefix, int limit) const {
-    Node* cur = root;
-    for(char c : prefix) {
-        if(!cur->next.count(c)) return {};
-        cur = cur->next[c];
+// Rebuilds n's list from its own word and its children's lists. Only valid
+// once the children are up to date, so callers go bottom-up.
+void Trie::recompute(uint32_t n) {
+    scratch.clear();
+    if (nodes[n].id != NONE) scratch.push_back({n, nodes[n].id, nodes[n].score});
+    for (uint32_t k = nodes[n].firstChild; k != NONE; k = nodes[k].nextSibling)
+        scratch.insert(scratch.end(), ranked(k), ranked(k) + nodes[k].topCount);
+
+    size_t keep = std::min<size_t>(scratch.size(), TOP_K);
+    std::partial_sort(scratch.begin(), scratch.begin() + keep, scratch.end(), better);
+    std::copy(scratch.begin(), scratch.begin() + keep, ranked(n));
+    nodes[n].topCount = keep;
+}
+
+// =================== UPDATES ===================
+
+// Creates the path for `word` and marks its end; NONE if it already exists.
+uint32_t Trie::addWord(std::string_view word, uint32_t id, float score, std::vector<uint32_t>* path) {
+    uint32_t n = 0;
+    if (path) path->assign(1, 0);
+    for (char c : word) {
+        uint32_t k = child(n, c);
+        n = k == NONE ? addChild(n, c) : k;
+        if (path) path->push_back(n);
     }
+    if (nodes[n].id != NONE) return NONE;
+
+    nodes[n].id = id;
+    nodes[n].score = score;
+    words++;
+    return n;
+}
+
+bool Trie::insert(std::string_view word, uint32_t id, float score) {
+    std::vector<uint32_t> path;
+    uint32_t n = addWord(word, id, score, &path);
+    if (n == NONE) return false;
+    for (uint32_t p : path) offer(p, {n, id, score});
+    return true;
+}
+
+bool Trie::insertUnranked(std::string_view word, uint32_t id, float score) {
+    return addWord(word, id, score, nullptr) != NONE;
+}
+
+void Trie::rerank() {
+    // Breadth-first order puts every parent before its children.
+    std::vector<uint32_t> order{0};
+    for (size_t i = 0; i < order.size(); ++i)
+        for (uint32_t k = nodes[order[i]].firstChild; k != NONE; k = nodes[k].nextSibling)
+            order.push_back(k);
+    for (auto it = order.rbegin(); it != order.rend(); ++it) recompute(*it);
+}
+
+bool Trie::erase(std::string_view word) {
+    std::vector<uint32_t> path;
+    uint32_t n = findPath(word, &path);
+    if (n == NONE || nodes[n].id == NONE) return false;
+
+    nodes[n].id = NONE;
+    words--;
+
+    // Drop the now-empty tail of the path, then repair the lists above it.
+    while (path.size() > 1) {
+        uint32_t k = path.back();
+        if (nodes[k].id != NONE || nodes[k].firstChild != NONE) break;
+        unlink(k);
+        path.pop_back();
+    }
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+        if (listed(*it, n)) recompute(*it);
+    return true;
+}
+
+bool Trie::setScore(std::string_view word, float score) {
+    std::vector<uint32_t> path;
+    uint32_t n = findPath(word, &path);
+    if (n == NONE || nodes[n].id == NONE) return false;
+
+    float old = nodes[n].score;
+    if (score == old) return true;
+    nodes[n].score = score;
+
+    if (score > old) {
+        // A rise can only move the word up, or into lists it wasn't in.
+        for (uint32_t p : path) offer(p, {n, nodes[n].id, score});
+    } else {
+        // A drop may let a word that was cut off take its place.
+        for (auto it = path.rbegin(); it != path.rend(); ++it)
+            if (listed(*it, n)) recompute(*it);
+    }
+    return true;
+}
+
+// =================== QUERY ===================
+
+std::vector<std::string> Trie::prefixSearch(std::string_view prefix, int limit) const {
     std::vector<std::string> res;
-    std::string tmp = prefix;
-    dfs(cur, tmp, res);
-    if((int)res.size() > limit) res.resize(limit);
+    uint32_t n = findPath(prefix, nullptr);
+    if (n == NONE) return res;
+
+    int count = std::min<int>(nodes[n].topCount, limit);
+    const Ranked* list = ranked(n);
+    for (int i = 0; i < count; ++i)
+        res.push_back(wordAt(list[i].node));
     return res;
 }
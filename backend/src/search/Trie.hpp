@@ -1,21 +1,78 @@
 #pragma once
-#include <unordered_map>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Prefix index over usernames for autocomplete.
+//
+// Nodes live in one pool and refer to each other by index: children form a
+// sibling list sorted by character, and every node has a parent link so a word
+// can be read back from its terminal node. Each node also keeps the TOP_K
+// highest-scoring words below it, so a query is a walk down the prefix plus a
+// copy of that node's list. Inserts, erases and score changes update only the
+// lists on the word's own path; freed nodes are recycled.
 class Trie {
+public:
+    static constexpr int TOP_K = 10;
+
+    Trie();
+    void clear();
+
+    // `id` breaks score ties (lower first). Returns false if the word exists.
+    bool insert(std::string_view word, uint32_t id, float score = 0);
+    bool erase(std::string_view word);
+    bool setScore(std::string_view word, float score);
+
+    // Bulk loading: add words with insertUnranked(), then rank them all in
+    // one bottom-up pass with rerank().
+    bool insertUnranked(std::string_view word, uint32_t id, float score = 0);
+    void rerank();
+
+    // Highest-scoring words starting with `prefix`, best first.
+    std::vector<std::string> prefixSearch(std::string_view prefix, int limit = TOP_K) const;
+
+    size_t size() const { return words; }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
     struct Node {
-        bool isEnd = false;
-        std::unordered_map<char, Node*> next;
+        uint32_t parent = NONE;
+        uint32_t firstChild = NONE;
+        uint32_t nextSibling = NONE;
+        uint32_t id = NONE;          // NONE unless a word ends here
+        float score = 0;
+        uint8_t topCount = 0;
+        char label = 0;
     };
-    Node* root;
 
-    void dfs(Node* node, std::string& cur, std::vector<std::string>& out) const;
+    struct Ranked {
+        uint32_t node;               // terminal node of the word
+        uint32_t id;
+        float score;
+    };
 
-public:
-    Trie();
-    ~Trie();
-    void insert(const std::string& word);
-    std::vector<std::string> prefixSearch(const std::string& prefix, int limit = 10) const;
-};
+    std::vector<Node> nodes;         // nodes[0] is the root
+    std::vector<Ranked> top;         // TOP_K slots per node
+    std::vector<uint32_t> freeNodes;
+    std::vector<Ranked> scratch;
+    size_t words = 0;
+
+    static bool better(const Ranked& a, const Ranked& b) {
+        return a.score != b.score ? a.score > b.score : a.id < b.id;
+    }
 
+    Ranked* ranked(uint32_t n) { return &top[(size_t)n * TOP_K]; }
+    const Ranked* ranked(uint32_t n) const { return &top[(size_t)n * TOP_K]; }
+
+    uint32_t child(uint32_t n, char c) const;
+    uint32_t addChild(uint32_t n, char c);
+    void unlink(uint32_t n);
+    uint32_t addWord(std::string_view word, uint32_t id, float score, std::vector<uint32_t>* path);
+    uint32_t findPath(std::string_view word, std::vector<uint32_t>* path) const;
+    bool listed(uint32_t n, uint32_t terminal) const;
+    void offer(uint32_t n, const Ranked& entry);
+    void recompute(uint32_t n);
+    std::string wordAt(uint32_t n) const;
+};
@@ -0,0 +1,174 @@
+#include "Metrics.hpp"
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+#if SOCIAL_GRAPH_METRICS
+struct CounterInfo {
+    const char* name;
+    const char* labels;
+    const char* help;
+};
+
+struct HistogramInfo {
+    const char* name;
+    const char* labels;
+    const char* help;
+    bool seconds;    // recorded in microseconds, exported in seconds
+};
+
+// Indexed by Counter / Histogram. Entries of one family (same name) are kept
+// adjacent so HELP/TYPE are written once.
+const CounterInfo COUNTERS[] = {
+    {"social_graph_csv_rows_total", "", "Rows read from users.csv."},
+    {"social_graph_csv_malformed_rows_total", "", "users.csv rows skipped for a missing ID or username."},
+    {"social_graph_csv_saved_bytes_total", "", "Bytes written to users.csv."},
+    {"social_graph_pagerank_iterations_total", "", "Full power-iteration sweeps."},
+    {"social_graph_pagerank_pushes_total", "", "Vertices updated by incremental residual pushes."},
+    {"social_graph_recommend_cache_lookups_total", "result=\"hit\"", "Recommendation cache lookups."},
+    {"social_graph_recommend_cache_lookups_total", "result=\"miss\"", "Recommendation cache lookups."},
+    {"social_graph_user_id_collisions_total", "", "Generated user IDs that were taken and rehashed."},
+    {"social_graph_walk_steps_total", "source=\"sampled\"", "Random-walk steps for personalized PageRank."},
+    {"social_graph_walk_steps_total", "source=\"segment\"", "Random-walk steps for personalized PageRank."},
+};
+
+const HistogramInfo HISTOGRAMS[] = {
+    {"social_graph_csv_load_seconds", "", "Loading users.csv into the graph.", true},
+    {"social_graph_csv_save_seconds", "", "Writing users.csv.", true},
+    {"social_graph_snapshot_load_seconds", "", "Loading the binary snapshot.", true},
+    {"social_graph_snapshot_save_seconds", "", "Writing the binary snapshot.", true},
+    {"social_graph_wal_commit_seconds", "", "Write-ahead log group commits (write + fsync).", true},
+    {"social_graph_mutation_seconds", "op=\"add_user\"", "Logged graph mutations, index upkeep included.", true},
+    {"social_graph_mutation_seconds", "op=\"remove_user\"", "Logged graph mutations, index upkeep included.", true},
+    {"social_graph_mutation_seconds", "op=\"add_friendship\"", "Logged graph mutations, index upkeep included.", true},
+    {"social_graph_mutation_seconds", "op=\"remove_friendship\"", "Logged graph mutations, index upkeep included.", true},
+    {"social_graph_batch_apply_seconds", "", "One mutation batch (--batch), index upkeep included.", true},
+    {"social_graph_pagerank_iteration_seconds", "", "One PageRank power-iteration sweep.", true},
+    {"social_graph_pagerank_push_seconds", "", "Incremental PageRank refreshes.", true},
+    {"social_graph_recommend_seconds", "", "Candidate generation and scoring for one user.", true},
+    {"social_graph_recommend_candidates", "", "Friends-of-friends scored per recommendation.", false},
+    {"social_graph_similar_seconds", "", "MinHash/LSH similar-user lookups.", true},
+    {"social_graph_similar_candidates", "", "Colliding users scored per similar-user lookup.", false},
+    {"social_graph_search_seconds", "", "Prefix searches.", true},
+    {"social_graph_serve_request_seconds", "path=\"reader\"", "Daemon requests, by the thread that ran them.", true},
+    {"social_graph_serve_request_seconds", "path=\"writer\"", "Daemon requests, by the thread that ran them.", true},
+};
+
+static_assert(size(COUNTERS) == (size_t)Counter::Count);
+static_assert(size(HISTOGRAMS) == (size_t)Histogram::Count);
+
+string number(double value) {
+    char buf[32];
+    snprintf(buf, sizeof buf, "%.9g", value);
+    return buf;
+}
+
+// name{labels,extra} with the braces dropped when both are empty.
+string series(const string& name, const char* labels, const string& extra = "") {
+    string inner = labels;
+    if (!extra.empty()) inner += (inner.empty() ? "" : ",") + extra;
+    return inner.empty() ? name : name + "{" + inner + "}";
+}
+#endif
+
+// Plain totals, used to add up shards.
+struct Totals {
+    uint64_t counters[(size_t)Counter::Count] = {};
+    uint64_t counts[(size_t)Histogram::Count][METRIC_BUCKETS] = {};
+    uint64_t sums[(size_t)Histogram::Count] = {};
+
+    void add(const MetricShard& s) {
+        for (size_t c = 0; c < (size_t)Counter::Count; ++c)
+            counters[c] += s.counters[c].load(memory_order_relaxed);
+        for (size_t h = 0; h < (size_t)Histogram::Count; ++h) {
+            for (size_t b = 0; b < METRIC_BUCKETS; ++b)
+                counts[h][b] += s.histograms[h].counts[b].load(memory_order_relaxed);
+            sums[h] += s.histograms[h].sum.load(memory_order_relaxed);
+        }
+    }
+};
+
+struct Registry {
+    mutex m;
+    vector<MetricShard*> live;
+    Totals retired;   // shards of threads that have exited
+};
+
+// Never destroyed, so threads exiting during static destruction can still
+// hand their shard in.
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+struct ShardOwner {
+    MetricShard shard;
+
+    ShardOwner() {
+        Registry& r = registry();
+        lock_guard<mutex> lock(r.m);
+        r.live.push_back(&shard);
+    }
+    ~ShardOwner() {
+        Registry& r = registry();
+        lock_guard<mutex> lock(r.m);
+        r.retired.add(shard);
+        erase(r.live, &shard);
+    }
+};
+
+} // namespace
+
+MetricShard& metricShard() {
+    thread_local ShardOwner owner;
+    return owner.shard;
+}
+
+void writeMetrics(ostream& out) {
+#if !SOCIAL_GRAPH_METRICS
+    out << "# metrics disabled (built with METRICS=0)\n";
+#else
+    Totals t;
+    {
+        Registry& r = registry();
+        lock_guard<mutex> lock(r.m);
+        t = r.retired;
+        for (MetricShard* s : r.live) t.add(*s);
+    }
+
+    const char* family = "";
+    for (size_t c = 0; c < (size_t)Counter::Count; ++c) {
+        const CounterInfo& info = COUNTERS[c];
+        if (string(info.name) != family) {
+            out << "# HELP " << info.name << " " << info.help << "\n";
+            out << "# TYPE " << info.name << " counter\n";
+            family = info.name;
+        }
+        out << series(info.name, info.labels) << " " << t.counters[c] << "\n";
+    }
+
+    for (size_t h = 0; h < (size_t)Histogram::Count; ++h) {
+        const HistogramInfo& info = HISTOGRAMS[h];
+        if (string(info.name) != family) {
+            out << "# HELP " << info.name << " " << info.help << "\n";
+            out << "# TYPE " << info.name << " histogram\n";
+            family = info.name;
+        }
+        double scale = info.seconds ? 1e-6 : 1.0;
+        string name = info.name;
+        uint64_t cumulative = 0, bound = 1;
+        for (size_t b = 0; b < METRIC_BUCKETS; ++b, bound *= 4) {
+            cumulative += t.counts[h][b];
+            string le = b + 1 < METRIC_BUCKETS ? number(bound * scale) : "+Inf";
+            out << series(name + "_bucket", info.labels, "le=\"" + le + "\"") << " " << cumulative << "\n";
+        }
+        out << series(name + "_sum", info.labels) << " " << number(t.sums[h] * scale) << "\n";
+        out << series(name + "_count", info.labels) << " " << cumulative << "\n";
+    }
+#endif
+}
@@ -0,0 +1,131 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+using namespace std;
+
+// Built in unless compiled with -DSOCIAL_GRAPH_METRICS=0 (make METRICS=0), in
+// which case the METRIC_* macros below expand to nothing.
+#ifndef SOCIAL_GRAPH_METRICS
+#define SOCIAL_GRAPH_METRICS 1
+#endif
+
+// Process-wide counters and histograms for the hot paths.
+//
+// Metrics are fixed at compile time (the enums below), so recording one is an
+// array index, not a lookup. Every thread records into its own shard with
+// plain relaxed load/store pairs (no locked instructions, no shared cache
+// lines); writeMetrics() sums the live shards plus whatever exited threads
+// left behind. Histograms use power-of-4 buckets: timings in microseconds
+// from 1us to ~4s, counts from 1 to ~4M.
+enum class Counter : uint16_t {
+    CsvRowsLoaded,
+    CsvRowsMalformed,
+    CsvBytesSaved,
+    PageRankIterations,
+    PageRankPushes,
+    RecommendCacheHits,
+    RecommendCacheMisses,
+    UserIdCollisions,
+    WalkSampledSteps,
+    WalkStitchedSteps,
+    Count
+};
+
+enum class Histogram : uint16_t {
+    CsvLoadSeconds,
+    CsvSaveSeconds,
+    SnapshotLoadSeconds,
+    SnapshotSaveSeconds,
+    WalCommitSeconds,
+    AddUserSeconds,
+    RemoveUserSeconds,
+    AddFriendshipSeconds,
+    RemoveFriendshipSeconds,
+    BatchApplySeconds,
+    PageRankIterationSeconds,
+    PageRankPushSeconds,
+    RecommendSeconds,
+    RecommendCandidates,
+    SimilarSeconds,
+    SimilarCandidates,
+    SearchSeconds,
+    ServeReadSeconds,
+    ServeWriteSeconds,
+    Count
+};
+
+constexpr size_t METRIC_BUCKETS = 13;   // 4^0 .. 4^11, then +Inf
+
+struct MetricShard {
+    struct Buckets {
+        atomic<uint64_t> counts[METRIC_BUCKETS];
+        atomic<uint64_t> sum;
+    };
+    atomic<uint64_t> counters[(size_t)Counter::Count];
+    Buckets histograms[(size_t)Histogram::Count];
+};
+
+// The calling thread's shard (registered on first use).
+MetricShard& metricShard();
+
+// Only the owning thread writes a shard, so a non-atomic increment suffices;
+// the atomics just make concurrent reads by writeMetrics() well-defined.
+inline void metricBump(atomic<uint64_t>& slot, uint64_t n) {
+    slot.store(slot.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+inline size_t metricBucket(uint64_t value) {
+    size_t b = value <= 1 ? 0 : (bit_width(value - 1) + 1) / 2;
+    return b < METRIC_BUCKETS - 1 ? b : METRIC_BUCKETS - 1;
+}
+
+inline void metricAdd(Counter c, uint64_t n) {
+    metricBump(metricShard().counters[(size_t)c], n);
+}
+
+inline void metricObserve(Histogram h, uint64_t value) {
+    auto& hist = metricShard().histograms[(size_t)h];
+    metricBump(hist.counts[metricBucket(value)], 1);
+    metricBump(hist.sum, value);
+}
+
+// Records the lifetime of the enclosing scope, in microseconds.
+class MetricTimer {
+private:
+    Histogram hist;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit MetricTimer(Histogram h) : hist(h), start(chrono::steady_clock::now()) {}
+    ~MetricTimer() {
+        auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+        metricObserve(hist, us.count());
+    }
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+};
+
+#define METRIC_CONCAT_(a, b) a##b
+#define METRIC_CONCAT(a, b) METRIC_CONCAT_(a, b)
+
+#if SOCIAL_GRAPH_METRICS
+#define METRIC_ADD(counter, n) metricAdd(Counter::counter, (n))
+#define METRIC_OBSERVE(hist, value) metricObserve(Histogram::hist, (value))
+#define METRIC_TIMER(hist) MetricTimer METRIC_CONCAT(metricTimer, __LINE__)(Histogram::hist)
+#else
+#define METRIC_ADD(counter, n) ((void)0)
+#define METRIC_OBSERVE(hist, value) ((void)0)
+#define METRIC_TIMER(hist) ((void)0)
+#endif
+
+// Prometheus text exposition format (version 0.0.4).
+void writeMetrics(ostream& out);
+
+#endif
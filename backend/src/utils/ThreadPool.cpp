@@ -0,0 +1,75 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    for (size_t i = 1; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(m);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void ThreadPool::drain(size_t worker) {
+    for (;;) {
+        size_t begin = nextChunk.fetch_add(jobGrain, memory_order_relaxed);
+        if (begin >= jobSize) break;
+        (*job)(worker, begin, min(begin + jobGrain, jobSize));
+    }
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    size_t seen = 0;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(m);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (index >= jobWorkers) continue;
+        }
+        drain(index);
+        {
+            lock_guard<mutex> lock(m);
+            if (--running == 0) done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, size_t grain, const RangeFn& fn, size_t maxWorkers) {
+    if (n == 0) return;
+    grain = max<size_t>(grain, 1);
+    size_t use = maxWorkers == 0 ? size() : min(maxWorkers, size());
+    use = min(use, (n + grain - 1) / grain);
+
+    if (use <= 1) {
+        for (size_t b = 0; b < n; b += grain) fn(0, b, min(b + grain, n));
+        return;
+    }
+
+    lock_guard<mutex> submit(submitMutex);
+    {
+        lock_guard<mutex> lock(m);
+        job = &fn;
+        jobSize = n;
+        jobGrain = grain;
+        jobWorkers = use;
+        nextChunk.store(0, memory_order_relaxed);
+        running = use - 1;
+        ++generation;
+    }
+    wake.notify_all();
+    drain(0);
+
+    unique_lock<mutex> lock(m);
+    done.wait(lock, [&] { return running == 0; });
+    job = nullptr;
+}
@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of worker threads for data-parallel loops. The calling thread
+// takes part as worker 0, so a pool of size 1 runs everything inline.
+class ThreadPool {
+public:
+    using RangeFn = function<void(size_t worker, size_t begin, size_t end)>;
+
+    explicit ThreadPool(size_t threads = 0);   // 0 = hardware concurrency
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Splits [0, n) into chunks of `grain` and hands them out dynamically to at
+    // most `maxWorkers` threads (0 = all). Blocks until every chunk is done.
+    // fn receives the worker index (< size()) so it can use per-thread scratch.
+    void parallelFor(size_t n, size_t grain, const RangeFn& fn, size_t maxWorkers = 0);
+
+private:
+    vector<thread> workers;
+    mutex submitMutex;          // one parallelFor at a time
+
+    mutex m;
+    condition_variable wake, done;
+    const RangeFn* job = nullptr;
+    size_t jobSize = 0, jobGrain = 1, jobWorkers = 0;
+    atomic<size_t> nextChunk{0};
+    size_t generation = 0;
+    size_t running = 0;
+    bool stopping = false;
+
+    void workerLoop(size_t index);
+    void drain(size_t worker);
+};
+
+#endif
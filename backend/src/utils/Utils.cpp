@@ -1,10 +1,34 @@
-#include "utils.hpp"
+#include "Utils.hpp"
+#include <charconv>
+#include <cstring>
 
-string generateHashId(const string& username) {
-    hash<string> hasher;
-    size_t hashValue = hasher(username);
+uint64_t userIdHash(string_view username, uint32_t attempt) {
+    uint64_t h = 0xcbf29ce484222325ull ^ (attempt * 0x9E3779B97F4A7C15ull);
+    for (unsigned char c : username) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    // FNV-1a alone leaves the high bits weak for short keys.
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+string_view formatUserId(uint64_t value, char (&buf)[USER_ID_CHARS]) {
+    char digits[USER_ID_CHARS];
+    auto res = to_chars(digits, digits + USER_ID_CHARS, value, 16);
+    size_t len = res.ptr - digits;
+    memset(buf, '0', USER_ID_CHARS - len);
+    memcpy(buf + USER_ID_CHARS - len, digits, len);
+    return string_view(buf, USER_ID_CHARS);
+}
 
-    stringstream ss;
-    ss << hex << setw(6) << setfill('0') << (hashValue & 0xFFFFFF); // 24-bit short hash
-    return ss.str();
+bool isLegacyUserId(string_view id) {
+    if (id.size() != USER_ID_CHARS) return true;
+    for (char c : id)
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return true;
+    return false;
 }
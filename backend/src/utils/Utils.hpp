@@ -1,14 +1,32 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
-#include <string>
-#include <functional>
-#include <sstream>
-#include <iomanip>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 using namespace std;
 
-// Generates a deterministic 6-character hexadecimal hash ID for a username.
-string generateHashId(const string& username);
+// =================== USER IDS ===================
+// IDs are 16 lowercase hex digits of a 64-bit hash of the username. The hash
+// is spelled out here (FNV-1a plus a final mix) rather than taken from
+// std::hash so IDs stay the same across compilers and builds. The older
+// 6-digit IDs still load; --migrate-ids rewrites them.
+
+constexpr size_t USER_ID_CHARS = 16;
+
+// Longest username accepted anywhere: the write-ahead log stores names with
+// a 16-bit length.
+constexpr size_t MAX_USERNAME_BYTES = UINT16_MAX;
+
+// Hash of `username` for the given attempt; a collision retries with the
+// next attempt, so the first free ID is deterministic for a given graph.
+uint64_t userIdHash(string_view username, uint32_t attempt = 0);
+
+// Formats `value` into `buf` without allocating; the view points into `buf`.
+string_view formatUserId(uint64_t value, char (&buf)[USER_ID_CHARS]);
+
+// True for IDs written before 64-bit IDs (anything not 16 hex digits).
+bool isLegacyUserId(string_view id);
 
 #endif
@@ -0,0 +1,183 @@
+// --cluster against --serve on the same graph.
+//
+//   cluster_test.exe --dir DIR [--queries Q] [--seed S] [--app PATH]
+//
+// DIR must contain dataset/users.csv (see GraphGen.cpp). The same request
+// stream (friends, mutual friends, connectivity, every cluster score
+// function, PageRank, unknown users) is answered once by serve() on the
+// loaded graph and then by serveCluster() in front of several partitions,
+// and every response must match byte for byte (PageRank's timing aside).
+// Then one shard of a running cluster is killed: from there on every
+// response must be either the right answer or a "Cluster error", never
+// another request's answer. Shards are started from PATH, by default the
+// app built next to this binary. Prints one line per check and exits
+// non-zero if any failed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "graph/Graph.hpp"
+#include "cli/Commands.hpp"
+#include "cli/Server.hpp"
+#include "cluster/Coordinator.hpp"
+
+#ifndef _WIN32
+#include <csignal>
+#endif
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    printf("%s %s\n", ok ? "PASS" : "FAIL", what.c_str());
+    fflush(stdout);
+    if (!ok) failures++;
+}
+
+// Splits a response stream into its payloads; PageRank's run time is masked.
+static vector<string> responses(const string& stream) {
+    static const regex millis(", [0-9.]+ ms\\)");
+    vector<string> out;
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        size_t nl = stream.find('\n', pos);
+        if (nl == string::npos) break;
+        size_t len = strtoull(stream.c_str() + pos, nullptr, 10);
+        out.push_back(regex_replace(stream.substr(nl + 1, len), millis, ", - ms)"));
+        pos = nl + 1 + len;
+    }
+    return out;
+}
+
+// Compares response by response and reports the first difference.
+static void compare(const vector<string>& requests, const vector<string>& expected, const vector<string>& actual,
+                    const string& what) {
+    size_t n = min(expected.size(), actual.size());
+    for (size_t i = 0; i < n; ++i)
+        if (expected[i] != actual[i]) {
+            check(false, what + ": request " + to_string(i) + " (" + requests[i] + ")\n--- serve:\n" +
+                             expected[i] + "--- cluster:\n" + actual[i]);
+            return;
+        }
+    check(expected.size() == actual.size(),
+          what + ": " + to_string(actual.size()) + " of " + to_string(expected.size()) + " responses match");
+}
+
+static string joinLines(const vector<string>& lines) {
+    string out;
+    for (auto& line : lines) out += line + "\n";
+    return out;
+}
+
+int main(int argc, char** argv) {
+    string dir = ".", app;
+    size_t queries = 200;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--dir" && hasValue) dir = argv[++i];
+        else if (arg == "--queries" && hasValue) queries = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--app" && hasValue) app = argv[++i];
+        else {
+            cerr << "usage: cluster_test.exe --dir DIR [--queries Q] [--seed S] [--app PATH]\n";
+            return 1;
+        }
+    }
+#ifdef _WIN32
+    cerr << "Shard processes are not supported on this platform\n";
+    return 1;
+#else
+    // Resolved before moving into DIR.
+    app = filesystem::absolute(app.empty() ? filesystem::path(argv[0]).parent_path() / "social_graph_app.exe"
+                                           : filesystem::path(app)).string();
+    error_code ec;
+    filesystem::current_path(dir, ec);
+    if (ec || !filesystem::exists("dataset/users.csv")) {
+        cerr << "No dataset/users.csv under " << dir << "\n";
+        return 1;
+    }
+
+    Graph g(true);
+    vector<string> users = g.getUsers();
+    if (users.empty()) {
+        cerr << "Dataset is empty\n";
+        return 1;
+    }
+
+    // Random users and friend-of-friend pairs, as in the benchmarks.
+    mt19937_64 rng(seed);
+    auto pickUser = [&] { return users[uniform_int_distribution<size_t>(0, users.size() - 1)(rng)]; };
+    auto pickFriend = [&](const string& u) {
+        auto friends = g.getFriends(u);
+        return friends.empty() ? pickUser() : friends[uniform_int_distribution<size_t>(0, friends.size() - 1)(rng)];
+    };
+    vector<string> requests = {"--recommend nobody", "--friends nobody", "--connection nobody " + users[0],
+                               "--mutual " + users[0] + " nobody", "--pagerank"};
+    for (size_t i = 0; i < queries; ++i) {
+        string u = pickUser();
+        requests.push_back("--friends " + u);
+        requests.push_back("--mutual " + u + " " + pickFriend(pickFriend(u)));
+        requests.push_back("--mutual " + u + " " + pickUser());
+        requests.push_back("--connection " + u + " " + pickUser());
+        requests.push_back("--recommend " + u + " --k 5");
+        for (const char* score : {"aa", "jaccard", "ra"})
+            requests.push_back("--recommend " + u + " --k 5 --score " + score);
+    }
+    requests.push_back("--exit");
+
+    istringstream serveIn(joinLines(requests));
+    ostringstream serveOut;
+    serve(g, serveIn, serveOut);
+    vector<string> expected = responses(serveOut.str());
+    check(expected.size() == requests.size(), "serve answered all " + to_string(requests.size()) + " requests");
+
+    struct Setup { uint32_t shards; PartitionScheme scheme; };
+    for (Setup setup : {Setup{1, PartitionScheme::Hash}, Setup{3, PartitionScheme::Hash},
+                        Setup{3, PartitionScheme::LabelPropagation}, Setup{5, PartitionScheme::LabelPropagation}}) {
+        string name = to_string(setup.shards) + " " + partitionSchemeName(setup.scheme) + " shards";
+        string partition = "shards-" + to_string(setup.shards) + "-" + partitionSchemeName(setup.scheme);
+        PartitionStats st;
+        ShardCluster cluster;
+        ClusterSession session(cluster);
+        if (!g.partition(setup.shards, setup.scheme, partition, st) || !cluster.start(partition, app, false) ||
+            !session.connect()) {
+            check(false, name + ": cluster started");
+            continue;
+        }
+        istringstream in(joinLines(requests));
+        ostringstream out;
+        serveCluster(cluster, session, in, out);
+        compare(requests, expected, responses(out.str()), name);
+        if (setup.shards != 3 || setup.scheme != PartitionScheme::Hash) continue;
+
+        // Lose the last shard, then replay every request: each answer must
+        // be its own or an error, and the first one that needs that shard
+        // must fail.
+        kill(cluster.shard(setup.shards - 1).pid, SIGKILL);
+        istringstream afterIn(joinLines(requests));
+        ostringstream afterOut;
+        serveCluster(cluster, session, afterIn, afterOut);
+        vector<string> after = responses(afterOut.str());
+        size_t errors = 0, wrong = 0;
+        for (size_t i = 0; i < after.size() && i < expected.size(); ++i) {
+            if (after[i].rfind("Cluster error: ", 0) == 0) errors++;
+            else if (after[i] != expected[i]) wrong++;
+        }
+        check(after.size() == requests.size(), name + " minus one: every request answered");
+        check(wrong == 0, name + " minus one: " + to_string(wrong) + " answers belong to another request");
+        check(errors > 0, name + " minus one: " + to_string(errors) + " requests reported the lost shard");
+    }
+
+    printf("%s\n", failures ? "Cluster test FAILED" : "Cluster test passed");
+    return failures ? 1 : 0;
+#endif
+}
@@ -114,6 +114,10 @@ setupButton("checkConnBtn", async () => {
     `/connection?a=${encodeURIComponent(a)}&b=${encodeURIComponent(b)}`
   ).then((r) => r.json());
   log(`🔍 ${res.output}`);
+  const path = await fetch(
+    `/path?a=${encodeURIComponent(a)}&b=${encodeURIComponent(b)}`
+  ).then((r) => r.json());
+  log(`🧭 ${path.output}`);
 });
 
 setupButton("recommendBtn", async () => {
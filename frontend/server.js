@@ -1,17 +1,12 @@
 // server.js
 import express from 'express';
-import fs from 'fs';
-import { execFile } from 'child_process';
+import { spawn } from 'child_process';
 import path from 'path';
 
 const app = express();
 const PORT = 5000;
 
 // ======= UPDATE THESE PATHS (they are absolute) =======
-const CSV_PATH = path.resolve(
-  "C:/Users/yashg/OneDrive/Desktop/DSA_PROJECT/social-graph-friend-recommender/backend/dataset/users.csv"
-);
-
 const BACKEND_PATH = path.resolve(
   "C:/Users/yashg/OneDrive/Desktop/DSA_PROJECT/social-graph-friend-recommender/backend/build/social_graph_app.exe"
 );
@@ -26,59 +21,95 @@ const BACKEND_DIR = path.resolve(
 app.use(express.json());
 app.use(express.static('./')); // serve index.html, style.css, script.js
 
-// Helper to read usernames from CSV (for /users route)
-// Format: id,username,friends
-function readCSVIntoArray(csvPath) {
-  return new Promise((resolve, reject) => {
-    const users = new Set();
-    if (!fs.existsSync(csvPath)) return resolve([]);
-    fs.createReadStream(csvPath)
-      .on('data', chunk => {
-        const lines = chunk.toString().split('\n');
-        lines.forEach(line => {
-          line = line.trim();
-          if (!line) return;
-          const parts = line.split(',');
-          if (parts.length >= 2) {
-            const username = parts[1].trim();
-            if (username) users.add(username);
-          }
-        });
-      })
-      .on('end', () => resolve(Array.from(users)))
-      .on('error', reject);
-  });
+// ======= PERSISTENT BACKEND (social_graph_app --serve) =======
+// One warm process keeps the graph loaded; requests are written as one line
+// each and responses come back as "<byteLength>\n<payload>", in order.
+const REQUEST_TIMEOUT_MS = 10_000;   // per request, once it is the oldest outstanding one
+
+let backend = null;
+let pending = [];            // callbacks waiting for a response, FIFO
+let recvBuf = Buffer.alloc(0);
+let timer = null;            // armed for pending[0]
+
+// Restarts the clock for the oldest outstanding request, if any. A request
+// that takes too long means the backend is hung, and every request queued
+// behind it would wait forever, so the process is killed.
+function armTimer() {
+  clearTimeout(timer);
+  timer = pending.length
+    ? setTimeout(() => failBackend(`Backend timed out after ${REQUEST_TIMEOUT_MS} ms`), REQUEST_TIMEOUT_MS)
+    : null;
 }
 
-// GET /users -> returns list of usernames
-app.get('/users', async (req, res) => {
-  try {
-    const users = await readCSVIntoArray(CSV_PATH);
-    res.json(users);
-  } catch (e) {
-    res.status(500).json({ error: String(e) });
-  }
-});
+// Drops the current process and fails everything still waiting on it; the
+// next request starts a fresh one.
+function failBackend(reason) {
+  if (!backend) return;
+  console.error(`${reason}, restarting on next request.`);
+  const child = backend, failed = pending;
+  backend = null;
+  pending = [];
+  recvBuf = Buffer.alloc(0);
+  armTimer();
+  if (child.exitCode === null && child.signalCode === null) child.kill();
+  failed.forEach(cb => cb(reason));
+}
 
-// Generic exec helper that ensures correct working directory
-function runBackend(args, cb) {
-  execFile(
-    BACKEND_PATH,
-    args,
-    { cwd: BACKEND_DIR, timeout: 10_000 }, // 👈 critical fix
-    (err, stdout, stderr) => {
-      // If we have stdout, use it regardless of exit code
-      if (stdout) return cb(null, stdout.trim());
-      // Otherwise, if there's an error, pass stderr or error message
-      if (err) return cb(stderr || err.message);
-      // Fallback to stderr if no stdout
-      cb(null, (stderr || '').trim());
+function startBackend() {
+  const child = spawn(BACKEND_PATH, ['--serve'], { cwd: BACKEND_DIR });
+  backend = child;
+  // Events from a process we already gave up on must not touch its successor.
+  const current = () => backend === child;
+
+  child.stdout.on('data', chunk => {
+    if (!current()) return;
+    recvBuf = Buffer.concat([recvBuf, chunk]);
+    for (;;) {
+      const nl = recvBuf.indexOf(0x0a);
+      if (nl < 0) break;
+      const len = parseInt(recvBuf.subarray(0, nl).toString(), 10);
+      if (recvBuf.length < nl + 1 + len) break;
+      const payload = recvBuf.subarray(nl + 1, nl + 1 + len).toString();
+      recvBuf = recvBuf.subarray(nl + 1 + len);
+      const cb = pending.shift();
+      armTimer();
+      if (cb) cb(null, payload.trim());
     }
-  );
+  });
+
+  child.stderr.on('data', chunk => console.error(chunk.toString().trim()));
+
+  // Spawn failures (ENOENT, EACCES) and writes to a dead process (EPIPE)
+  // arrive as 'error' events, which crash Node when nobody listens.
+  child.on('error', err => { if (current()) failBackend(`Backend error: ${err.message}`); });
+  child.stdin.on('error', err => { if (current()) failBackend(`Backend error: ${err.message}`); });
+
+  child.on('exit', code => { if (current()) failBackend(`Backend exited (${code})`); });
+}
+
+// Sends one command to the warm backend. Tokens are whitespace-separated on
+// the wire, so arguments containing whitespace are rejected, and so are empty
+// ones: dropping them would shift the positional arguments that follow.
+function runBackend(args, cb) {
+  if (args.some(a => a == null || a === '')) return cb('Missing parameter.');
+  if (args.some(a => /\s/.test(a))) return cb('Arguments may not contain whitespace.');
+  if (!backend) startBackend();
+  pending.push(cb);
+  if (pending.length === 1) armTimer();
+  backend.stdin.write(args.join(' ') + '\n');
 }
 
 // ========== API ENDPOINTS MAPPED TO CLI FEATURES ==========
 
+// GET /users -> returns list of usernames
+// (asked from the backend: users.csv is only rewritten at checkpoints)
+app.get('/users', (req, res) => {
+  runBackend(['--users'], (err, out) => {
+    if (err) return res.status(500).json({ error: String(err) });
+    res.json(out.split(',').filter(Boolean));
+  });
+});
+
 // Add user
 app.post('/add', (req, res) => {
   const username = req.body.username;
@@ -128,10 +159,24 @@ app.get('/connection', (req, res) => {
   runBackend(['--connection', a, b], (err, out) => res.json({ output: err ? err : out }));
 });
 
-// PageRank
+// Shortest friendship chain (bidirectional BFS), optionally capped at N hops
+app.get('/path', (req, res) => {
+  const a = req.query.a || '';
+  const b = req.query.b || '';
+  const args = ['--path', a, b];
+  if (req.query.maxDepth) args.push('--max-depth', String(req.query.maxDepth));
+  runBackend(args, (err, out) => res.json({ output: err ? err : out }));
+});
+
+// Connected-component stats
+app.get('/components', (req, res) => {
+  runBackend(['--components'], (err, out) => res.json({ output: err ? err : out }));
+});
+
+// PageRank (all users when q is omitted)
 app.get('/pagerank', (req, res) => {
-  const q = req.query.q || '';
-  runBackend(['--pagerank', q], (err, out) => res.json({ output: err ? err : out }));
+  const args = req.query.q ? ['--pagerank', req.query.q] : ['--pagerank'];
+  runBackend(args, (err, out) => res.json({ output: err ? err : out }));
 });
 
 // Recommend friends
@@ -151,6 +196,14 @@ app.get('/search', (req, res) => {
   });
 });
 
+// Prometheus scrape target for the backend's hot-path metrics
+app.get('/metrics', (req, res) => {
+  runBackend(['--stats'], (err, out) => {
+    if (err) return res.status(500).type('text/plain').send(String(err) + '\n');
+    res.type('text/plain; version=0.0.4').send(out + '\n');
+  });
+});
+
 // Exit (optional)
 app.post('/exit', (req, res) => {
   runBackend(['--exit'], (err, out) => res.json({ output: err ? err : out }));